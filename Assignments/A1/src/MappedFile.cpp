@@ -0,0 +1,85 @@
+#include "MappedFile.h"
+
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile() :
+	data(nullptr),
+	size(0),
+	released(0),
+	mapped(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+	if(mapped) {
+		munmap((void *)data, size);
+	}
+#endif
+}
+
+bool MappedFile::open(const string &filename)
+{
+#ifndef _WIN32
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if(fstat(fd, &st) != 0) {
+		close(fd);
+		return false;
+	}
+	size = (size_t)st.st_size;
+	if(size > 0) {
+		void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(p != MAP_FAILED) {
+			madvise(p, size, MADV_SEQUENTIAL);
+			data = (const char *)p;
+			mapped = true;
+		}
+	}
+	close(fd);
+	if(mapped || size == 0) {
+		return true;
+	}
+#endif
+	ifstream in(filename, ios::binary);
+	if(!in) {
+		return false;
+	}
+	in.seekg(0, ios::end);
+	size = (size_t)in.tellg();
+	in.seekg(0, ios::beg);
+	copy.resize(size);
+	in.read(copy.data(), size);
+	data = copy.data();
+	return true;
+}
+
+void MappedFile::release(size_t upTo)
+{
+#ifndef _WIN32
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	upTo = upTo/page*page;
+	if(mapped && upTo > released) {
+		madvise((void *)(data + released), upTo - released, MADV_DONTNEED);
+		released = upTo;
+	}
+#endif
+}
+
+void MappedFile::rewind()
+{
+	released = 0;
+}
@@ -0,0 +1,290 @@
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#include "MappedFile.h"
+
+using namespace std;
+
+namespace {
+
+enum { V, VN, VT };
+
+// Feeds a whole file to an ObjLoader::Sink. Relative indices are resolved
+// right away, since every earlier vertex has been seen.
+struct Stream
+{
+	ObjLoader::Sink &sink;
+	MappedFile &file;
+	int counts[3];
+
+	// A given index must be in [0, count); one that isn't given is -1. A
+	// relative index that resolves to -1 is not the same as none.
+	bool inRange(const tinyobj::index_t &idx, const bool given[3]) const
+	{
+		const int i[3] = {idx.vertex_index, idx.normal_index, idx.texcoord_index};
+		for(int a = 0; a < 3; ++a) {
+			if(given[a] ? i[a] < 0 || i[a] >= counts[a] : i[a] != -1) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Drops the pages more than 8 MB behind p.
+	static void releaseBehind(MappedFile &file, const char *p)
+	{
+		size_t done = p - file.data;
+		if(done > (8 << 20)) {
+			file.release(done - (8 << 20));
+		}
+	}
+};
+
+inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+inline const char *skipSpace(const char *p, const char *end)
+{
+	while(p < end && isSpace(*p)) {
+		++p;
+	}
+	return p;
+}
+
+inline const char *skipWord(const char *p, const char *end)
+{
+	while(p < end && !isSpace(*p)) {
+		++p;
+	}
+	return p;
+}
+
+// Like tinyobj, a missing or broken number reads as 0.
+const char *parseFloat(const char *p, const char *end, float &x)
+{
+	p = skipSpace(p, end);
+	if(p < end && *p == '+') {
+		++p;
+	}
+	x = 0.0f;
+#if defined(__cpp_lib_to_chars)
+	from_chars_result r = from_chars(p, end, x);
+	if(r.ec == errc()) {
+		return r.ptr;
+	}
+	x = 0.0f;
+#else
+	// No floating point from_chars in this standard library
+	char buf[64];
+	const char *e = skipWord(p, end);
+	size_t n = min((size_t)(e - p), sizeof(buf) - 1);
+	memcpy(buf, p, n);
+	buf[n] = '\0';
+	x = strtof(buf, nullptr);
+#endif
+	return skipWord(p, end);
+}
+
+// Parses one i, i/j, i//k, or i/j/k into idx, zero based, with negative
+// indices resolved against the counts so far. given[a] tells whether the
+// corner has attribute a at all. Returns false for an index of 0, which OBJ
+// doesn't have.
+bool parseTriple(const char *&p, const char *end, const int counts[3], tinyobj::index_t &idx, bool given[3])
+{
+	bool zero = false;
+	auto number = [&](int attribute) {
+		given[attribute] = true;
+		int i = 0;
+		if(p < end && *p == '+') {
+			++p;
+		}
+		from_chars_result r = from_chars(p, end, i);
+		p = r.ptr;
+		while(p < end && *p != '/' && !isSpace(*p)) {
+			++p;
+		}
+		if(i > 0) {
+			return i - 1;
+		}
+		if(i < 0) {
+			return counts[attribute] + i;
+		}
+		zero = true;
+		return 0;
+	};
+	given[VN] = given[VT] = false;
+	idx.vertex_index = number(V);
+	idx.normal_index = -1;
+	idx.texcoord_index = -1;
+	if(p < end && *p == '/') {
+		++p;
+		if(p < end && *p == '/') {
+			++p;
+			idx.normal_index = number(VN);
+		} else {
+			idx.texcoord_index = number(VT);
+			if(p < end && *p == '/') {
+				++p;
+				idx.normal_index = number(VN);
+			}
+		}
+	}
+	return !zero;
+}
+
+// Passes each line of the file to the sink. Stops at a face with a corner
+// out of range, and returns that line; nullptr if there is none.
+const char *parseLines(Stream &target)
+{
+	vector<tinyobj::index_t> face;
+	const char *p = target.file.data;
+	const char *stop = p + target.file.size;
+	const char *next = p + (1 << 20);
+	while(p < stop) {
+		if(p >= next) {
+			Stream::releaseBehind(target.file, p);
+			next = p + (1 << 20);
+		}
+		const char *eol = (const char *)memchr(p, '\n', stop - p);
+		if(!eol) {
+			eol = stop;
+		}
+		const char *end = eol;
+		if(end > p && end[-1] == '\r') {
+			--end;
+		}
+		const char *line = p;
+		const char *t = skipSpace(p, end);
+		p = eol + 1;
+		if(end - t < 2) {
+			continue;
+		}
+
+		if(t[0] == 'v' && isSpace(t[1])) {
+			float x, y, z;
+			t = parseFloat(t + 2, end, x);
+			t = parseFloat(t, end, y);
+			parseFloat(t, end, z);
+			target.sink.vertex(x, y, z);
+			target.counts[V]++;
+		} else if(t[0] == 'v' && t[1] == 'n' && end - t > 2 && isSpace(t[2])) {
+			float x, y, z;
+			t = parseFloat(t + 3, end, x);
+			t = parseFloat(t, end, y);
+			parseFloat(t, end, z);
+			target.sink.normal(x, y, z);
+			target.counts[VN]++;
+		} else if(t[0] == 'v' && t[1] == 't' && end - t > 2 && isSpace(t[2])) {
+			float x, y;
+			t = parseFloat(t + 3, end, x);
+			parseFloat(t, end, y);
+			target.sink.texcoord(x, y);
+			target.counts[VT]++;
+		} else if(t[0] == 'f' && isSpace(t[1])) {
+			face.clear();
+			t = skipSpace(t + 2, end);
+			while(t < end) {
+				tinyobj::index_t idx;
+				bool given[3];
+				if(!parseTriple(t, end, target.counts, idx, given) || !target.inRange(idx, given)) {
+					return line;
+				}
+				face.push_back(idx);
+				t = skipSpace(t, end);
+			}
+			// Triangle fan, as tinyobj triangulates
+			for(size_t k = 2; k < face.size(); ++k) {
+				tinyobj::index_t corners[3] = {face[0], face[k - 1], face[k]};
+				target.sink.triangle(corners);
+			}
+		}
+	}
+	return nullptr;
+}
+
+// The error message for the face on the line at p
+string badFaceError(const string &filename, const char *p, const char *end)
+{
+	const char *eol = (const char *)memchr(p, '\n', end - p);
+	string line(p, eol ? eol : end);
+	if(!line.empty() && line.back() == '\r') {
+		line.pop_back();
+	}
+	return "Face index out of range in [" + filename + "]: " + line + "\n";
+}
+
+// Counts the vertices, normals, texcoords, and (triangulated) faces of the
+// file without parsing any numbers.
+void countLines(MappedFile &file, size_t counts[4])
+{
+	counts[0] = counts[1] = counts[2] = counts[3] = 0;
+	const char *p = file.data;
+	const char *stop = file.data + file.size;
+	const char *next = p + (1 << 20);
+	while(p < stop) {
+		if(p >= next) {
+			Stream::releaseBehind(file, p);
+			next = p + (1 << 20);
+		}
+		const char *eol = (const char *)memchr(p, '\n', stop - p);
+		if(!eol) {
+			eol = stop;
+		}
+		const char *end = eol;
+		if(end > p && end[-1] == '\r') {
+			--end;
+		}
+		const char *t = skipSpace(p, end);
+		p = eol + 1;
+		if(end - t < 2) {
+			continue;
+		}
+		if(t[0] == 'v' && isSpace(t[1])) {
+			counts[V]++;
+		} else if(t[0] == 'v' && t[1] == 'n' && end - t > 2 && isSpace(t[2])) {
+			counts[VN]++;
+		} else if(t[0] == 'v' && t[1] == 't' && end - t > 2 && isSpace(t[2])) {
+			counts[VT]++;
+		} else if(t[0] == 'f' && isSpace(t[1])) {
+			size_t corners = 0;
+			t = skipSpace(t + 2, end);
+			while(t < end) {
+				++corners;
+				t = skipSpace(skipWord(t, end), end);
+			}
+			counts[3] += corners > 2 ? corners - 2 : 0;
+		}
+	}
+}
+
+}
+
+bool ObjLoader::stream(const string &filename, Sink &sink, string *err)
+{
+	MappedFile file;
+	if(!file.open(filename)) {
+		if(err) {
+			*err = "Cannot open file [" + filename + "]\n";
+		}
+		return false;
+	}
+	size_t counts[4];
+	countLines(file, counts);
+	sink.begin(counts[V], counts[VN], counts[VT], counts[3]);
+	file.rewind();
+	Stream stream = {sink, file, {0, 0, 0}};
+	const char *badFace = parseLines(stream);
+	if(badFace) {
+		if(err) {
+			*err = badFaceError(filename, badFace, file.data + file.size);
+		}
+		return false;
+	}
+	return true;
+}
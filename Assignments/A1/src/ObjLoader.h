@@ -0,0 +1,43 @@
+#pragma once
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <string>
+
+#include "tiny_obj_loader.h"
+
+/**
+ * Reads OBJ files for main()'s buffers without a tinyobj::attrib_t copy of
+ * the whole file in between. The file is memory mapped and parsed line by
+ * line (numbers with std::from_chars), and each line is handed to a Sink.
+ *
+ * Faces are triangulated into fans as tinyobj does. Groups, materials
+ * (mtllib, usemtl) and tags are not read.
+ */
+class ObjLoader
+{
+public:
+	/**
+	 * Receives a file from stream() line by line. begin() comes first, with the
+	 * exact counts from a quick pass over the file, so the final buffers can
+	 * be sized once. Triangle corners are zero based, -1 if absent, and only
+	 * refer to attributes already passed in: stream() fails at a face that
+	 * refers to any other, before passing it on.
+	 */
+	class Sink
+	{
+	public:
+		virtual ~Sink() {}
+		virtual void begin(size_t vertices, size_t normals, size_t texcoords, size_t triangles) = 0;
+		virtual void vertex(float x, float y, float z) = 0;
+		virtual void normal(float x, float y, float z) = 0;
+		virtual void texcoord(float u, float v) = 0;
+		virtual void triangle(const tinyobj::index_t corners[3]) = 0;
+	};
+
+	// Holds nothing besides a window of the file, so the memory used is
+	// about what the sink keeps.
+	static bool stream(const std::string &filename, Sink &sink, std::string *err);
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include "tiny_obj_loader.h"
 
 #include "Image.h"
+#include "ObjLoader.h"
 #include "Structures.h"
 #include <cfloat>
 #include <vector>
@@ -17,6 +18,61 @@
 using namespace std;
 
 
+// Some OBJ files have different indices for vertex positions, normals, and
+// texture coordinates. For example, a cube corner vertex may have three
+// different normals. Here, we are going to duplicate all such vertices,
+// writing each face vertex straight into buffers sized from the triangle
+// count, so only the raw attributes are held besides them.
+class MeshSink : public ObjLoader::Sink
+{
+public:
+	MeshSink(vector<float> &posBuf, vector<float> &norBuf, vector<float> &texBuf) :
+		posBuf(posBuf),
+		norBuf(norBuf),
+		texBuf(texBuf),
+		next(0)
+	{
+	}
+
+	void begin(size_t vertices, size_t normals, size_t texcoords, size_t triangles)
+	{
+		v.reserve(3*vertices);
+		vn.reserve(3*normals);
+		vt.reserve(2*texcoords);
+		posBuf.assign(9*triangles, 0.0f);
+		norBuf.assign(normals > 0 ? 9*triangles : 0, 0.0f);
+		texBuf.assign(texcoords > 0 ? 6*triangles : 0, 0.0f);
+	}
+
+	void vertex(float x, float y, float z) { v.insert(v.end(), {x, y, z}); }
+	void normal(float x, float y, float z) { vn.insert(vn.end(), {x, y, z}); }
+	void texcoord(float s, float t) { vt.insert(vt.end(), {s, t}); }
+
+	void triangle(const tinyobj::index_t corners[3])
+	{
+		for(int c = 0; c < 3; ++c, ++next) {
+			const tinyobj::index_t &idx = corners[c];
+			copy(&v[3*idx.vertex_index], &v[3*idx.vertex_index] + 3, &posBuf[3*next]);
+			if(!norBuf.empty() && idx.normal_index >= 0) {
+				copy(&vn[3*idx.normal_index], &vn[3*idx.normal_index] + 3, &norBuf[3*next]);
+			}
+			if(!texBuf.empty() && idx.texcoord_index >= 0) {
+				copy(&vt[2*idx.texcoord_index], &vt[2*idx.texcoord_index] + 2, &texBuf[2*next]);
+			}
+		}
+	}
+
+private:
+	vector<float> &posBuf;
+	vector<float> &norBuf;
+	vector<float> &texBuf;
+	vector<float> v;
+	vector<float> vn;
+	vector<float> vt;
+	size_t next;
+};
+
+
 double RANDOM_COLORS[7][3] = {
 	{0.0000,    0.4470,    0.7410},
 	{0.8500,    0.3250,    0.0980},
@@ -78,46 +134,11 @@ int main(int argc, char **argv)
 	vector<float> posBuf; // list of vertex positions
 	vector<float> norBuf; // list of vertex normals
 	vector<float> texBuf; // list of vertex texture coords
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
+	MeshSink sink(posBuf, norBuf, texBuf);
 	string errStr;
-	bool rc = tinyobj::LoadObj(&attrib, &shapes, &materials, &errStr, meshName.c_str());
+	bool rc = ObjLoader::stream(meshName, sink, &errStr);
 	if(!rc) {
 		cerr << errStr << endl;
-	} else {
-		// Some OBJ files have different indices for vertex positions, normals,
-		// and texture coordinates. For example, a cube corner vertex may have
-		// three different normals. Here, we are going to duplicate all such
-		// vertices.
-		// Loop over shapes
-		for(size_t s = 0; s < shapes.size(); s++) {
-			// Loop over faces (polygons)
-			size_t index_offset = 0;
-			for(size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-				size_t fv = shapes[s].mesh.num_face_vertices[f];
-				// Loop over vertices in the face.
-				for(size_t v = 0; v < fv; v++) {
-					// access to vertex
-					tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-					posBuf.push_back(attrib.vertices[3*idx.vertex_index+0]);
-					posBuf.push_back(attrib.vertices[3*idx.vertex_index+1]);
-					posBuf.push_back(attrib.vertices[3*idx.vertex_index+2]);
-					if(!attrib.normals.empty()) {
-						norBuf.push_back(attrib.normals[3*idx.normal_index+0]);
-						norBuf.push_back(attrib.normals[3*idx.normal_index+1]);
-						norBuf.push_back(attrib.normals[3*idx.normal_index+2]);
-					}
-					if(!attrib.texcoords.empty()) {
-						texBuf.push_back(attrib.texcoords[2*idx.texcoord_index+0]);
-						texBuf.push_back(attrib.texcoords[2*idx.texcoord_index+1]);
-					}
-				}
-				index_offset += fv;
-				// per-face material (IGNORE)
-				shapes[s].mesh.material_ids[f];
-			}
-		}
 	}
 	cout << "Number of vertices: " << posBuf.size()/3 << endl;
     
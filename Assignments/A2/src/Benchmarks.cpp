@@ -0,0 +1,212 @@
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stack>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Component.hpp"
+#include "MatrixStack.h"
+#include "Skeleton.h"
+
+using namespace std;
+
+namespace {
+
+// The MatrixStack this project used to have, for matrixStack(): a
+// std::stack (a deque) behind a shared_ptr, and a full 4x4 multiply per call
+class DequeMatrixStack
+{
+public:
+	DequeMatrixStack() : mstack(make_shared< stack<glm::mat4> >()) { mstack->push(glm::mat4(1.0f)); }
+	void pushMatrix() { mstack->push(mstack->top()); }
+	void popMatrix() { mstack->pop(); }
+	void translate(const glm::vec3 &t) { mstack->top() *= glm::translate(glm::mat4(1.0f), t); }
+	void scale(const glm::vec3 &s) { mstack->top() *= glm::scale(glm::mat4(1.0f), s); }
+	void rotate(float angle, const glm::vec3 &axis) { mstack->top() *= glm::rotate(glm::mat4(1.0f), angle, axis); }
+	const glm::mat4 &topMatrix() const { return mstack->top(); }
+	glm::mat3 normalMatrix() const { return glm::mat3(glm::transpose(glm::inverse(mstack->top()))); }
+
+private:
+	shared_ptr< stack<glm::mat4> > mstack;
+};
+
+struct BenchComponent
+{
+	glm::vec3 joint;
+	glm::vec3 angles;
+	glm::vec3 mesh;
+	glm::vec3 scale;
+	vector<int> children;
+};
+
+// The calls the recursive Component::draw() made, with the uploads replaced
+// by adding up the matrices
+template <typename Stack>
+void benchDraw(Stack &MV, const vector<BenchComponent> &tree, int i, float angle, glm::mat4 &sum, glm::mat3 &normalSum)
+{
+	const BenchComponent &c = tree[i];
+	MV.pushMatrix();
+	MV.translate(c.joint);
+	MV.rotate(c.angles.x, glm::vec3(1.0f, 0.0f, 0.0f));
+	MV.rotate(c.angles.y, glm::vec3(0.0f, 1.0f, 0.0f));
+	MV.rotate(c.angles.z, glm::vec3(0.0f, 0.0f, 1.0f));
+	MV.pushMatrix();
+	MV.rotate(angle, glm::vec3(1.0f, 0.0f, 0.0f));
+	MV.pushMatrix();
+	MV.scale(glm::vec3(0.75f, 0.75f, 0.75f));
+	sum[0] += MV.topMatrix()[0];
+	MV.popMatrix();
+	MV.translate(c.mesh);
+	MV.scale(c.scale);
+	sum[3] += MV.topMatrix()[3];
+	normalSum[0] += MV.normalMatrix()[0];
+	MV.popMatrix();
+	for(int child : c.children) {
+		benchDraw(MV, tree, child, angle, sum, normalSum);
+	}
+	MV.popMatrix();
+}
+
+// Forward kinematics the way the recursive Component::draw() did it, adding
+// up the joint positions
+void fkWalk(MatrixStack &MV, const Component &c, glm::vec3 &sum)
+{
+	MV.pushMatrix();
+	MV.translate(c.getJointTranslations());
+	MV.rotate(c.getJointAngles().x, glm::vec3(1.0f, 0.0f, 0.0f));
+	MV.rotate(c.getJointAngles().y, glm::vec3(0.0f, 1.0f, 0.0f));
+	MV.rotate(c.getJointAngles().z, glm::vec3(0.0f, 0.0f, 1.0f));
+	sum += glm::vec3(MV.topMatrix()[3]);
+	for(const Component *child : c.getChildren()) {
+		fkWalk(MV, *child, sum);
+	}
+	MV.popMatrix();
+}
+
+}
+
+void Benchmarks::matrixStack()
+{
+	// Robot: torso, head, two arms of two parts, two legs of two parts
+	vector<BenchComponent> robot(11);
+	int robotParents[] = {-1, 0, 0, 2, 0, 4, 0, 6, 0, 8, 3};
+	// A tree four wide and six deep
+	vector<BenchComponent> large(1 + 4 + 16 + 64 + 256 + 1024);
+	vector<int> largeParents(large.size(), -1);
+	for(size_t i = 1; i < large.size(); ++i) {
+		largeParents[i] = (int)(i - 1)/4;
+	}
+	struct Tree
+	{
+		const char *name;
+		vector<BenchComponent> *components;
+		const int *parents;
+	};
+	Tree trees[] = {{"robot", &robot, robotParents}, {"4-ary, depth 6", &large, &largeParents[0]}};
+	for(Tree &tree : trees) {
+		vector<BenchComponent> &components = *tree.components;
+		for(size_t i = 0; i < components.size(); ++i) {
+			float f = (float)i;
+			components[i].joint = glm::vec3(0.1f*f, 1.0f, 0.0f);
+			components[i].angles = glm::vec3(0.1f, 0.2f*f, 0.3f);
+			components[i].mesh = glm::vec3(0.0f, 0.5f, 0.0f);
+			components[i].scale = glm::vec3(0.5f, 1.0f, 0.5f);
+			if(tree.parents[i] >= 0) {
+				components[tree.parents[i]].children.push_back((int)i);
+			}
+		}
+		int frames = (int)(2000000/components.size());
+		glm::mat4 sum[2];
+		glm::mat3 normalSum[2];
+		double seconds[2];
+		for(int k = 0; k < 2; ++k) {
+			sum[k] = glm::mat4(0.0f);
+			normalSum[k] = glm::mat3(0.0f);
+			auto start = chrono::steady_clock::now();
+			for(int frame = 0; frame < frames; ++frame) {
+				float angle = 0.001f*frame;
+				if(k == 0) {
+					DequeMatrixStack MV;
+					MV.pushMatrix();
+					MV.translate(glm::vec3(0.0f, 0.0f, -15.0f));
+					benchDraw(MV, components, 0, angle, sum[k], normalSum[k]);
+					MV.popMatrix();
+				} else {
+					MatrixStack MV;
+					MV.pushMatrix();
+					MV.translate(glm::vec3(0.0f, 0.0f, -15.0f));
+					benchDraw(MV, components, 0, angle, sum[k], normalSum[k]);
+					MV.popMatrix();
+				}
+			}
+			seconds[k] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		}
+		size_t calls = (size_t)frames*components.size();
+		float difference = glm::length(sum[0][3] - sum[1][3])/glm::length(sum[0][3]);
+		cout << tree.name << " (" << components.size() << " components):" << endl;
+		cout << "  DequeMatrixStack: " << 1e9*seconds[0]/calls << " ns per component" << endl;
+		cout << "  MatrixStack:      " << 1e9*seconds[1]/calls << " ns per component ("
+		     << seconds[0]/seconds[1] << "x), relative difference " << difference << endl;
+	}
+}
+
+void Benchmarks::forwardKinematics(const Component &torso)
+{
+	auto seconds = [](chrono::steady_clock::time_point start) {
+		return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	};
+	const int FRAMES = 20;
+	for(int instances : {1000, 10000, 100000}) {
+		Skeleton robots;
+		robots.build(torso, instances);
+		int joints = robots.getJointCount();
+		int shoulder = 2; // after the torso and the head
+		cout << instances << " robots of " << joints << " joints:" << endl;
+
+		auto start = chrono::steady_clock::now();
+		glm::vec3 sum(0.0f);
+		for(int frame = 0; frame < FRAMES; ++frame) {
+			for(int k = 0; k < instances; ++k) {
+				MatrixStack MV;
+				fkWalk(MV, torso, sum);
+			}
+		}
+		double walk = seconds(start)/FRAMES;
+		cout << "  MatrixStack walk:     " << 1000.0*walk << " ms per frame" << endl;
+
+		for(int changed = 0; changed < 3; ++changed) {
+			double setTime = 0.0;
+			size_t frames = 0;
+			start = chrono::steady_clock::now();
+			for(int frame = 0; frame < FRAMES; ++frame) {
+				auto setStart = chrono::steady_clock::now();
+				glm::vec3 angles(0.01f*frame, 0.0f, 0.0f);
+				for(int k = 0; k < instances; ++k) {
+					if(changed == 0) {
+						for(int j = 0; j < joints; ++j) {
+							robots.setJointAngles(j, angles, k);
+						}
+					} else if(changed == 1) {
+						robots.setJointAngles(shoulder, angles, k);
+					}
+				}
+				setTime += seconds(setStart);
+				frames = robots.update();
+			}
+			double update = (seconds(start) - setTime)/FRAMES;
+			const char *labels[] = {"all joints changed:  ", "one shoulder changed:", "nothing changed:     "};
+			cout << "  Skeleton, " << labels[changed] << " " << 1000.0*update << " ms per frame (" << walk/update << "x), "
+			     << frames << " frames recomputed, setting the angles " << 1000.0*setTime/FRAMES << " ms" << endl;
+		}
+		glm::vec3 last = glm::vec3(robots.getJointMatrix(joints - 1, instances - 1)[3]);
+		if(sum.x != sum.x || last.x != last.x) {
+			cout << "  (NaN)" << endl;
+		}
+	}
+}
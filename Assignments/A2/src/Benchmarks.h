@@ -0,0 +1,25 @@
+#pragma once
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+class Component;
+
+/**
+ * The timing modes of the command line (A2 RESOURCE_DIR stackbench|fkbench).
+ * They need no window and print their results to cout.
+ */
+class Benchmarks
+{
+public:
+	// Draws a component tree (the robot's shape, and a larger one) with
+	// MatrixStack against the std::stack based one A2 used to have, a new
+	// stack per frame as in render()
+	static void matrixStack();
+	// Skeleton::update() on many robots sharing the skeleton of torso, after
+	// every joint of every robot changed, after one shoulder of every robot
+	// changed, and with nothing changed, against walking the Components of
+	// each robot with a MatrixStack
+	static void forwardKinematics(const Component &torso);
+};
+
+#endif
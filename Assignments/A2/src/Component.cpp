@@ -29,61 +29,8 @@ Component::Component(glm::vec3 jointTranslateWRTParent, glm::vec3 meshTranslateW
     jointAngles = currJointAngles;
     meshTranslation = meshTranslateWRTJoint;
     scalingFactors = scaleXYZ;
-}
-
-void Component::draw(MatrixStack& MV, map<string,GLint> unifIDs, int indCount, double t) {
-    float RotationSpeed = float(M_PI/2); // degrees per second
-    float RotationAngle = RotationSpeed * t;
-    
-    MV.pushMatrix();
-        
-    
-        MV.translate(jointTranslation); // Where is the components's joint with respect to the parent's joint?
-        
-        
-        MV.rotate(jointAngles.x, glm::vec3(1.0f, 0.0f, 0.0f)); // This rotation applies to component
-        MV.rotate(jointAngles.y, glm::vec3(0.0f, 1.0f, 0.0f)); // This rotation applies to component
-        MV.rotate(jointAngles.z, glm::vec3(0.0f, 0.0f, 1.0f)); // This rotation applies to component
-    
-        
-        MV.pushMatrix();
-            if(permaRotate == true){
-                MV.rotate(RotationAngle, glm::vec3(1.0f, 0.0f, 0.0f)); //
-                
-            }
-            
-            MV.pushMatrix();
-                
-                MV.scale(glm::vec3(0.75f, 0.75f, 0.75f));
-                glUniformMatrix4fv(unifIDs["MV"], 1, GL_FALSE, value_ptr(MV.topMatrix()));
-                glDrawArrays(GL_TRIANGLES, 0, indCount);
-            MV.popMatrix();
-    
-            MV.translate(meshTranslation); // Where is the components's mesh with respect to the components's joint?
-            if (selected == true) {
-                float scaleChange = 1.0 + float(0.08/2) + (float(0.08/2)*(sin(2 * M_PI * 2 * t)));
-                glm::vec3 dynamicScalingFactors = scalingFactors * (scaleChange);
-
-                MV.scale(dynamicScalingFactors);
-            }
-            else{
-                MV.scale(scalingFactors);
-            }
-            
-            glUniformMatrix4fv(unifIDs["MV"], 1, GL_FALSE, value_ptr(MV.topMatrix()));
-            glDrawArrays(GL_TRIANGLES, 0, indCount);
-        MV.popMatrix();
-    
-        
-    
-        // Draw children
-    
-        for (Component* child : children) {
-               child->draw(MV, unifIDs, indCount, t);
-        }
-    
-    MV.popMatrix();
-    
+    selected = false;
+    permaRotate = false;
 }
 
 void Component::addChild(Component* child) {
@@ -94,15 +41,23 @@ void Component::setJointAngles(glm::vec3 angles) {
     jointAngles = angles;
 }
 
-glm::vec3 Component::getJointAngles() {
+glm::vec3 Component::getJointAngles() const {
     return jointAngles;
 }
 
-glm::vec3 Component::getJointTranslations() {
+glm::vec3 Component::getJointTranslations() const {
     return jointTranslation;
 }
 
-std::vector<Component*> Component::getChildren() {
+glm::vec3 Component::getMeshTranslation() const {
+    return meshTranslation;
+}
+
+glm::vec3 Component::getScalingFactors() const {
+    return scalingFactors;
+}
+
+const std::vector<Component*> &Component::getChildren() const {
     return children;
 }
 
@@ -121,3 +76,7 @@ bool Component::isSelected() const {
 void Component::setPermaRotate(bool perma) {
     permaRotate = perma;
 }
+
+bool Component::isPermaRotate() const {
+    return permaRotate;
+}
@@ -27,16 +27,18 @@ using namespace glm;
 class Component {
 public:
     Component(glm::vec3 jointTranslateWRTParent, glm::vec3 meshTranslateWRTJoint, glm::vec3 currJointAngles, glm::vec3 scaleXYZ);
-    void draw(MatrixStack& MV, map<string,GLint> unifIDs, int indCount, double t);
     void addChild(Component* child);
     void setJointAngles(glm::vec3 angles);
     void setScalingFactors(glm::vec3 scales);
-    glm::vec3 getJointAngles();
+    glm::vec3 getJointAngles() const;
     void setSelected(bool selected);
     bool isSelected() const;
-    std::vector<Component*> getChildren();
-    glm::vec3 getJointTranslations();
+    const std::vector<Component*> &getChildren() const;
+    glm::vec3 getJointTranslations() const;
+    glm::vec3 getMeshTranslation() const;
+    glm::vec3 getScalingFactors() const;
     void setPermaRotate(bool perma);
+    bool isPermaRotate() const;
 
 private:
     glm::vec3 jointTranslation;
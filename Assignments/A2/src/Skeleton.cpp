@@ -0,0 +1,195 @@
+#include "Skeleton.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Component.hpp"
+#include "MatrixStack.h"
+
+using namespace std;
+
+namespace {
+
+const float PI = 3.14159265358979f;
+
+// T(t) Rx(a.x) Ry(a.y) Rz(a.z), as Component::draw() used to build it
+glm::mat4 jointFrame(const glm::vec3 &t, const glm::vec3 &a)
+{
+	float cx = cos(a.x), sx = sin(a.x);
+	float cy = cos(a.y), sy = sin(a.y);
+	float cz = cos(a.z), sz = sin(a.z);
+	glm::mat4 M(1.0f);
+	M[0] = glm::vec4(cy*cz, cx*sz + sx*sy*cz, sx*sz - cx*sy*cz, 0.0f);
+	M[1] = glm::vec4(-cy*sz, cx*cz - sx*sy*sz, sx*cz + cx*sy*sz, 0.0f);
+	M[2] = glm::vec4(sy, -sx*cy, cx*cy, 0.0f);
+	M[3] = glm::vec4(t, 1.0f);
+	return M;
+}
+
+}
+
+Skeleton::Skeleton() :
+	instances(0)
+{
+}
+
+void Skeleton::build(const Component &root, int instances)
+{
+	this->instances = instances;
+	joints.clear();
+	// Depth first with an explicit stack of (component, parent index)
+	vector<pair<const Component *, int> > stack(1, make_pair(&root, -1));
+	vector<glm::vec3> restAngles;
+	while(!stack.empty()) {
+		const Component *c = stack.back().first;
+		Joint joint;
+		joint.parent = stack.back().second;
+		stack.pop_back();
+		joint.translation = c->getJointTranslations();
+		joint.meshTranslation = c->getMeshTranslation();
+		joint.scale = c->getScalingFactors();
+		joint.permaRotate = c->isPermaRotate();
+		joint.selected = c->isSelected();
+		restAngles.push_back(c->getJointAngles());
+		int index = (int)joints.size();
+		joints.push_back(joint);
+		const vector<Component *> &children = c->getChildren();
+		for(int i = (int)children.size() - 1; i >= 0; --i) {
+			stack.push_back(make_pair(children[i], index));
+		}
+	}
+	size_t slots = joints.size() + 1;
+	angles.resize(joints.size()*instances);
+	local.assign(slots*12*instances, 0.0f);
+	world.assign(slots*12*instances, 0.0f);
+	dirty.assign(slots*instances, 1);
+	slotDirty.assign(slots, 1);
+	for(int k = 0; k < instances; ++k) {
+		setFrame(world, 0, k, glm::mat4(1.0f));
+		for(size_t j = 0; j < joints.size(); ++j) {
+			setJointAngles((int)j, restAngles[j], k);
+		}
+	}
+	update();
+}
+
+void Skeleton::setFrame(vector<float> &frames, int slot, int instance, const glm::mat4 &M)
+{
+	float *f = frame(frames, slot) + instance;
+	for(int j = 0; j < 4; ++j) {
+		for(int i = 0; i < 3; ++i) {
+			f[(3*j + i)*instances] = M[j][i];
+		}
+	}
+}
+
+glm::mat4 Skeleton::getFrame(const vector<float> &frames, int slot, int instance) const
+{
+	const float *f = frame(frames, slot) + instance;
+	glm::mat4 M(1.0f);
+	for(int j = 0; j < 4; ++j) {
+		for(int i = 0; i < 3; ++i) {
+			M[j][i] = f[(3*j + i)*instances];
+		}
+	}
+	return M;
+}
+
+void Skeleton::setJointAngles(int joint, const glm::vec3 &a, int instance)
+{
+	angles[joint*instances + instance] = a;
+	setFrame(local, joint + 1, instance, jointFrame(joints[joint].translation, a));
+	dirty[(joint + 1)*instances + instance] = 1;
+	slotDirty[joint + 1] = 1;
+}
+
+void Skeleton::setInstanceTransform(int instance, const glm::mat4 &M)
+{
+	setFrame(world, 0, instance, M);
+	dirty[instance] = 1;
+	slotDirty[0] = 1;
+}
+
+size_t Skeleton::update()
+{
+	size_t n = instances;
+	size_t changed = 0;
+	for(size_t j = 0; j < joints.size(); ++j) {
+		int s = (int)j + 1;
+		int p = joints[j].parent + 1;
+		if(!slotDirty[s] && !slotDirty[p]) {
+			continue;
+		}
+		slotDirty[s] = 1; // for the children
+		unsigned char *d = &dirty[s*n];
+		const unsigned char *pd = &dirty[p*n];
+		for(size_t k = 0; k < n; ++k) {
+			d[k] |= pd[k];
+		}
+		// world = parent * local, entry by entry over all instances. The
+		// bottom rows are (0, 0, 0, 1), so column c of the result is
+		// P0 L0c + P1 L1c + P2 L2c (+ P3 for the last column).
+		float *W = frame(world, s);
+		const float *P = frame(world, p);
+		const float *L = frame(local, s);
+		for(int c = 0; c < 4; ++c) {
+			for(int r = 0; r < 3; ++r) {
+				float *w = W + (3*c + r)*n;
+				const float *p0 = P + r*n;
+				const float *p1 = P + (3 + r)*n;
+				const float *p2 = P + (6 + r)*n;
+				const float *p3 = P + (9 + r)*n;
+				const float *l0 = L + 3*c*n;
+				const float *l1 = L + (3*c + 1)*n;
+				const float *l2 = L + (3*c + 2)*n;
+				float last = c == 3 ? 1.0f : 0.0f;
+				for(size_t k = 0; k < n; ++k) {
+					float v = p0[k]*l0[k] + p1[k]*l1[k] + p2[k]*l2[k] + last*p3[k];
+					w[k] = d[k] ? v : w[k];
+				}
+			}
+		}
+		for(size_t k = 0; k < n; ++k) {
+			changed += d[k];
+		}
+	}
+	fill(dirty.begin(), dirty.end(), 0);
+	fill(slotDirty.begin(), slotDirty.end(), 0);
+	return changed;
+}
+
+glm::mat4 Skeleton::getJointMatrix(int joint, int instance) const
+{
+	return getFrame(world, joint + 1, instance);
+}
+
+void Skeleton::draw(MatrixStack &MV, GLint unifMV, int indCount, double t, int instance) const
+{
+	float rotationAngle = float(PI/2*t);
+	for(size_t j = 0; j < joints.size(); ++j) {
+		const Joint &joint = joints[j];
+		MV.pushMatrix();
+		MV.multMatrix(getJointMatrix((int)j, instance));
+		if(joint.permaRotate) {
+			MV.rotate(rotationAngle, glm::vec3(1.0f, 0.0f, 0.0f));
+		}
+		MV.pushMatrix();
+		MV.scale(glm::vec3(0.75f, 0.75f, 0.75f));
+		glUniformMatrix4fv(unifMV, 1, GL_FALSE, glm::value_ptr(MV.topMatrix()));
+		glDrawArrays(GL_TRIANGLES, 0, indCount);
+		MV.popMatrix();
+		MV.translate(joint.meshTranslation);
+		if(joint.selected) {
+			float scaleChange = 1.0f + 0.04f + 0.04f*sin(2*PI*2*t);
+			MV.scale(joint.scale*scaleChange);
+		} else {
+			MV.scale(joint.scale);
+		}
+		glUniformMatrix4fv(unifMV, 1, GL_FALSE, glm::value_ptr(MV.topMatrix()));
+		glDrawArrays(GL_TRIANGLES, 0, indCount);
+		MV.popMatrix();
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+#ifndef SKELETON_H
+#define SKELETON_H
+
+#include <vector>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+class Component;
+class MatrixStack;
+
+/**
+ * A Component tree flattened into an array of joints in depth-first order,
+ * so that every joint comes after its parent, and posed as any number of
+ * instances that share it.
+ *
+ * Each joint of each instance keeps its local frame (translate, then rotate
+ * about x, y, and z) and its world frame, both as 3x4 affine matrices. They
+ * are stored by joint, then by matrix entry, then by instance, so one joint
+ * of all the instances is twelve runs of consecutive floats.
+ * setJointAngles() rebuilds the local frame right away and marks the joint.
+ * update() then goes once down the array: a joint whose parent changed is
+ * marked too, and joints marked in any instance get parent * local for all
+ * instances in one loop, keeping the old frame where the instance isn't
+ * marked. Joints marked in no instance are skipped.
+ */
+class Skeleton
+{
+public:
+	Skeleton();
+	// Depth-first from root, children in order. Every instance starts with
+	// the components' angles and the identity instance transform.
+	void build(const Component &root, int instances = 1);
+	int getJointCount() const { return (int)joints.size(); }
+	int getInstanceCount() const { return instances; }
+	int getParent(int joint) const { return joints[joint].parent; }
+
+	void setJointAngles(int joint, const glm::vec3 &angles, int instance = 0);
+	const glm::vec3 &getJointAngles(int joint, int instance = 0) const { return angles[joint*instances + instance]; }
+	// The frame the root joint of the instance is placed in
+	void setInstanceTransform(int instance, const glm::mat4 &M);
+	// Shared by all instances: the pulsing of selected joints in draw()
+	void setSelected(int joint, bool selected) { joints[joint].selected = selected; }
+	bool isSelected(int joint) const { return joints[joint].selected; }
+
+	// Recomputes the world frames of the changed joints and everything below
+	// them. Returns the number of frames that changed.
+	size_t update();
+	// World frame of a joint, as of the last update()
+	glm::mat4 getJointMatrix(int joint, int instance = 0) const;
+	// Draws each joint of the instance as Component did: the joint scaled
+	// to 0.75, then the mesh, both with indCount vertices of the bound
+	// buffers. Call update() first.
+	void draw(MatrixStack &MV, GLint unifMV, int indCount, double t, int instance = 0) const;
+
+private:
+	struct Joint
+	{
+		int parent; // -1 for the root
+		glm::vec3 translation; // of the joint in the parent's frame
+		glm::vec3 meshTranslation; // of the mesh in the joint's frame
+		glm::vec3 scale; // of the mesh
+		bool permaRotate; // spins about x over time
+		bool selected;
+	};
+
+	// Frames are kept in slots: 0 is the instance transform, and joint j is
+	// in slot j + 1.
+	float *frame(std::vector<float> &frames, int slot) { return &frames[(size_t)slot*12*instances]; }
+	const float *frame(const std::vector<float> &frames, int slot) const { return &frames[(size_t)slot*12*instances]; }
+	void setFrame(std::vector<float> &frames, int slot, int instance, const glm::mat4 &M);
+	glm::mat4 getFrame(const std::vector<float> &frames, int slot, int instance) const;
+
+	std::vector<Joint> joints;
+	int instances;
+	std::vector<glm::vec3> angles; // by joint, then instance
+	std::vector<float> local;
+	std::vector<float> world;
+	std::vector<unsigned char> dirty; // by slot, then instance
+	std::vector<unsigned char> slotDirty; // any instance of the slot
+};
+
+#endif
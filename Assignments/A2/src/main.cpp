@@ -3,6 +3,7 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <map>
 #include <stack>
@@ -19,9 +20,11 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
+#include "Benchmarks.h"
 #include "GLSL.h"
 #include "MatrixStack.h"
 #include "Component.hpp"
+#include "Skeleton.h"
 
 using namespace std;
 using namespace glm;
@@ -38,7 +41,8 @@ int traverseIndex = -1;
 
 Component torso(glm::vec3 (0.0f, 2.0f, 0.0f),glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (2.0f, 3.5f, 1.0f));
 
-std::vector<Component*> treeTraversal;
+// The robot flattened for drawing: joints in the order . and , step through
+Skeleton skeleton;
 
 // This function is called when a GLFW error occurs
 static void error_callback(int error, const char *description)
@@ -73,101 +77,101 @@ static void char_callback(GLFWwindow *window, unsigned int key)
     switch(key) {
         case 'x':
         {
-            if(treeTraversal[traverseIndex]->isSelected() == true)
+            if(skeleton.isSelected(traverseIndex) == true)
             {
-                float newx = treeTraversal[traverseIndex]->getJointAngles().x;
+                float newx = skeleton.getJointAngles(traverseIndex).x;
                 newx += float(M_PI/15);
                 
-                glm::vec3 newAngles (newx, treeTraversal[traverseIndex]->getJointAngles().y, treeTraversal[traverseIndex]->getJointAngles().z);
-                treeTraversal[traverseIndex]->setJointAngles(newAngles);
+                glm::vec3 newAngles (newx, skeleton.getJointAngles(traverseIndex).y, skeleton.getJointAngles(traverseIndex).z);
+                skeleton.setJointAngles(traverseIndex, newAngles);
                 
             }
             break;
         }
         case 'X':
         {
-            if(treeTraversal[traverseIndex]->isSelected() == true)
+            if(skeleton.isSelected(traverseIndex) == true)
             {
-                float newX = treeTraversal[traverseIndex]->getJointAngles().x;
+                float newX = skeleton.getJointAngles(traverseIndex).x;
                 newX -= float(M_PI/15);
                 
-                glm::vec3 newAngles (newX, treeTraversal[traverseIndex]->getJointAngles().y, treeTraversal[traverseIndex]->getJointAngles().z);
-                treeTraversal[traverseIndex]->setJointAngles(newAngles);
+                glm::vec3 newAngles (newX, skeleton.getJointAngles(traverseIndex).y, skeleton.getJointAngles(traverseIndex).z);
+                skeleton.setJointAngles(traverseIndex, newAngles);
                 
             }
             break;
         }
         case 'y':
         {
-            if(treeTraversal[traverseIndex]->isSelected() == true)
+            if(skeleton.isSelected(traverseIndex) == true)
             {
-                float newy = treeTraversal[traverseIndex]->getJointAngles().y;
+                float newy = skeleton.getJointAngles(traverseIndex).y;
                 newy += float(M_PI/15);
                 
-                glm::vec3 newAngles (treeTraversal[traverseIndex]->getJointAngles().x, newy, treeTraversal[traverseIndex]->getJointAngles().z);
-                treeTraversal[traverseIndex]->setJointAngles(newAngles);
+                glm::vec3 newAngles (skeleton.getJointAngles(traverseIndex).x, newy, skeleton.getJointAngles(traverseIndex).z);
+                skeleton.setJointAngles(traverseIndex, newAngles);
                 
             }
             break;
         }
         case 'Y':
         {
-            if(treeTraversal[traverseIndex]->isSelected() == true)
+            if(skeleton.isSelected(traverseIndex) == true)
             {
-                float newY = treeTraversal[traverseIndex]->getJointAngles().y;
+                float newY = skeleton.getJointAngles(traverseIndex).y;
                 newY -= float(M_PI/15);
                 
-                glm::vec3 newAngles (treeTraversal[traverseIndex]->getJointAngles().x, newY, treeTraversal[traverseIndex]->getJointAngles().z);
-                treeTraversal[traverseIndex]->setJointAngles(newAngles);
+                glm::vec3 newAngles (skeleton.getJointAngles(traverseIndex).x, newY, skeleton.getJointAngles(traverseIndex).z);
+                skeleton.setJointAngles(traverseIndex, newAngles);
                 
             }
             break;
         }
         case 'z':
         {
-            if(treeTraversal[traverseIndex]->isSelected() == true)
+            if(skeleton.isSelected(traverseIndex) == true)
             {
-                float newz = treeTraversal[traverseIndex]->getJointAngles().z;
+                float newz = skeleton.getJointAngles(traverseIndex).z;
                 newz += float(M_PI/15);
                 
-                glm::vec3 newAngles (treeTraversal[traverseIndex]->getJointAngles().x, treeTraversal[traverseIndex]->getJointAngles().y, newz);
-                treeTraversal[traverseIndex]->setJointAngles(newAngles);
+                glm::vec3 newAngles (skeleton.getJointAngles(traverseIndex).x, skeleton.getJointAngles(traverseIndex).y, newz);
+                skeleton.setJointAngles(traverseIndex, newAngles);
                 
             }
             break;
         }
         case 'Z':
         {
-            if(treeTraversal[traverseIndex]->isSelected() == true)
+            if(skeleton.isSelected(traverseIndex) == true)
             {
-                float newZ = treeTraversal[traverseIndex]->getJointAngles().z;
+                float newZ = skeleton.getJointAngles(traverseIndex).z;
                 newZ -= float(M_PI/15);
                 
-                glm::vec3 newAngles (treeTraversal[traverseIndex]->getJointAngles().x, treeTraversal[traverseIndex]->getJointAngles().y, newZ);
-                treeTraversal[traverseIndex]->setJointAngles(newAngles);
+                glm::vec3 newAngles (skeleton.getJointAngles(traverseIndex).x, skeleton.getJointAngles(traverseIndex).y, newZ);
+                skeleton.setJointAngles(traverseIndex, newAngles);
                 
             }
             break;
         }
         case '.':
         {
-            if(traverseIndex == treeTraversal.size() - 1)
+            if(traverseIndex == skeleton.getJointCount() - 1)
             {
-                treeTraversal[traverseIndex]->setSelected(false);
+                skeleton.setSelected(traverseIndex, false);
                 traverseIndex = 0;
-                treeTraversal[traverseIndex]->setSelected(true);
+                skeleton.setSelected(traverseIndex, true);
             }
             else if(traverseIndex == -1)
             {
                 traverseIndex += 1;
-                treeTraversal[traverseIndex]->setSelected(true);
+                skeleton.setSelected(traverseIndex, true);
                 
             }
             else
             {
-                treeTraversal[traverseIndex]->setSelected(false);
+                skeleton.setSelected(traverseIndex, false);
                 traverseIndex += 1;
-                treeTraversal[traverseIndex]->setSelected(true);
+                skeleton.setSelected(traverseIndex, true);
                 
             }
                         
@@ -177,21 +181,21 @@ static void char_callback(GLFWwindow *window, unsigned int key)
         {
             if(traverseIndex == 0)
             {
-                treeTraversal[traverseIndex]->setSelected(false);
-                traverseIndex = treeTraversal.size() - 1;
-                treeTraversal[traverseIndex]->setSelected(true);
+                skeleton.setSelected(traverseIndex, false);
+                traverseIndex = skeleton.getJointCount() - 1;
+                skeleton.setSelected(traverseIndex, true);
             }
             else if(traverseIndex == -1)
             {
-                traverseIndex = treeTraversal.size() - 1;
-                treeTraversal[traverseIndex]->setSelected(true);
+                traverseIndex = skeleton.getJointCount() - 1;
+                skeleton.setSelected(traverseIndex, true);
                 
             }
             else
             {
-                treeTraversal[traverseIndex]->setSelected(false);
+                skeleton.setSelected(traverseIndex, false);
                 traverseIndex -= 1;
-                treeTraversal[traverseIndex]->setSelected(true);
+                skeleton.setSelected(traverseIndex, true);
                 
             }
                         
@@ -203,6 +207,52 @@ static void char_callback(GLFWwindow *window, unsigned int key)
 
 
 
+// Builds the robot under torso and flattens it into skeleton
+static void buildRobot()
+{
+    // Creating Components and initializing them
+    
+    
+    
+    Component* head = new Component(glm::vec3 (0.0f, 2.2f, 0.0f),glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (1.0f, 1.0f, 1.0f));
+    
+    
+    Component* UpperLeftArm = new Component(glm::vec3 (-1.0f, 1.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (2.0f, 0.55f, 0.4f));
+    Component* LowerLeftArm = new Component(glm::vec3 (-2.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (2.0f, 0.4f, 0.4f));
+    
+
+    Component* UpperRightArm = new Component(glm::vec3 (1.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (2.0f, 0.55f, 0.4f));
+    Component* LowerRightArm = new Component(glm::vec3 (2.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (2.0f, 0.4f, 0.4f));
+
+
+    
+    Component* UpperLeftLeg = new Component(glm::vec3 (-0.25f, -1.6f, 0.0f),glm::vec3 (-0.25f, -1.6f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f),  glm::vec3 (0.9f, 3.0f, 1.0f));
+    Component* LowerLeftLeg = new Component(glm::vec3 (-0.3f, -3.0f, 0.0f),glm::vec3 (-0.12f, -1.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f),  glm::vec3 (0.5f, 2.0f, 0.5f));
+    
+    
+    Component* UpperRightLeg = new Component(glm::vec3 (0.25f, -1.6f, 0.0f),glm::vec3 (0.25f, -1.6f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f),  glm::vec3 (0.9f, 3.0f, 1.0f));
+    Component* LowerRightLeg = new Component(glm::vec3 (0.3f, -3.0f, 0.0f),glm::vec3 (0.12f, -1.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f),  glm::vec3 (0.5f, 2.0f, 0.5f));
+    
+    
+    UpperLeftArm->addChild(LowerLeftArm);
+    UpperRightArm->addChild(LowerRightArm);
+    
+    UpperLeftLeg->addChild(LowerLeftLeg);
+    UpperRightLeg->addChild(LowerRightLeg);
+    
+    UpperRightArm->setPermaRotate(true);
+    LowerLeftArm->setPermaRotate(true);
+    
+    
+    torso.addChild(head);
+    torso.addChild(UpperLeftArm);
+    torso.addChild(UpperRightArm);
+    torso.addChild(UpperLeftLeg);
+    torso.addChild(UpperRightLeg);
+    
+    skeleton.build(torso);
+}
+
 // This function is called once to initialize the scene and OpenGL
 static void init()
 {
@@ -340,59 +390,7 @@ static void init()
 	
 	GLSL::checkError(GET_FILE_LINE);
     
-    // Creating Components and initializing them
-    
-    
-    
-    Component* head = new Component(glm::vec3 (0.0f, 2.2f, 0.0f),glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (1.0f, 1.0f, 1.0f));
-    
-    
-    Component* UpperLeftArm = new Component(glm::vec3 (-1.0f, 1.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (2.0f, 0.55f, 0.4f));
-    Component* LowerLeftArm = new Component(glm::vec3 (-2.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (2.0f, 0.4f, 0.4f));
-    
-
-    Component* UpperRightArm = new Component(glm::vec3 (1.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (2.0f, 0.55f, 0.4f));
-    Component* LowerRightArm = new Component(glm::vec3 (2.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (2.0f, 0.4f, 0.4f));
-
-
-    
-    Component* UpperLeftLeg = new Component(glm::vec3 (-0.25f, -1.6f, 0.0f),glm::vec3 (-0.25f, -1.6f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f),  glm::vec3 (0.9f, 3.0f, 1.0f));
-    Component* LowerLeftLeg = new Component(glm::vec3 (-0.3f, -3.0f, 0.0f),glm::vec3 (-0.12f, -1.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f),  glm::vec3 (0.5f, 2.0f, 0.5f));
-    
-    
-    Component* UpperRightLeg = new Component(glm::vec3 (0.25f, -1.6f, 0.0f),glm::vec3 (0.25f, -1.6f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f),  glm::vec3 (0.9f, 3.0f, 1.0f));
-    Component* LowerRightLeg = new Component(glm::vec3 (0.3f, -3.0f, 0.0f),glm::vec3 (0.12f, -1.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 0.0f),  glm::vec3 (0.5f, 2.0f, 0.5f));
-    
-    
-    UpperLeftArm->addChild(LowerLeftArm);
-    UpperRightArm->addChild(LowerRightArm);
-    
-    UpperLeftLeg->addChild(LowerLeftLeg);
-    UpperRightLeg->addChild(LowerRightLeg);
-    
-    UpperRightArm->setPermaRotate(true);
-    LowerLeftArm->setPermaRotate(true);
-    
-    
-    torso.addChild(head);
-    torso.addChild(UpperLeftArm);
-    torso.addChild(UpperRightArm);
-    torso.addChild(UpperLeftLeg);
-    torso.addChild(UpperRightLeg);
-    
-    std::stack<Component*> stack;
-    stack.push(&torso);
-
-    while (!stack.empty()) {
-        Component* current = stack.top();
-        stack.pop();
-        treeTraversal.push_back(current);
-
-        // Push children in reverse order to maintain the correct order of traversal
-        for (int i = current->getChildren().size() - 1; i >= 0; i--) {
-            stack.push(current->getChildren()[i]);
-        }
-    }
+    buildRobot();
     
     
     
@@ -444,7 +442,8 @@ static void render()
     glm::vec3 myVector(0.0f, 0.0f, -15.0f);
     MV.translate(myVector);
     double t = glfwGetTime();
-    torso.draw(MV, unifIDs, indCount, t);
+    skeleton.update();
+    skeleton.draw(MV, unifIDs["MV"], indCount, t);
         
     MV.popMatrix(); // Global level
 
@@ -466,6 +465,17 @@ int main(int argc, char **argv)
 {
 	if(argc < 2) {
 		cout << "Please specify the resource directory." << endl;
+		cout << "Usage: A2 RESOURCE_DIR [stackbench|fkbench]" << endl;
+		return 0;
+	}
+	if(argc >= 3 && string(argv[2]) == "stackbench") {
+		Benchmarks::matrixStack();
+		return 0;
+	}
+	if(argc >= 3 && string(argv[2]) == "fkbench") {
+		// The robot without a window
+		buildRobot();
+		Benchmarks::forwardKinematics(torso);
 		return 0;
 	}
 	RESOURCE_DIR = argv[1] + string("/");
@@ -1,7 +1,9 @@
 #include "Program.h"
 
+#include <algorithm>
 #include <iostream>
 #include <cassert>
+#include <cstring>
 
 #include "GLSL.h"
 
@@ -11,6 +13,7 @@ Program::Program() :
 	vShaderName(""),
 	fShaderName(""),
 	pid(0),
+	linkId(0),
 	verbose(true)
 {
 	
@@ -77,6 +80,9 @@ bool Program::init()
 		return false;
 	}
 	
+	reflect();
+	static unsigned links = 0;
+	linkId = ++links;
 	GLSL::checkError(GET_FILE_LINE);
 	return true;
 }
@@ -91,36 +97,111 @@ void Program::unbind()
 	glUseProgram(0);
 }
 
-void Program::addAttribute(const string &name)
+template<typename H>
+const H *Program::find(const vector<Variable<H> > &vars, const Name &name)
 {
-	attributes[name] = glGetAttribLocation(pid, name.c_str());
+	// Equal hashes are next to each other; the names tell them apart.
+	typename vector<Variable<H> >::const_iterator v = lower_bound(vars.begin(), vars.end(), name.hash,
+		[](const Variable<H> &a, uint32_t key) { return a.key < key; });
+	for(; v != vars.end() && v->key == name.hash; ++v) {
+		if(strcmp(v->name.c_str(), name.str) == 0) {
+			return &v->handle;
+		}
+	}
+	return 0;
+}
+
+template<typename H>
+void Program::insert(vector<Variable<H> > &vars, const string &name, const H &handle)
+{
+	Variable<H> v;
+	v.key = Name::hashOf(name.c_str());
+	v.name = name;
+	v.handle = handle;
+	vars.insert(upper_bound(vars.begin(), vars.end(), v,
+		[](const Variable<H> &a, const Variable<H> &b) { return a.key < b.key; }), v);
+}
+
+void Program::reflect()
+{
+	attributes.clear();
+	uniforms.clear();
+	GLint count = 0;
+	GLint maxLength = 0;
+	GLsizei length = 0;
+	
+	// Uniforms. An array is reported once, as its first element.
+	glGetProgramiv(pid, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(pid, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	vector<char> buf(max(maxLength, 1));
+	for(GLint i = 0; i < count; ++i) {
+		Uniform u;
+		glGetActiveUniform(pid, (GLuint)i, (GLsizei)buf.size(), &length, &u.size, &u.type, &buf[0]);
+		string name(&buf[0], length);
+		if(name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+			name.resize(name.size() - 3);
+		}
+		// -1 for the members of uniform blocks, which aren't set this way
+		u.location = glGetUniformLocation(pid, name.c_str());
+		if(u.location != -1) {
+			insert(uniforms, name, u);
+		}
+	}
+	
+	// Attributes, leaving out the built-in gl_ ones that have no location
+	glGetProgramiv(pid, GL_ACTIVE_ATTRIBUTES, &count);
+	glGetProgramiv(pid, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+	buf.resize(max(maxLength, 1));
+	for(GLint i = 0; i < count; ++i) {
+		Attribute a;
+		glGetActiveAttrib(pid, (GLuint)i, (GLsizei)buf.size(), &length, &a.size, &a.type, &buf[0]);
+		string name(&buf[0], length);
+		a.location = glGetAttribLocation(pid, name.c_str());
+		if(a.location != -1) {
+			insert(attributes, name, a);
+		}
+	}
 }
 
-void Program::addUniform(const string &name)
+void Program::addAttribute(Name name)
 {
-	uniforms[name] = glGetUniformLocation(pid, name.c_str());
+	if(!find(attributes, name)) {
+		Attribute a;
+		a.location = glGetAttribLocation(pid, name.str);
+		insert(attributes, name.str, a);
+	}
+}
+
+void Program::addUniform(Name name)
+{
+	// Also takes an element of an array, "a[2]", which reflect() doesn't list
+	if(!find(uniforms, name)) {
+		Uniform u;
+		u.location = glGetUniformLocation(pid, name.str);
+		insert(uniforms, name.str, u);
+	}
 }
 
-GLint Program::getAttribute(const string &name) const
+Program::Attribute Program::getAttribute(Name name) const
 {
-	map<string,GLint>::const_iterator attribute = attributes.find(name.c_str());
-	if(attribute == attributes.end()) {
+	const Attribute *attribute = find(attributes, name);
+	if(!attribute) {
 		if(isVerbose()) {
-			cout << name << " is not an attribute variable" << endl;
+			cout << name.str << " is not an attribute variable" << endl;
 		}
-		return -1;
+		return Attribute();
 	}
-	return attribute->second;
+	return *attribute;
 }
 
-GLint Program::getUniform(const string &name) const
+Program::Uniform Program::getUniform(Name name) const
 {
-	map<string,GLint>::const_iterator uniform = uniforms.find(name.c_str());
-	if(uniform == uniforms.end()) {
+	const Uniform *uniform = find(uniforms, name);
+	if(!uniform) {
 		if(isVerbose()) {
-			cout << name << " is not a uniform variable" << endl;
+			cout << name.str << " is not a uniform variable" << endl;
 		}
-		return -1;
+		return Uniform();
 	}
-	return uniform->second;
+	return *uniform;
 }
@@ -13,6 +13,15 @@
 
 using namespace std;
 
+namespace {
+
+// Looked up on every draw, so hashed at compile time
+constexpr Program::Name A_POS("aPos");
+constexpr Program::Name A_NOR("aNor");
+constexpr Program::Name A_TEX("aTex");
+
+}
+
 Shape::Shape() :
 	posBufID(0),
 	norBufID(0),
@@ -127,13 +136,13 @@ void Shape::init()
 void Shape::draw(const shared_ptr<Program> prog) const
 {
 	// Bind position buffer
-	int h_pos = prog->getAttribute("aPos");
+	int h_pos = prog->getAttribute(A_POS);
 	glEnableVertexAttribArray(h_pos);
 	glBindBuffer(GL_ARRAY_BUFFER, posBufID);
 	glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
 	
 	// Bind normal buffer
-	int h_nor = prog->getAttribute("aNor");
+	int h_nor = prog->getAttribute(A_NOR);
 	if(h_nor != -1 && norBufID != 0) {
 		glEnableVertexAttribArray(h_nor);
 		glBindBuffer(GL_ARRAY_BUFFER, norBufID);
@@ -141,7 +150,7 @@ void Shape::draw(const shared_ptr<Program> prog) const
 	}
 	
 	// Bind texcoords buffer
-	int h_tex = prog->getAttribute("aTex");
+	int h_tex = prog->getAttribute(A_TEX);
 	if(h_tex != -1 && texBufID != 0) {
 		glEnableVertexAttribArray(h_tex);
 		glBindBuffer(GL_ARRAY_BUFFER, texBufID);
@@ -67,6 +67,22 @@ shared_ptr<Program> prog;
 shared_ptr<Program> prog2; // <-- Blinn - Phong
 shared_ptr<Program> prog3; // <-- Silhoette Shader
 shared_ptr<Program> prog4; // <-- Cell Shader
+
+// The uniforms render() sets, by name hashed at compile time
+namespace unif {
+constexpr Program::Name P("P");
+constexpr Program::Name MV("MV");
+constexpr Program::Name invTransposeMV("invTransposeMV");
+constexpr Program::Name lightPos("lightPos");
+constexpr Program::Name light1position("light1position");
+constexpr Program::Name light1color("light1color");
+constexpr Program::Name light2position("light2position");
+constexpr Program::Name light2color("light2color");
+constexpr Program::Name ka("ka");
+constexpr Program::Name kd("kd");
+constexpr Program::Name ks("ks");
+constexpr Program::Name s("s");
+}
 shared_ptr<Shape> shape;
 shared_ptr<Shape> teapot;
 
@@ -461,9 +477,9 @@ static void render()
         glm::mat4 invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
         
         
-        glUniformMatrix4fv(prog2->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog2->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
-        glUniformMatrix4fv(prog2->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
+        glUniformMatrix4fv(prog2->getUniform(unif::P), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
+        glUniformMatrix4fv(prog2->getUniform(unif::MV), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
+        glUniformMatrix4fv(prog2->getUniform(unif::invTransposeMV), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
         
         shape->draw(prog2);
         MV->popMatrix();
@@ -485,28 +501,28 @@ static void render()
             
         invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
         
-        glUniformMatrix4fv(prog2->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog2->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
-        glUniformMatrix4fv(prog2->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
+        glUniformMatrix4fv(prog2->getUniform(unif::P), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
+        glUniformMatrix4fv(prog2->getUniform(unif::MV), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
+        glUniformMatrix4fv(prog2->getUniform(unif::invTransposeMV), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
         
         teapot->draw(prog2);
         MV->popMatrix();
         
         // end draw teapot
         
-        glUniform3f(prog2->getUniform("lightPos"), 1.0f, 1.0f, 1.0f);
+        glUniform3f(prog2->getUniform(unif::lightPos), 1.0f, 1.0f, 1.0f);
         // Lights
         
-        glUniform3f(prog2->getUniform("light1position"), lights[0].position.x,  lights[0].position.y,  lights[0].position.z);
-        glUniform3f(prog2->getUniform("light1color"), lights[0].color.r,  lights[0].color.g,  lights[0].color.b);
+        glUniform3f(prog2->getUniform(unif::light1position), lights[0].position.x,  lights[0].position.y,  lights[0].position.z);
+        glUniform3f(prog2->getUniform(unif::light1color), lights[0].color.r,  lights[0].color.g,  lights[0].color.b);
         
-        glUniform3f(prog2->getUniform("light2position"), lights[1].position.x,  lights[1].position.y,  lights[1].position.z);
-        glUniform3f(prog2->getUniform("light2color"), lights[1].color.r,  lights[1].color.g,  lights[1].color.b);
+        glUniform3f(prog2->getUniform(unif::light2position), lights[1].position.x,  lights[1].position.y,  lights[1].position.z);
+        glUniform3f(prog2->getUniform(unif::light2color), lights[1].color.r,  lights[1].color.g,  lights[1].color.b);
         
-        glUniform3f(prog2->getUniform("ka"), materials[materialsIndex].ambient.r, materials[materialsIndex].ambient.g, materials[materialsIndex].ambient.b);
-        glUniform3f(prog2->getUniform("kd"), materials[materialsIndex].diffuse.r, materials[materialsIndex].diffuse.g, materials[materialsIndex].diffuse.b);
-        glUniform3f(prog2->getUniform("ks"), materials[materialsIndex].specular.r, materials[materialsIndex].specular.g, materials[materialsIndex].specular.b);
-        glUniform1f(prog2->getUniform("s"), materials[materialsIndex].shininess);
+        glUniform3f(prog2->getUniform(unif::ka), materials[materialsIndex].ambient.r, materials[materialsIndex].ambient.g, materials[materialsIndex].ambient.b);
+        glUniform3f(prog2->getUniform(unif::kd), materials[materialsIndex].diffuse.r, materials[materialsIndex].diffuse.g, materials[materialsIndex].diffuse.b);
+        glUniform3f(prog2->getUniform(unif::ks), materials[materialsIndex].specular.r, materials[materialsIndex].specular.g, materials[materialsIndex].specular.b);
+        glUniform1f(prog2->getUniform(unif::s), materials[materialsIndex].shininess);
         
         prog2->unbind();
     }
@@ -528,8 +544,8 @@ static void render()
         glm::mat4 invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
         
         
-        glUniformMatrix4fv(prog->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
+        glUniformMatrix4fv(prog->getUniform(unif::P), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
+        glUniformMatrix4fv(prog->getUniform(unif::MV), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
         shape->draw(prog);
         MV->popMatrix();
         // end draw bunny
@@ -550,8 +566,8 @@ static void render()
             
         invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
         
-        glUniformMatrix4fv(prog->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
+        glUniformMatrix4fv(prog->getUniform(unif::P), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
+        glUniformMatrix4fv(prog->getUniform(unif::MV), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
         
         teapot->draw(prog);
         MV->popMatrix();
@@ -577,9 +593,9 @@ static void render()
         glm::mat4 invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
         
         
-        glUniformMatrix4fv(prog3->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog3->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
-        glUniformMatrix4fv(prog3->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
+        glUniformMatrix4fv(prog3->getUniform(unif::P), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
+        glUniformMatrix4fv(prog3->getUniform(unif::MV), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
+        glUniformMatrix4fv(prog3->getUniform(unif::invTransposeMV), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
         
         shape->draw(prog3);
         MV->popMatrix();
@@ -602,9 +618,9 @@ static void render()
             
         invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
         
-        glUniformMatrix4fv(prog3->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog3->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
-        glUniformMatrix4fv(prog3->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
+        glUniformMatrix4fv(prog3->getUniform(unif::P), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
+        glUniformMatrix4fv(prog3->getUniform(unif::MV), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
+        glUniformMatrix4fv(prog3->getUniform(unif::invTransposeMV), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
         
         teapot->draw(prog3);
         MV->popMatrix();
@@ -630,9 +646,9 @@ static void render()
         glm::mat4 invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
         
         
-        glUniformMatrix4fv(prog4->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog4->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
-        glUniformMatrix4fv(prog4->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
+        glUniformMatrix4fv(prog4->getUniform(unif::P), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
+        glUniformMatrix4fv(prog4->getUniform(unif::MV), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
+        glUniformMatrix4fv(prog4->getUniform(unif::invTransposeMV), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
         
         shape->draw(prog4);
         MV->popMatrix();
@@ -655,28 +671,28 @@ static void render()
             
         invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
         
-        glUniformMatrix4fv(prog4->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog4->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
-        glUniformMatrix4fv(prog4->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
+        glUniformMatrix4fv(prog4->getUniform(unif::P), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
+        glUniformMatrix4fv(prog4->getUniform(unif::MV), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
+        glUniformMatrix4fv(prog4->getUniform(unif::invTransposeMV), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
         
         teapot->draw(prog4);
         MV->popMatrix();
         
         // end draw teapot
         
-        glUniform3f(prog4->getUniform("lightPos"), 1.0f, 1.0f, 1.0f);
+        glUniform3f(prog4->getUniform(unif::lightPos), 1.0f, 1.0f, 1.0f);
         // Lights
         
-        glUniform3f(prog4->getUniform("light1position"), lights[0].position.x,  lights[0].position.y,  lights[0].position.z);
-        glUniform3f(prog4->getUniform("light1color"), lights[0].color.r,  lights[0].color.g,  lights[0].color.b);
+        glUniform3f(prog4->getUniform(unif::light1position), lights[0].position.x,  lights[0].position.y,  lights[0].position.z);
+        glUniform3f(prog4->getUniform(unif::light1color), lights[0].color.r,  lights[0].color.g,  lights[0].color.b);
         
-        glUniform3f(prog4->getUniform("light2position"), lights[1].position.x,  lights[1].position.y,  lights[1].position.z);
-        glUniform3f(prog4->getUniform("light2color"), lights[1].color.r,  lights[1].color.g,  lights[1].color.b);
+        glUniform3f(prog4->getUniform(unif::light2position), lights[1].position.x,  lights[1].position.y,  lights[1].position.z);
+        glUniform3f(prog4->getUniform(unif::light2color), lights[1].color.r,  lights[1].color.g,  lights[1].color.b);
         
-        glUniform3f(prog4->getUniform("ka"), materials[materialsIndex].ambient.r, materials[materialsIndex].ambient.g, materials[materialsIndex].ambient.b);
-        glUniform3f(prog4->getUniform("kd"), materials[materialsIndex].diffuse.r, materials[materialsIndex].diffuse.g, materials[materialsIndex].diffuse.b);
-        glUniform3f(prog4->getUniform("ks"), materials[materialsIndex].specular.r, materials[materialsIndex].specular.g, materials[materialsIndex].specular.b);
-        glUniform1f(prog4->getUniform("s"), materials[materialsIndex].shininess);
+        glUniform3f(prog4->getUniform(unif::ka), materials[materialsIndex].ambient.r, materials[materialsIndex].ambient.g, materials[materialsIndex].ambient.b);
+        glUniform3f(prog4->getUniform(unif::kd), materials[materialsIndex].diffuse.r, materials[materialsIndex].diffuse.g, materials[materialsIndex].diffuse.b);
+        glUniform3f(prog4->getUniform(unif::ks), materials[materialsIndex].specular.r, materials[materialsIndex].specular.g, materials[materialsIndex].specular.b);
+        glUniform1f(prog4->getUniform(unif::s), materials[materialsIndex].shininess);
         
         prog4->unbind();
     }
@@ -0,0 +1,30 @@
+#version 120
+
+uniform vec3 light1position; // in camera coordinates
+uniform vec3 light1color;
+
+varying vec3 fragPos; // passed from the vertex shader
+varying vec3 normalCam; // passed from the vertex shader
+varying vec3 ka; // material of the instance
+varying vec3 kd;
+varying vec3 ks;
+varying float s;
+
+// frag.glsl, with the material passed down per instance
+void main()
+{
+    vec3 n = normalize(normalCam);
+    vec3 viewDirCam = normalize(-fragPos);
+    
+    vec3 ca = ka;
+    
+    vec3 lightDirCam = normalize(light1position - fragPos);
+    float diffuse = max(0.0, dot(lightDirCam, n));
+    vec3 cd = kd * diffuse;
+    
+    vec3 h = normalize(lightDirCam + viewDirCam);
+    float specular = pow(max(0.0, dot(h, n)), s);
+    vec3 cs = ks * specular;
+    
+    gl_FragColor = vec4(light1color*(ca + cd + cs), 1.0);
+}
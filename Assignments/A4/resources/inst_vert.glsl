@@ -0,0 +1,61 @@
+#version 120
+
+uniform mat4 P;
+uniform mat4 V; // the camera; each instance brings its own model matrix
+uniform mat4 invTransposeV;
+uniform float t;
+
+attribute vec4 aPos; // in object space
+attribute vec3 aNor; // in object space
+
+// Per instance, as SceneObject holds them (see InstanceBatch)
+attribute vec3 iTranslation;
+attribute vec3 iScale;
+attribute vec4 iAnim; // pulses scale, scale phase, shears, spins (1 or 0)
+attribute mat3 iRotation;
+attribute vec3 iKa;
+attribute vec3 iKd;
+attribute vec4 iKs; // and the shininess
+
+varying vec3 fragPos; // in camera space
+varying vec3 normalCam; // in camera space
+varying vec3 ka;
+varying vec3 kd;
+varying vec3 ks;
+varying float s;
+
+const float PI = 3.14159265358979;
+
+void main()
+{
+    // SceneObject::draw(): translate, scale, shear, rotate, then spin about y
+    mat3 M = iRotation;
+    if (iAnim.w > 0.5) {
+        float c = cos(t);
+        float sn = sin(t);
+        M = M * mat3(c, 0.0, -sn, 0.0, 1.0, 0.0, sn, 0.0, c);
+    }
+    if (iAnim.z > 0.5) {
+        mat3 S = mat3(1.0);
+        S[1][0] = 0.5 * cos(t * 2.0);
+        M = S * M;
+    }
+    vec3 scale = iScale;
+    if (iAnim.x > 0.5) {
+        scale *= 1.075 + 0.075 * sin(2.0 * PI * 0.2 * (t + iAnim.y));
+    }
+    M = mat3(scale.x, 0.0, 0.0, 0.0, scale.y, 0.0, 0.0, 0.0, scale.z) * M;
+
+    vec4 posCam = V * vec4(M * aPos.xyz + iTranslation, 1.0);
+    gl_Position = P * posCam;
+    fragPos = posCam.xyz;
+
+    // Inverse transpose of M from the cross products of its columns, leaving
+    // out the determinant: it is positive and only changes the length.
+    mat3 N = mat3(cross(M[1], M[2]), cross(M[2], M[0]), cross(M[0], M[1]));
+    normalCam = normalize((invTransposeV * vec4(N * aNor, 0.0)).xyz);
+    ka = iKa;
+    kd = iKd;
+    ks = iKs.rgb;
+    s = iKs.a;
+}
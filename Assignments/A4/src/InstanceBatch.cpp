@@ -0,0 +1,158 @@
+#include "InstanceBatch.h"
+
+#include <cstddef>
+
+#include "GLSL.h"
+#include "Shape.h"
+
+using namespace std;
+
+namespace {
+
+constexpr Program::Name I_TRANSLATION("iTranslation");
+constexpr Program::Name I_SCALE("iScale");
+constexpr Program::Name I_ANIM("iAnim");
+constexpr Program::Name I_ROTATION("iRotation");
+constexpr Program::Name I_KA("iKa");
+constexpr Program::Name I_KD("iKd");
+constexpr Program::Name I_KS("iKs");
+
+void vertexAttribDivisor(GLuint index, GLuint divisor)
+{
+	if(GLEW_VERSION_3_3) {
+		glVertexAttribDivisor(index, divisor);
+	} else {
+		glVertexAttribDivisorARB(index, divisor);
+	}
+}
+
+}
+
+InstanceBatch::InstanceBatch() :
+	instanceCount(0),
+	bufID(0),
+	attribLink(0)
+{
+}
+
+InstanceBatch::~InstanceBatch()
+{
+	release();
+}
+
+bool InstanceBatch::isSupported()
+{
+	return GLEW_VERSION_3_3 || (GLEW_ARB_instanced_arrays && (GLEW_VERSION_3_1 || GLEW_ARB_draw_instanced));
+}
+
+void InstanceBatch::clear()
+{
+	groups.clear();
+	instanceCount = 0;
+}
+
+void InstanceBatch::release()
+{
+	clear();
+	if(bufID) {
+		glDeleteBuffers(1, &bufID);
+		bufID = 0;
+	}
+}
+
+void InstanceBatch::add(const shared_ptr<Shape> &shape, const Instance &instance)
+{
+	// A handful of shapes, so a linear search
+	size_t g = 0;
+	while(g < groups.size() && groups[g].shape != shape) {
+		++g;
+	}
+	if(g == groups.size()) {
+		Group group;
+		group.shape = shape;
+		group.first = 0;
+		group.count = 0;
+		groups.push_back(group);
+	}
+	groups[g].instances.push_back(instance);
+	++instanceCount;
+}
+
+void InstanceBatch::upload()
+{
+	vector<Instance> all;
+	all.reserve(instanceCount);
+	for(size_t g = 0; g < groups.size(); ++g) {
+		Group &group = groups[g];
+		group.first = all.size();
+		group.count = (int)group.instances.size();
+		all.insert(all.end(), group.instances.begin(), group.instances.end());
+		vector<Instance>().swap(group.instances);
+	}
+	if(bufID == 0) {
+		glGenBuffers(1, &bufID);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, bufID);
+	glBufferData(GL_ARRAY_BUFFER, all.size()*sizeof(Instance), all.empty() ? nullptr : &all[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLSL::checkError(GET_FILE_LINE);
+}
+
+size_t InstanceBatch::draw(const shared_ptr<Program> prog) const
+{
+	if(prog->getLinkId() != attribLink) {
+		attribLink = prog->getLinkId();
+		h_translation = prog->getAttribute(I_TRANSLATION);
+		h_scale = prog->getAttribute(I_SCALE);
+		h_anim = prog->getAttribute(I_ANIM);
+		h_rotation = prog->getAttribute(I_ROTATION);
+		h_ka = prog->getAttribute(I_KA);
+		h_kd = prog->getAttribute(I_KD);
+		h_ks = prog->getAttribute(I_KS);
+	}
+	// (location, components, offset in Instance); the mat3 takes three
+	// locations, one per column.
+	struct Binding { GLint location; GLint size; size_t offset; };
+	Binding bindings[9] = {
+		{h_translation, 3, offsetof(Instance, translation)},
+		{h_scale, 3, offsetof(Instance, scale)},
+		{h_anim, 4, offsetof(Instance, anim)},
+		{h_rotation, 3, offsetof(Instance, rotation)},
+		{h_rotation.isActive() ? h_rotation + 1 : -1, 3, offsetof(Instance, rotation) + 3*sizeof(float)},
+		{h_rotation.isActive() ? h_rotation + 2 : -1, 3, offsetof(Instance, rotation) + 6*sizeof(float)},
+		{h_ka, 3, offsetof(Instance, ka)},
+		{h_kd, 3, offsetof(Instance, kd)},
+		{h_ks, 4, offsetof(Instance, ks)},
+	};
+	for(const Binding &b : bindings) {
+		if(b.location != -1) {
+			glEnableVertexAttribArray(b.location);
+			vertexAttribDivisor(b.location, 1);
+		}
+	}
+	size_t triangles = 0;
+	for(size_t g = 0; g < groups.size(); ++g) {
+		const Group &group = groups[g];
+		// Shape::drawInstanced() binds its own buffers, so the pointers into
+		// this one are set first, starting at the group's instances.
+		glBindBuffer(GL_ARRAY_BUFFER, bufID);
+		for(const Binding &b : bindings) {
+			if(b.location != -1) {
+				size_t offset = group.first*sizeof(Instance) + b.offset;
+				glVertexAttribPointer(b.location, b.size, GL_FLOAT, GL_FALSE, sizeof(Instance), (const void *)offset);
+			}
+		}
+		group.shape->drawInstanced(prog, group.count);
+		triangles += group.shape->getTriangleCount()*group.count;
+	}
+	// Divisors stay with the locations, which other programs reuse.
+	for(const Binding &b : bindings) {
+		if(b.location != -1) {
+			vertexAttribDivisor(b.location, 0);
+			glDisableVertexAttribArray(b.location);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLSL::checkError(GET_FILE_LINE);
+	return triangles;
+}
@@ -2,49 +2,87 @@
 
 #include <stdio.h>
 #include <cassert>
-#include <vector>
+#include <cmath>
 
-#define GLM_FORCE_RADIANS
-#include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 using namespace std;
 
-MatrixStack::MatrixStack()
+MatrixStack::MatrixStack() :
+	depth(0),
+	topValid(false)
 {
-	mstack = make_shared< stack<glm::mat4> >();
-	mstack->push(glm::mat4(1.0));
+	loadIdentity();
 }
 
 MatrixStack::~MatrixStack()
 {
 }
 
+void MatrixStack::set(Entry &e, const glm::mat4 &m)
+{
+	for(int j = 0; j < 4; ++j) {
+		e.col[j] = glm::vec3(m[j]);
+		e.row[j] = m[j][3];
+	}
+	e.projective = e.row != glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+glm::mat4 MatrixStack::expand(const Entry &e) const
+{
+	glm::mat4 m;
+	for(int j = 0; j < 4; ++j) {
+		m[j] = glm::vec4(e.col[j], e.row[j]);
+	}
+	return m;
+}
+
 void MatrixStack::pushMatrix()
 {
-	const glm::mat4 &top = mstack->top();
-	mstack->push(top);
-	assert(mstack->size() < 100);
+	assert(depth + 1 < CAPACITY);
+	if(depth + 1 >= CAPACITY) {
+		fprintf(stderr, "MatrixStack: more than %d matrices pushed, push ignored\n", CAPACITY);
+		return;
+	}
+	entries[depth + 1] = entries[depth];
+	++depth;
+	// The top matrix is the same, so the expanded copy still holds.
 }
 
 void MatrixStack::popMatrix()
 {
-	assert(!mstack->empty());
-	mstack->pop();
 	// There should always be one matrix left.
-	assert(!mstack->empty());
+	assert(depth > 0);
+	if(depth <= 0) {
+		fprintf(stderr, "MatrixStack: pop of the last matrix ignored\n");
+		return;
+	}
+	--depth;
+	topValid = false;
 }
 
 void MatrixStack::loadIdentity()
 {
-	glm::mat4 &top = mstack->top();
-	top = glm::mat4(1.0);
+	Entry &e = entries[depth];
+	e.col[0] = glm::vec3(1.0f, 0.0f, 0.0f);
+	e.col[1] = glm::vec3(0.0f, 1.0f, 0.0f);
+	e.col[2] = glm::vec3(0.0f, 0.0f, 1.0f);
+	e.col[3] = glm::vec3(0.0f);
+	e.row = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	e.projective = false;
+	topValid = false;
 }
 
 void MatrixStack::translate(const glm::vec3 &t)
 {
-	glm::mat4 &top = mstack->top();
-	top *= glm::translate(glm::mat4(1.0f), t);
+	Entry &e = entries[depth];
+	if(e.projective) {
+		set(e, expand(e)*glm::translate(glm::mat4(1.0f), t));
+	} else {
+		// Only the last column: M (t, 1)
+		e.col[3] += e.col[0]*t.x + e.col[1]*t.y + e.col[2]*t.z;
+	}
+	topValid = false;
 }
 
 void MatrixStack::translate(float x, float y, float z)
@@ -54,8 +92,15 @@ void MatrixStack::translate(float x, float y, float z)
 
 void MatrixStack::scale(const glm::vec3 &s)
 {
-	glm::mat4 &top = mstack->top();
-	top *= glm::scale(glm::mat4(1.0f), s);
+	// Scales the first three columns, and the bottom row under them.
+	Entry &e = entries[depth];
+	e.col[0] *= s.x;
+	e.col[1] *= s.y;
+	e.col[2] *= s.z;
+	e.row.x *= s.x;
+	e.row.y *= s.y;
+	e.row.z *= s.z;
+	topValid = false;
 }
 
 void MatrixStack::scale(float x, float y, float z)
@@ -70,8 +115,43 @@ void MatrixStack::scale(float s)
 
 void MatrixStack::rotate(float angle, const glm::vec3 &axis)
 {
-	glm::mat4 &top = mstack->top();
-	top *= glm::rotate(glm::mat4(1.0f), angle, axis);
+	Entry &e = entries[depth];
+	topValid = false;
+	if(e.projective) {
+		set(e, expand(e)*glm::rotate(glm::mat4(1.0f), angle, axis));
+		return;
+	}
+	float c = cos(angle);
+	float s = sin(angle);
+	glm::vec3 a0 = e.col[0];
+	glm::vec3 a1 = e.col[1];
+	glm::vec3 a2 = e.col[2];
+	// About a coordinate axis, only the other two columns change.
+	if(axis == glm::vec3(1.0f, 0.0f, 0.0f)) {
+		e.col[1] = a1*c + a2*s;
+		e.col[2] = a2*c - a1*s;
+		return;
+	}
+	if(axis == glm::vec3(0.0f, 1.0f, 0.0f)) {
+		e.col[0] = a0*c - a2*s;
+		e.col[2] = a0*s + a2*c;
+		return;
+	}
+	if(axis == glm::vec3(0.0f, 0.0f, 1.0f)) {
+		e.col[0] = a0*c + a1*s;
+		e.col[1] = a1*c - a0*s;
+		return;
+	}
+	// Rodrigues' rotation matrix, as glm::rotate() builds it, times the
+	// linear part
+	glm::vec3 n = glm::normalize(axis);
+	glm::vec3 k = (1.0f - c)*n;
+	glm::vec3 r0(c + k.x*n.x, k.x*n.y + s*n.z, k.x*n.z - s*n.y);
+	glm::vec3 r1(k.y*n.x - s*n.z, c + k.y*n.y, k.y*n.z + s*n.x);
+	glm::vec3 r2(k.z*n.x + s*n.y, k.z*n.y - s*n.x, c + k.z*n.z);
+	e.col[0] = a0*r0.x + a1*r0.y + a2*r0.z;
+	e.col[1] = a0*r1.x + a1*r1.y + a2*r1.z;
+	e.col[2] = a0*r2.x + a1*r2.y + a2*r2.z;
 }
 
 void MatrixStack::rotate(float angle, float x, float y, float z)
@@ -81,13 +161,40 @@ void MatrixStack::rotate(float angle, float x, float y, float z)
 
 void MatrixStack::multMatrix(const glm::mat4 &matrix)
 {
-	glm::mat4 &top = mstack->top();
-	top *= matrix;
+	Entry &e = entries[depth];
+	topValid = false;
+	bool affine = matrix[0][3] == 0.0f && matrix[1][3] == 0.0f && matrix[2][3] == 0.0f && matrix[3][3] == 1.0f;
+	if(e.projective || !affine) {
+		set(e, expand(e)*matrix);
+		return;
+	}
+	// 3x4 times 3x4, with the implied bottom rows
+	glm::vec3 a0 = e.col[0];
+	glm::vec3 a1 = e.col[1];
+	glm::vec3 a2 = e.col[2];
+	for(int j = 0; j < 3; ++j) {
+		e.col[j] = a0*matrix[j].x + a1*matrix[j].y + a2*matrix[j].z;
+	}
+	e.col[3] += a0*matrix[3].x + a1*matrix[3].y + a2*matrix[3].z;
 }
 
 const glm::mat4 &MatrixStack::topMatrix() const
 {
-	return mstack->top();
+	if(!topValid) {
+		top = expand(entries[depth]);
+		topValid = true;
+	}
+	return top;
+}
+
+glm::mat3 MatrixStack::normalMatrix() const
+{
+	const Entry &e = entries[depth];
+	glm::vec3 x = glm::cross(e.col[1], e.col[2]);
+	glm::vec3 y = glm::cross(e.col[2], e.col[0]);
+	glm::vec3 z = glm::cross(e.col[0], e.col[1]);
+	float invDet = 1.0f/glm::dot(e.col[0], x);
+	return glm::mat3(x*invDet, y*invDet, z*invDet);
 }
 
 void MatrixStack::print(const glm::mat4 &mat, const char *name)
@@ -110,5 +217,5 @@ void MatrixStack::print(const glm::mat4 &mat, const char *name)
 
 void MatrixStack::print(const char *name) const
 {
-	print(mstack->top(), name);
+	print(topMatrix(), name);
 }
@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include "GLSL.h"
+#include "MeshSimplifier.h"
 #include "Program.h"
 
 #define GLM_FORCE_RADIANS
@@ -13,10 +14,31 @@
 
 using namespace std;
 
+namespace {
+
+// Looked up whenever the program changes, so hashed at compile time
+constexpr Program::Name A_POS("aPos");
+constexpr Program::Name A_NOR("aNor");
+constexpr Program::Name A_TEX("aTex");
+
+}
+
 Shape::Shape() :
 	posBufID(0),
 	norBufID(0),
-	texBufID(0)
+	texBufID(0),
+	layout(PLANAR),
+	attributes(POSITION | NORMAL | TEXCOORD),
+	stride(0),
+	norOffset(-1),
+	texOffset(-1),
+	vertBufID(0),
+	sphereCenter(0.0f),
+	sphereRadius(0.0f),
+	attribLink(0),
+	h_pos(-1),
+	h_nor(-1),
+	h_tex(-1)
 {
 }
 
@@ -97,31 +119,143 @@ void Shape::fitToUnitBox()
 	}
 }
 
+void Shape::buildLods(const vector<float> &fractions)
+{
+	// The simplifier merges corners by position, so the triangle list goes in
+	// as is, one index per corner.
+	MeshSimplifier::Mesh mesh;
+	mesh.posBuf = posBuf;
+	mesh.norBuf = norBuf;
+	mesh.texBuf = texBuf;
+	mesh.eleBuf.resize(posBuf.size()/3);
+	for(size_t i = 0; i < mesh.eleBuf.size(); ++i) {
+		mesh.eleBuf[i] = (unsigned int)i;
+	}
+	vector<size_t> targets;
+	for(float f : fractions) {
+		targets.push_back((size_t)(f*getTriangleCount()));
+	}
+	lods.clear();
+	for(const MeshSimplifier::Mesh &m : MeshSimplifier::simplify(mesh, targets)) {
+		// Back to a triangle list
+		auto lod = make_shared<Shape>();
+		for(unsigned int v : m.eleBuf) {
+			lod->posBuf.insert(lod->posBuf.end(), &m.posBuf[3*v], &m.posBuf[3*v] + 3);
+			if(!m.norBuf.empty()) {
+				lod->norBuf.insert(lod->norBuf.end(), &m.norBuf[3*v], &m.norBuf[3*v] + 3);
+			}
+			if(!m.texBuf.empty()) {
+				lod->texBuf.insert(lod->texBuf.end(), &m.texBuf[2*v], &m.texBuf[2*v] + 2);
+			}
+		}
+		lods.push_back(lod);
+	}
+}
+
+const Shape &Shape::getLod(int level) const
+{
+	if(level <= 0 || lods.empty()) {
+		return *this;
+	}
+	return *lods[min(level, (int)lods.size()) - 1];
+}
+
+void Shape::getBoundingSphere(glm::vec3 &center, float &radius) const
+{
+	center = sphereCenter;
+	radius = sphereRadius;
+}
+
+void Shape::setLayout(Layout l, int a, int s)
+{
+	layout = l;
+	attributes = a | POSITION;
+	stride = s;
+}
+
 void Shape::init()
 {
-	// Send the position array to the GPU
-	glGenBuffers(1, &posBufID);
-	glBindBuffer(GL_ARRAY_BUFFER, posBufID);
-	glBufferData(GL_ARRAY_BUFFER, posBuf.size()*sizeof(float), &posBuf[0], GL_STATIC_DRAW);
-	
-	// Send the normal array to the GPU
-	if(!norBuf.empty()) {
-		glGenBuffers(1, &norBufID);
-		glBindBuffer(GL_ARRAY_BUFFER, norBufID);
-		glBufferData(GL_ARRAY_BUFFER, norBuf.size()*sizeof(float), &norBuf[0], GL_STATIC_DRAW);
+	// The vertices don't move after this
+	if(!posBuf.empty()) {
+		glm::vec3 vmin(posBuf[0], posBuf[1], posBuf[2]);
+		glm::vec3 vmax = vmin;
+		for(size_t i = 0; i < posBuf.size(); i += 3) {
+			glm::vec3 v(posBuf[i], posBuf[i+1], posBuf[i+2]);
+			vmin = glm::min(vmin, v);
+			vmax = glm::max(vmax, v);
+		}
+		sphereCenter = 0.5f*(vmin + vmax);
+		sphereRadius = 0.5f*glm::length(vmax - vmin);
 	}
 	
-	// Send the texture array to the GPU
-	if(!texBuf.empty()) {
-		glGenBuffers(1, &texBufID);
-		glBindBuffer(GL_ARRAY_BUFFER, texBufID);
-		glBufferData(GL_ARRAY_BUFFER, texBuf.size()*sizeof(float), &texBuf[0], GL_STATIC_DRAW);
+	if(layout == INTERLEAVED) {
+		// Pack position, normal, and texture coords of each vertex together.
+		int floats = 3;
+		norOffset = -1;
+		texOffset = -1;
+		if((attributes & NORMAL) && !norBuf.empty()) {
+			norOffset = floats*sizeof(float);
+			floats += 3;
+		}
+		if((attributes & TEXCOORD) && !texBuf.empty()) {
+			texOffset = floats*sizeof(float);
+			floats += 2;
+		}
+		// A larger stride pads each vertex, e.g. to 32 bytes.
+		int strideFloats = max(floats, (stride + 3) / 4);
+		stride = strideFloats*sizeof(float);
+		size_t nverts = posBuf.size()/3;
+		vector<float> vertBuf(nverts*strideFloats, 0.0f);
+		for(size_t i = 0; i < nverts; ++i) {
+			float *v = &vertBuf[i*strideFloats];
+			v[0] = posBuf[3*i+0];
+			v[1] = posBuf[3*i+1];
+			v[2] = posBuf[3*i+2];
+			if(norOffset >= 0) {
+				float *n = v + norOffset/sizeof(float);
+				n[0] = norBuf[3*i+0];
+				n[1] = norBuf[3*i+1];
+				n[2] = norBuf[3*i+2];
+			}
+			if(texOffset >= 0) {
+				float *t = v + texOffset/sizeof(float);
+				t[0] = texBuf[2*i+0];
+				t[1] = texBuf[2*i+1];
+			}
+		}
+		glGenBuffers(1, &vertBufID);
+		glBindBuffer(GL_ARRAY_BUFFER, vertBufID);
+		glBufferData(GL_ARRAY_BUFFER, vertBuf.size()*sizeof(float), &vertBuf[0], GL_STATIC_DRAW);
+	} else {
+		// Send the position array to the GPU
+		glGenBuffers(1, &posBufID);
+		glBindBuffer(GL_ARRAY_BUFFER, posBufID);
+		glBufferData(GL_ARRAY_BUFFER, posBuf.size()*sizeof(float), &posBuf[0], GL_STATIC_DRAW);
+		
+		// Send the normal array to the GPU
+		if(!norBuf.empty()) {
+			glGenBuffers(1, &norBufID);
+			glBindBuffer(GL_ARRAY_BUFFER, norBufID);
+			glBufferData(GL_ARRAY_BUFFER, norBuf.size()*sizeof(float), &norBuf[0], GL_STATIC_DRAW);
+		}
+		
+		// Send the texture array to the GPU
+		if(!texBuf.empty()) {
+			glGenBuffers(1, &texBufID);
+			glBindBuffer(GL_ARRAY_BUFFER, texBufID);
+			glBufferData(GL_ARRAY_BUFFER, texBuf.size()*sizeof(float), &texBuf[0], GL_STATIC_DRAW);
+		}
 	}
 	
 	// Unbind the arrays
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	
 	GLSL::checkError(GET_FILE_LINE);
+	
+	for(auto &lod : lods) {
+		lod->setLayout(layout, attributes, stride);
+		lod->init();
+	}
 }
 
 float Shape::getMinY(){
@@ -140,15 +274,25 @@ float Shape::getMinY(){
 }
 
 void Shape::draw(const shared_ptr<Program> prog) const
+{
+	draw(prog, 0);
+}
+
+void Shape::drawInstanced(const shared_ptr<Program> prog, int instances) const
+{
+	if(instances > 0) {
+		draw(prog, instances);
+	}
+}
+
+void Shape::bindPlanar() const
 {
 	// Bind position buffer
-	int h_pos = prog->getAttribute("aPos");
 	glEnableVertexAttribArray(h_pos);
 	glBindBuffer(GL_ARRAY_BUFFER, posBufID);
 	glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
 	
 	// Bind normal buffer
-	int h_nor = prog->getAttribute("aNor");
 	if(h_nor != -1 && norBufID != 0) {
 		glEnableVertexAttribArray(h_nor);
 		glBindBuffer(GL_ARRAY_BUFFER, norBufID);
@@ -156,16 +300,54 @@ void Shape::draw(const shared_ptr<Program> prog) const
 	}
 	
 	// Bind texcoords buffer
-	int h_tex = prog->getAttribute("aTex");
 	if(h_tex != -1 && texBufID != 0) {
 		glEnableVertexAttribArray(h_tex);
 		glBindBuffer(GL_ARRAY_BUFFER, texBufID);
 		glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, 0, (const void *)0);
 	}
+}
+
+void Shape::bindInterleaved() const
+{
+	// One buffer, every attribute at its offset within the vertex
+	glBindBuffer(GL_ARRAY_BUFFER, vertBufID);
+	glEnableVertexAttribArray(h_pos);
+	glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, stride, (const void *)0);
+	if(h_nor != -1 && norOffset >= 0) {
+		glEnableVertexAttribArray(h_nor);
+		glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, stride, (const void *)(size_t)norOffset);
+	}
+	if(h_tex != -1 && texOffset >= 0) {
+		glEnableVertexAttribArray(h_tex);
+		glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, stride, (const void *)(size_t)texOffset);
+	}
+}
+
+void Shape::draw(const shared_ptr<Program> prog, int instances) const
+{
+	// Look the attributes up only when the program changes.
+	if(prog->getLinkId() != attribLink) {
+		attribLink = prog->getLinkId();
+		h_pos = prog->getAttribute(A_POS);
+		h_nor = prog->getAttribute(A_NOR);
+		h_tex = prog->getAttribute(A_TEX);
+	}
+	if(layout == INTERLEAVED) {
+		bindInterleaved();
+	} else {
+		bindPlanar();
+	}
 	
 	// Draw
 	int count = posBuf.size()/3; // number of indices to be rendered
-	glDrawArrays(GL_TRIANGLES, 0, count);
+	if(instances == 0) {
+		glDrawArrays(GL_TRIANGLES, 0, count);
+	} else if(GLEW_VERSION_3_1) {
+		glDrawArraysInstanced(GL_TRIANGLES, 0, count, instances);
+	} else {
+		// The legacy contexts of macOS only have the ARB entry point
+		glDrawArraysInstancedARB(GL_TRIANGLES, 0, count, instances);
+	}
 	
 	// Disable and unbind
 	if(h_tex != -1) {
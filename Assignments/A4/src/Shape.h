@@ -6,6 +6,9 @@
 #include <vector>
 #include <memory>
 
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
 class Program;
 
 /**
@@ -14,25 +17,69 @@ class Program;
  * - norBuf should be of length 3*ntris (if normals are available)
  * - texBuf should be of length 2*ntris (if texture coords are available)
  * posBufID, norBufID, and texBufID are OpenGL buffer identifiers.
+ *
+ * With the INTERLEAVED layout, init() packs the selected attributes into one
+ * buffer (vertBufID) instead of one buffer per attribute, and draw() sets all
+ * of them up from that single buffer.
+ *
+ * buildLods() adds simplified copies of the shape (levels of detail); level 0
+ * is the shape itself. init() sends them to the GPU with the same layout.
  */
 class Shape
 {
 public:
+	enum Layout { PLANAR, INTERLEAVED };
+	enum Attribute { POSITION = 1, NORMAL = 2, TEXCOORD = 4 };
+
 	Shape();
 	virtual ~Shape();
 	void loadMesh(const std::string &meshName);
 	void fitToUnitBox();
+	// Call before init(). Each fraction of the triangles becomes one more
+	// level, largest first.
+	void buildLods(const std::vector<float> &fractions);
+	int getLodCount() const { return 1 + (int)lods.size(); }
+	const Shape &getLod(int level) const;
+	// Sphere around the bounding box; used to pick LODs every frame, so it is
+	// computed once by init()
+	void getBoundingSphere(glm::vec3 &center, float &radius) const;
+	// Call before init(). For INTERLEAVED, attributes picks what goes into the
+	// buffer and stride is the bytes per vertex (0 packs them tightly).
+	void setLayout(Layout layout, int attributes = POSITION | NORMAL | TEXCOORD, int stride = 0);
 	void init();
 	void draw(const std::shared_ptr<Program> prog) const;
+	// The whole shape, instances times, with the per-instance attributes
+	// already set up by the caller (see InstanceBatch)
+	void drawInstanced(const std::shared_ptr<Program> prog, int instances) const;
+	size_t getTriangleCount() const { return posBuf.size()/9; }
     float getMinY();
 	
 private:
+	// Draws instances times, or once without instancing if 0
+	void draw(const std::shared_ptr<Program> prog, int instances) const;
+	void bindPlanar() const;
+	void bindInterleaved() const;
+	
 	std::vector<float> posBuf;
 	std::vector<float> norBuf;
 	std::vector<float> texBuf;
 	unsigned posBufID;
 	unsigned norBufID;
 	unsigned texBufID;
+	Layout layout;
+	int attributes;
+	int stride;
+	int norOffset; // bytes into an interleaved vertex, -1 if absent
+	int texOffset;
+	unsigned vertBufID;
+	glm::vec3 sphereCenter;
+	float sphereRadius;
+	std::vector<std::shared_ptr<Shape> > lods;
+	// Attribute locations of the last program drawn with, by its link id
+	mutable unsigned attribLink;
+	mutable int h_pos;
+	mutable int h_nor;
+	mutable int h_tex;
 };
 
 #endif
@@ -11,6 +11,7 @@
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -18,6 +19,7 @@
 
 #include "Camera.h"
 #include "GLSL.h"
+#include "InstanceBatch.h"
 #include "MatrixStack.h"
 #include "Program.h"
 #include "Shape.h"
@@ -27,6 +29,7 @@
 using namespace std;
 shared_ptr<Program> prog; // texture
 shared_ptr<Program> prog2; // <-- Blinn - Phong
+shared_ptr<Program> progInst; // <-- instanced Blinn - Phong, if supported
 glm::mat3 T(1.0f);
 
 shared_ptr<Texture> texture0;
@@ -66,6 +69,12 @@ bool topDown = false;
 
 
 bool keyToggles[256] = {false}; // only for English keyboards!
+Shape::Layout LAYOUT = Shape::PLANAR; // vertex buffer layout of the meshes
+size_t trianglesDrawn = 0; // by SceneObject::draw since the last report
+// The view render() is drawing, 0 for the main one and 1 for the top-down
+// one, and its height in pixels, for picking LODs
+int lodView = 0;
+float lodViewHeight = 480.0f;
 
 class Material {
 public:
@@ -75,6 +84,68 @@ public:
     float shininess;
 };
 
+// Handles to what render() sets in prog2, resolved once in init() so that
+// drawing an object looks nothing up by name
+struct ShadingUniforms {
+    Program::Uniform P, MV, invTransposeMV, ka, kd, ks, s;
+    Program::Uniform light1position, light1color;
+
+    void resolve(const Program& prog)
+    {
+        P = prog.getUniform("P");
+        MV = prog.getUniform("MV");
+        invTransposeMV = prog.getUniform("invTransposeMV");
+        ka = prog.getUniform("ka");
+        kd = prog.getUniform("kd");
+        ks = prog.getUniform("ks");
+        s = prog.getUniform("s");
+        light1position = prog.getUniform("light1position");
+        light1color = prog.getUniform("light1color");
+    }
+    // Matrices and material of one object
+    void setObject(const MatrixStack& projection, const MatrixStack& modelview, const Material& colors) const
+    {
+        glm::mat4 invTransposeMVMatrix = glm::mat4(modelview.normalMatrix());
+        glUniformMatrix4fv(P, 1, GL_FALSE, glm::value_ptr(projection.topMatrix()));
+        glUniformMatrix4fv(MV, 1, GL_FALSE, glm::value_ptr(modelview.topMatrix()));
+        glUniformMatrix4fv(invTransposeMV, 1, GL_FALSE, glm::value_ptr(invTransposeMVMatrix));
+        glUniform3f(ka, colors.ambient.r, colors.ambient.g, colors.ambient.b);
+        glUniform3f(kd, colors.diffuse.r, colors.diffuse.g, colors.diffuse.b);
+        glUniform3f(ks, colors.specular.r, colors.specular.g, colors.specular.b);
+        glUniform1f(s, colors.shininess);
+    }
+};
+ShadingUniforms prog2Uniforms;
+
+// The same for progInst: the model matrices and materials come from
+// InstanceBatch, so this is all that is set per view
+struct InstanceUniforms {
+    Program::Uniform P, V, invTransposeV, t;
+    Program::Uniform light1position, light1color;
+
+    void resolve(const Program& prog)
+    {
+        P = prog.getUniform("P");
+        V = prog.getUniform("V");
+        invTransposeV = prog.getUniform("invTransposeV");
+        t = prog.getUniform("t");
+        light1position = prog.getUniform("light1position");
+        light1color = prog.getUniform("light1color");
+    }
+    // lightPos in camera space
+    void set(const MatrixStack& projection, const MatrixStack& view, float time, const glm::vec3& lightPos, const glm::vec3& lightColor) const
+    {
+        glm::mat4 invTransposeVMatrix = glm::mat4(view.normalMatrix());
+        glUniformMatrix4fv(P, 1, GL_FALSE, glm::value_ptr(projection.topMatrix()));
+        glUniformMatrix4fv(V, 1, GL_FALSE, glm::value_ptr(view.topMatrix()));
+        glUniformMatrix4fv(invTransposeV, 1, GL_FALSE, glm::value_ptr(invTransposeVMatrix));
+        glUniform1f(t, time);
+        glUniform3f(light1position, lightPos.x, lightPos.y, lightPos.z);
+        glUniform3f(light1color, lightColor.r, lightColor.g, lightColor.b);
+    }
+};
+InstanceUniforms progInstUniforms;
+
 class Light {
 public:
     glm::vec3 position;
@@ -96,6 +167,7 @@ public:
     Material colors;
     float scaleOffset;
     float randRotation;
+    int lod[2] = {0, 0}; // last picked in each view
 
     SceneObject(shared_ptr<Shape> _shape, glm::vec3 _translation, glm::vec3 _rotation, glm::vec3 _scale, Material _material, float _scaleOffset, float _randRotation)
         : shape(_shape), translation(_translation), rotation(_rotation), scale(_scale), colors(_material), scaleOffset(_scaleOffset), randRotation(_randRotation){}
@@ -122,20 +194,52 @@ public:
         
         MV->rotate(randRotation, rotation);
         
-        glm::mat4 invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
-        
+        prog2Uniforms.setObject(*P, *MV, colors);
         
-        glUniformMatrix4fv(prog2->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog2->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
-        glUniformMatrix4fv(prog2->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
-        glUniform3f(prog2->getUniform("ka"), colors.ambient.r, colors.ambient.g, colors.ambient.b);
-        glUniform3f(prog2->getUniform("kd"), colors.diffuse.r, colors.diffuse.g, colors.diffuse.b);
-        glUniform3f(prog2->getUniform("ks"), colors.specular.r, colors.specular.g, colors.specular.b);
-        glUniform1f(prog2->getUniform("s"), colors.shininess);
-        
-        shape->draw(prog2);
+        const Shape& mesh = shape->getLod(selectLod(P->topMatrix(), MV->topMatrix()));
+        mesh.draw(prog2);
+        trianglesDrawn += mesh.getTriangleCount();
         MV->popMatrix();
     }
+    // Picks the LOD from the projected diameter in pixels. Level l is used down
+    // to 200/2^l pixels, and the 10% margins keep objects near a threshold
+    // from switching back and forth. Toggle 'l' to always draw full detail.
+    int selectLod(const glm::mat4& P, const glm::mat4& MV)
+    {
+        int count = shape->getLodCount();
+        if (count == 1 || keyToggles[(unsigned)'l']) {
+            return 0;
+        }
+        glm::vec3 center;
+        float radius;
+        shape->getBoundingSphere(center, radius);
+        glm::vec3 c = glm::vec3(MV * glm::vec4(center, 1.0f));
+        float s = std::max(glm::length(glm::vec3(MV[0])), std::max(glm::length(glm::vec3(MV[1])), glm::length(glm::vec3(MV[2]))));
+        float r = radius * s;
+        // Clip w: -z with the perspective of the main view, 1 with the
+        // orthographic top-down one. Spheres reaching the near plane get full
+        // detail.
+        float w = P[2][3] * c.z + P[3][3];
+        float pixels = w > -P[2][3] * r ? r * P[1][1] * lodViewHeight / w : 1e9f;
+        auto threshold = [](int level) { return 200.0f / (1 << level); };
+        int& l = lod[lodView];
+        while (l > 0 && pixels > threshold(l - 1) * 1.1f) l--;
+        while (l < count - 1 && pixels < threshold(l) * 0.9f) l++;
+        return l;
+    }
+    // What inst_vert.glsl needs to draw this object as draw() does
+    InstanceBatch::Instance getInstance(bool doScale) const
+    {
+        InstanceBatch::Instance instance;
+        instance.translation = translation;
+        instance.scale = scale;
+        instance.anim = glm::vec4(doScale ? 1.0f : 0.0f, scaleOffset, 0.0f, 0.0f);
+        instance.rotation = glm::mat3(glm::rotate(glm::mat4(1.0f), randRotation, rotation));
+        instance.ka = colors.ambient;
+        instance.kd = colors.diffuse;
+        instance.ks = glm::vec4(colors.specular, colors.shininess);
+        return instance;
+    }
     void groundDraw(shared_ptr<MatrixStack> P, shared_ptr<MatrixStack> MV, double t, bool doScale, glm::vec3 lightPosCS) {
         texture0->bind(prog->getUniform("texture0"));
         texture1->bind(prog->getUniform("texture1"));
@@ -155,6 +259,9 @@ vector<Material> materials;
 vector<Light> lights;
 vector<bool> whichShader;
 std::vector<SceneObject> sceneObjects;
+// With 'i' the scene objects are drawn from here, one instanced draw call per
+// shape
+InstanceBatch sceneBatch;
 
 void drawHUD(shared_ptr<MatrixStack> P, shared_ptr<MatrixStack> MV, double t){
     // draw HUD Objects
@@ -166,16 +273,7 @@ void drawHUD(shared_ptr<MatrixStack> P, shared_ptr<MatrixStack> MV, double t){
         MV->scale(glm::vec3(0.3f));
         MV->rotate(t, glm::vec3(0.0f, -1.0f, 0.0f));
       
-       glm::mat4 invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
-          
-          
-        glUniformMatrix4fv(prog2->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog2->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
-        glUniformMatrix4fv(prog2->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
-        glUniform3f(prog2->getUniform("ka"), materials[1].ambient.r, materials[1].ambient.g, materials[1].ambient.b);
-        glUniform3f(prog2->getUniform("kd"), materials[1].diffuse.r, materials[1].diffuse.g, materials[1].diffuse.b);
-        glUniform3f(prog2->getUniform("ks"), materials[1].specular.r, materials[1].specular.g, materials[1].specular.b);
-        glUniform1f(prog2->getUniform("s"), materials[1].shininess);
+        prog2Uniforms.setObject(*P, *MV, materials[1]);
         shape->draw(prog2);
         MV->popMatrix();
        // end draw bunny
@@ -194,15 +292,7 @@ void drawHUD(shared_ptr<MatrixStack> P, shared_ptr<MatrixStack> MV, double t){
        
        MV->rotate(t, glm::vec3(0.0f, -1.0f, 0.0f));
           
-       invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
-      
-       glUniformMatrix4fv(prog2->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-       glUniformMatrix4fv(prog2->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
-    glUniformMatrix4fv(prog2->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
-       glUniform3f(prog2->getUniform("ka"), materials[1].ambient.r, materials[1].ambient.g, materials[1].ambient.b);
-       glUniform3f(prog2->getUniform("kd"), materials[1].diffuse.r, materials[1].diffuse.g, materials[1].diffuse.b);
-       glUniform3f(prog2->getUniform("ks"), materials[1].specular.r, materials[1].specular.g, materials[1].specular.b);
-       glUniform1f(prog2->getUniform("s"), materials[1].shininess);
+       prog2Uniforms.setObject(*P, *MV, materials[1]);
     
        teapot->draw(prog2);
        MV->popMatrix();
@@ -399,6 +489,17 @@ static void init()
     prog2->addUniform("ks");
     prog2->addUniform("s");
     prog2->setVerbose(false);
+    prog2Uniforms.resolve(*prog2);
+    
+    // Instanced, with every uniform and attribute found by reflection
+    if (InstanceBatch::isSupported()) {
+        progInst = make_shared<Program>();
+        progInst->setShaderNames(RESOURCE_DIR + "inst_vert.glsl", RESOURCE_DIR + "inst_frag.glsl");
+        progInst->setVerbose(true);
+        progInst->init();
+        progInst->setVerbose(false);
+        progInstUniforms.resolve(*progInst);
+    }
     
     
 	camera = make_shared<Camera>();
@@ -411,18 +512,25 @@ static void init()
     frustum = make_shared<Shape>();
     
 	shape->loadMesh(RESOURCE_DIR + "bunny.obj");
+	shape->buildLods({0.5f, 0.25f, 0.12f});
+	shape->setLayout(LAYOUT);
 	shape->init();
     
     teapot->loadMesh(RESOURCE_DIR + "teapot.obj");
+    teapot->buildLods({0.5f, 0.25f, 0.12f});
+    teapot->setLayout(LAYOUT);
     teapot->init();
     
     cube->loadMesh(RESOURCE_DIR + "cube.obj");
+    cube->setLayout(LAYOUT);
     cube->init();
     
     sphere->loadMesh(RESOURCE_DIR + "sphere.obj");
+    sphere->setLayout(LAYOUT);
     sphere->init();
     
     frustum->loadMesh(RESOURCE_DIR + "frustum.obj");
+    frustum->setLayout(LAYOUT);
     frustum->init();
     
 
@@ -471,6 +579,15 @@ static void init()
         }
     }
     
+    // The ground and the sun don't pulse
+    if (progInst) {
+        for (int i = 0; i < sceneObjects.size(); i++) {
+            sceneBatch.add(sceneObjects[i].shape, sceneObjects[i].getInstance(i >= 2));
+        }
+        sceneBatch.upload();
+        cout << "instancing ('i'): " << sceneBatch.getInstanceCount() << " objects in " << sceneBatch.getShapeCount() << " draw calls" << endl;
+    }
+    
 	GLSL::checkError(GET_FILE_LINE);
 }
 
@@ -502,10 +619,10 @@ static void render()
 		t = 0.0f;
 	}
    
-    // Matrix stacks
-    auto P = make_shared<MatrixStack>();
-    auto MV = make_shared<MatrixStack>();
-    auto P_HUD = make_shared<MatrixStack>();
+    // Matrix stacks, reused every frame: each push in here is popped
+    static auto P = make_shared<MatrixStack>();
+    static auto MV = make_shared<MatrixStack>();
+    static auto P_HUD = make_shared<MatrixStack>();
     
     Light lightW = lights[2];
     // Apply camera transforms
@@ -522,8 +639,8 @@ static void render()
     prog2->bind();
     
    
-    glUniform3f(prog2->getUniform("light1position"), lightPosCS.x,  lightPosCS.y,  lightPosCS.z);
-    glUniform3f(prog2->getUniform("light1color"), lightW.color.r,  lightW.color.g,  lightW.color.b);
+    glUniform3f(prog2Uniforms.light1position, lightPosCS.x,  lightPosCS.y,  lightPosCS.z);
+    glUniform3f(prog2Uniforms.light1color, lightW.color.r,  lightW.color.g,  lightW.color.b);
     
     // DRAW HUD
     P_HUD->pushMatrix();
@@ -539,26 +656,40 @@ static void render()
     // DRAW MAIN SCENE
     camera->applyProjectionMatrix(P);
     camera->applyViewMatrix(MV); // view matrix on left
+    lodView = 0;
+    lodViewHeight = (float)height;
     
     
-    sceneObjects[1].draw(P, MV, t, false); // sun
-    sceneObjects[0].draw(P, MV, t, false); // ground
-    
-    for (int i = 2; i < sceneObjects.size(); i++) {
-        sceneObjects[i].draw(P, MV, t, true);
+    bool instanced = keyToggles[(unsigned)'i'] && sceneBatch.getInstanceCount() > 0;
+    if (instanced) {
+        // Sun, ground, and objects in one call per shape
+        prog2->unbind();
+        progInst->bind();
+        progInstUniforms.set(*P, *MV, (float)t, lightPosCS, lightW.color);
+        sceneBatch.draw(progInst);
+        progInst->unbind();
+    } else {
+        sceneObjects[1].draw(P, MV, t, false); // sun
+        sceneObjects[0].draw(P, MV, t, false); // ground
+        
+        for (int i = 2; i < sceneObjects.size(); i++) {
+            sceneObjects[i].draw(P, MV, t, true);
+        }
+        prog2->unbind();
     }
-    prog2->unbind();
     MV->popMatrix();
     P->popMatrix();
 	
     // NEW VIEWPORT
     // Top-down viewport (new code for this task)
     if (topDown){
-        auto topdownP = make_shared<MatrixStack>();
-        auto topdownMV = make_shared<MatrixStack>();
+        static auto topdownP = make_shared<MatrixStack>();
+        static auto topdownMV = make_shared<MatrixStack>();
         
         double s = 0.5;
         glViewport(0, 0, s*width, s*height);
+        lodView = 1;
+        lodViewHeight = (float)(s*height);
         glEnable(GL_SCISSOR_TEST);
         glScissor(0, 0, s*width, s*height);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -581,8 +712,8 @@ static void render()
         // Lights
         glm::vec4 topdownLightPos = topdownMV->topMatrix() * glm::vec4(lightW.position, 1.0f); // tranform light into camera space
         lightW.position = glm::vec3(topdownLightPos);
-        glUniform3f(prog2->getUniform("light1position"), lightW.position.x,  lightW.position.y,  lightW.position.z);
-        glUniform3f(prog2->getUniform("light1color"), lightW.color.r,  lightW.color.g,  lightW.color.b);
+        glUniform3f(prog2Uniforms.light1position, lightW.position.x,  lightW.position.y,  lightW.position.z);
+        glUniform3f(prog2Uniforms.light1color, lightW.color.r,  lightW.color.g,  lightW.color.b);
         
         
         // DRAW FRUSTUM
@@ -603,29 +734,37 @@ static void render()
         topdownMV->scale(glm::vec3(sX, sY, 1.0f));
         
         
-        glUniformMatrix4fv(prog2->getUniform("P"), 1, GL_FALSE, glm::value_ptr(topdownP->topMatrix()));
-        glUniformMatrix4fv(prog2->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(topdownMV->topMatrix()));
-        glUniformMatrix4fv(prog2->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(cameraMatrix));
-        glUniform3f(prog2->getUniform("ka"), 0.0f, 0.0f, 0.0f);
-        glUniform3f(prog2->getUniform("kd"), 0.0f, 0.0f, 0.0f);
-        glUniform3f(prog2->getUniform("ks"), materials[1].specular.r, materials[1].specular.g, materials[1].specular.b);
-        glUniform1f(prog2->getUniform("s"), materials[1].shininess);
+        glUniformMatrix4fv(prog2Uniforms.P, 1, GL_FALSE, glm::value_ptr(topdownP->topMatrix()));
+        glUniformMatrix4fv(prog2Uniforms.MV, 1, GL_FALSE, glm::value_ptr(topdownMV->topMatrix()));
+        glUniformMatrix4fv(prog2Uniforms.invTransposeMV, 1, GL_FALSE, glm::value_ptr(cameraMatrix));
+        glUniform3f(prog2Uniforms.ka, 0.0f, 0.0f, 0.0f);
+        glUniform3f(prog2Uniforms.kd, 0.0f, 0.0f, 0.0f);
+        glUniform3f(prog2Uniforms.ks, materials[1].specular.r, materials[1].specular.g, materials[1].specular.b);
+        glUniform1f(prog2Uniforms.s, materials[1].shininess);
         
         frustum->draw(prog2);
         topdownMV->popMatrix();
         // END DRAW FRUSTUM
         
-        sceneObjects[1].draw(topdownP, topdownMV, t, false);
-        
-        sceneObjects[0].draw(topdownP, topdownMV, t, false);
-        
-        for (int i = 2; i < sceneObjects.size(); i++) {
-            sceneObjects[i].draw(topdownP, topdownMV, t, true);
+        if (instanced) {
+            prog2->unbind();
+            progInst->bind();
+            progInstUniforms.set(*topdownP, *topdownMV, (float)t, lightW.position, lightW.color);
+            sceneBatch.draw(progInst);
+            progInst->unbind();
+        } else {
+            sceneObjects[1].draw(topdownP, topdownMV, t, false);
+            
+            sceneObjects[0].draw(topdownP, topdownMV, t, false);
+            
+            for (int i = 2; i < sceneObjects.size(); i++) {
+                sceneObjects[i].draw(topdownP, topdownMV, t, true);
+            }
+            
+            
+            prog2->unbind();
         }
         
-        
-        prog2->unbind();
-        
         topdownMV->popMatrix();
         topdownP->popMatrix();
     }
@@ -642,7 +781,7 @@ static void render()
 int main(int argc, char **argv)
 {
 	if(argc < 2) {
-		cout << "Usage: A3 RESOURCE_DIR" << endl;
+		cout << "Usage: A4 RESOURCE_DIR [OFFLINE] [planar|interleaved]" << endl;
 		return 0;
 	}
 	RESOURCE_DIR = argv[1] + string("/");
@@ -651,6 +790,9 @@ int main(int argc, char **argv)
 	if(argc >= 3) {
 		OFFLINE = atoi(argv[2]) != 0;
 	}
+	if(argc >= 4) {
+		LAYOUT = string(argv[3]) == "interleaved" ? Shape::INTERLEAVED : Shape::PLANAR;
+	}
 
 	// Set error callback.
 	glfwSetErrorCallback(error_callback);
@@ -691,15 +833,29 @@ int main(int argc, char **argv)
 	// Initialize scene.
 	init();
 	// Loop until the user closes the window.
+	double frameTime = 0.0;
+	int frames = 0;
 	while(!glfwWindowShouldClose(window)) {
-		// Render scene.
+		// Render scene, timing the CPU side for layout comparisons.
+		double frameStart = glfwGetTime();
 		render();
+		frameTime += glfwGetTime() - frameStart;
+		if(++frames == 300) {
+			cout << (LAYOUT == Shape::INTERLEAVED ? "Interleaved" : "Planar") << (keyToggles[(unsigned)'l'] ? ", no LOD" : ", LOD") << ": "
+			     << 1000.0 * frameTime / frames << " ms CPU per frame, " << trianglesDrawn / frames << " triangles per frame, "
+			     << trianglesDrawn / frameTime / 1e6 << " Mtris/s" << endl;
+			frameTime = 0.0;
+			frames = 0;
+			trianglesDrawn = 0;
+		}
 		// Swap front and back buffers.
 		glfwSwapBuffers(window);
 		// Poll for and process events.
 		glfwPollEvents();
 	}
-	// Quit program.
+	// Quit program, freeing the GL objects of globals while the context is
+	// still there.
+	sceneBatch.release();
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	return 0;
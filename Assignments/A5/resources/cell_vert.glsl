@@ -32,7 +32,7 @@ void main()
     vec3 p = vec3(x, y, z);
 
     // Compute normal
-    float dfdx = -sin(x);
+    float dfdx = -sin(x + t);
     
     float dp_dx_x = 1.0f;
     float dp_dx_y = dfdx * cos(theta);
@@ -45,7 +45,7 @@ void main()
     
     vec3 dp_dx = vec3(dp_dx_x, dp_dx_y,  dp_dx_z);
     vec3 dp_dtheta = vec3(dp_dtheta_x, dp_dtheta_y, dp_dtheta_z);
-    vec3 n = normalize(cross(dp_dx, dp_dtheta));
+    vec3 n = normalize(cross(dp_dtheta, dp_dx)); // pointing out
     
     gl_Position = P * (MV * vec4(p, 1.0));
     fragPos = (MV * vec4(p, 1.0)).xyz; // Convert position to camera space
@@ -0,0 +1,14 @@
+#version 120
+
+varying vec3 fragPos; // passed from the vertex shader
+varying vec3 normalCam; // passed from the vertex shader
+varying vec3 ka; // per instance
+varying vec3 kd;
+
+void main()
+{
+    gl_FragData[0].xyz = fragPos;
+    gl_FragData[1].xyz = normalCam;
+    gl_FragData[2].xyz = ka;
+    gl_FragData[3].xyz = kd;
+}
@@ -2,10 +2,12 @@
     
 uniform mat4 P;
 uniform mat4 MV;
+uniform vec3 quantScale; // maps quantized positions to the bounding box
+uniform vec3 quantOffset;
     
 attribute vec4 aPos;
     
 void main()
 {
-    gl_Position = P * (MV * aPos);
+    gl_Position = P * (MV * vec4(aPos.xyz * quantScale + quantOffset, 1.0));
 }
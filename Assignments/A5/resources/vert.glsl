@@ -3,6 +3,9 @@
 uniform mat4 P;
 uniform mat4 MV;
 uniform mat4 invTransposeMV; // Uniform for inverse transpose of MV
+uniform vec3 quantScale; // maps quantized positions to the bounding box
+uniform vec3 quantOffset;
+uniform bool octNormals; // aNor.xy holds an octahedral encoded normal
 
 attribute vec4 aPos; // in object space
 attribute vec3 aNor; // in object space
@@ -13,12 +16,23 @@ varying vec3 normalCam; // in camera space
 
 
 
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
 void main()
 {
-    gl_Position = P * MV * aPos;
-    fragPos = (MV * aPos).xyz; // Convert position to camera space
+    vec4 pos = vec4(aPos.xyz * quantScale + quantOffset, 1.0);
+    vec3 nor = octNormals ? octDecode(aNor.xy) : aNor;
+    gl_Position = P * MV * pos;
+    fragPos = (MV * pos).xyz; // Convert position to camera space
     
-    vec4 tmp = invTransposeMV * vec4(aNor, 0.0); // Convert normal to camera space
+    vec4 tmp = invTransposeMV * vec4(nor, 0.0); // Convert normal to camera space
     normalCam = normalize(tmp.xyz);
 
 }
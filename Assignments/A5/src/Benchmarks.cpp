@@ -0,0 +1,410 @@
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "GLSL.h"
+#include <GLFW/glfw3.h>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Camera.h"
+#include "Deformer.h"
+#include "InstanceBatch.h"
+#include "MatrixStack.h"
+#include "MeshGenerator.h"
+#include "ObjLoader.h"
+#include "Program.h"
+#include "Shape.h"
+#include "StreamBuffer.h"
+
+using namespace std;
+
+namespace {
+
+double seconds(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Opens a hidden window and makes its context current, with GLEW
+// initialized. Returns nullptr, with GLFW terminated again, if any of that
+// fails.
+GLFWwindow *openHiddenWindow(const char *title, int width, int height)
+{
+	if(!glfwInit()) {
+		return nullptr;
+	}
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	GLFWwindow *window = glfwCreateWindow(width, height, title, NULL, NULL);
+	if(!window) {
+		glfwTerminate();
+		return nullptr;
+	}
+	glfwMakeContextCurrent(window);
+	glewExperimental = true;
+	if(glewInit() != GLEW_OK) {
+		cerr << "Failed to initialize GLEW" << endl;
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return nullptr;
+	}
+	glGetError(); // A bug in glewInit() causes an error that we can safely ignore.
+	return window;
+}
+
+// The GL objects made in the window's context must be gone by now.
+void closeHiddenWindow(GLFWwindow *window)
+{
+	glfwDestroyWindow(window);
+	glfwTerminate();
+}
+
+// Runs load in a child process, so that each loader starts from the same
+// heap, and prints how much it raised the peak resident set next to the
+// bytes it returns as kept.
+void printPeakMemory(const string &label, const function<size_t()> &load)
+{
+#ifndef _WIN32
+	cout.flush();
+	pid_t pid = fork();
+	if(pid == 0) {
+		struct rusage before, after;
+		getrusage(RUSAGE_SELF, &before);
+		size_t kept = load();
+		getrusage(RUSAGE_SELF, &after);
+#ifdef __APPLE__
+		double megabytes = (after.ru_maxrss - before.ru_maxrss) / 1e6; // bytes
+#else
+		double megabytes = (after.ru_maxrss - before.ru_maxrss) / 1e3; // kilobytes
+#endif
+		cout << "  " << label << megabytes << " MB peak, " << kept / 1e6 << " MB kept" << endl;
+		_exit(0);
+	}
+	if(pid > 0) {
+		waitpid(pid, nullptr, 0);
+	}
+#endif
+}
+
+}
+
+void Benchmarks::objLoading(double maxTriangles)
+{
+	const char *filename = "objbench.obj";
+	const char *stlFilename = "objbench.stl";
+	for(double triangles : {1e5, 1e6, 1e7, 5e7}) {
+		if(triangles > maxTriangles) {
+			break;
+		}
+		int n = (int)sqrt(triangles / 2.0) + 1;
+		FILE *f = fopen(filename, "wb");
+		if(!f) {
+			cerr << "Cannot write " << filename << endl;
+			return;
+		}
+		char line[256];
+		for(int j = 0; j < n; ++j) {
+			for(int i = 0; i < n; ++i) {
+				int len = snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn 0 1 0\n",
+								   i / (float)n, 0.1f * sin(0.1f * (i + j)), j / (float)n, i / (float)n, j / (float)n);
+				fwrite(line, 1, len, f);
+			}
+		}
+		for(int j = 0; j + 1 < n; ++j) {
+			for(int i = 0; i + 1 < n; ++i) {
+				int a = j * n + i + 1;
+				int b = a + 1, c = a + n + 1, d = a + n;
+				if(j % 2) {
+					// relative to the n*n vertices so far
+					a -= n * n + 1; b -= n * n + 1; c -= n * n + 1; d -= n * n + 1;
+				}
+				int len = snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\nf %d/%d/%d %d/%d/%d %d/%d/%d\n",
+								   a, a, a, b, b, b, c, c, c, a, a, a, c, c, c, d, d, d);
+				fwrite(line, 1, len, f);
+			}
+		}
+		double megabytes = ftell(f) / 1e6;
+		fclose(f);
+
+		// The same triangles as a binary STL file
+		f = fopen(stlFilename, "wb");
+		if(!f) {
+			cerr << "Cannot write " << stlFilename << endl;
+			return;
+		}
+		char header[80] = "objbench";
+		fwrite(header, 1, sizeof(header), f);
+		uint32_t count = 2 * (n - 1) * (n - 1);
+		fwrite(&count, sizeof(count), 1, f);
+		auto vertex = [n](int i, int j) {
+			return glm::vec3(i / (float)n, 0.1f * sin(0.1f * (i + j)), j / (float)n);
+		};
+		for(int j = 0; j + 1 < n; ++j) {
+			for(int i = 0; i + 1 < n; ++i) {
+				glm::vec3 a = vertex(i, j), b = vertex(i + 1, j), c = vertex(i + 1, j + 1), d = vertex(i, j + 1);
+				glm::vec3 triangles[2][3] = {{a, b, c}, {a, c, d}};
+				for(const glm::vec3 *t : triangles) {
+					// normal, 3 vertices, 2 unused bytes
+					float record[12];
+					glm::vec3 normal = glm::normalize(glm::cross(t[1] - t[0], t[2] - t[0]));
+					memcpy(record, &normal[0], 3 * sizeof(float));
+					for(int k = 0; k < 3; ++k) {
+						memcpy(record + 3 * (k + 1), &t[k][0], 3 * sizeof(float));
+					}
+					uint16_t unused = 0;
+					fwrite(record, sizeof(record), 1, f);
+					fwrite(&unused, sizeof(unused), 1, f);
+				}
+			}
+		}
+		double stlMegabytes = ftell(f) / 1e6;
+		fclose(f);
+		cout << count << " triangles, OBJ " << megabytes << " MB, STL " << stlMegabytes << " MB:" << endl;
+
+		auto attribBytes = [](const tinyobj::attrib_t &attrib, const vector<tinyobj::shape_t> &shapes) {
+			size_t bytes = (attrib.vertices.size() + attrib.normals.size() + attrib.texcoords.size()) * sizeof(float);
+			for(const tinyobj::shape_t &shape : shapes) {
+				bytes += shape.mesh.indices.size() * sizeof(tinyobj::index_t);
+			}
+			return bytes;
+		};
+		if(triangles <= 1e7) {
+			printPeakMemory("tinyobj:            ", [&]() {
+				tinyobj::attrib_t attrib;
+				vector<tinyobj::shape_t> shapes;
+				vector<tinyobj::material_t> materials;
+				string err;
+				tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename);
+				return attribBytes(attrib, shapes);
+			});
+		}
+		printPeakMemory("ObjLoader:          ", [&]() {
+			tinyobj::attrib_t attrib;
+			vector<tinyobj::shape_t> shapes;
+			string err;
+			ObjLoader::load(filename, &attrib, &shapes, &err);
+			return attribBytes(attrib, shapes);
+		});
+		// Shape from the OBJ file, and from the STL file with and without
+		// welding
+		struct ShapeLoad
+		{
+			const char *label;
+			const char *filename;
+			bool weld;
+			double megabytes;
+		};
+		ShapeLoad shapeLoads[] = {
+			{"Shape, OBJ:         ", filename, true, megabytes},
+			{"Shape, STL:         ", stlFilename, false, stlMegabytes},
+			{"Shape, STL welded:  ", stlFilename, true, stlMegabytes},
+		};
+		for(const ShapeLoad &load : shapeLoads) {
+			printPeakMemory(load.label, [&]() {
+				Shape shape;
+				shape.loadMesh(load.filename, load.weld);
+				return shape.getBytes();
+			});
+		}
+
+		tinyobj::attrib_t attrib;
+		vector<tinyobj::shape_t> shapes;
+		string err;
+		if(triangles <= 1e7) {
+			vector<tinyobj::material_t> materials;
+			auto start = chrono::steady_clock::now();
+			tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename);
+			double t = seconds(start);
+			cout << "  tinyobj:            " << t << " s, " << megabytes / t << " MB/s" << endl;
+		}
+		for(int threads : {1, 0}) {
+			auto start = chrono::steady_clock::now();
+			ObjLoader::load(filename, &attrib, &shapes, &err, threads);
+			double t = seconds(start);
+			cout << "  ObjLoader, " << (threads ? "1 thread: " : "all cores:") << " " << t << " s, " << megabytes / t << " MB/s" << endl;
+		}
+		for(const ShapeLoad &load : shapeLoads) {
+			auto start = chrono::steady_clock::now();
+			Shape shape;
+			shape.loadMesh(load.filename, load.weld);
+			double t = seconds(start);
+			cout << "  " << load.label << t << " s, " << load.megabytes / t << " MB/s, " << shape.getVertexCount() << " vertices" << endl;
+		}
+	}
+	remove(filename);
+	remove(stlFilename);
+}
+
+void Benchmarks::deformation(const string &resourceDir, size_t vertices)
+{
+	const int FRAMES = 100;
+	int n = max(1, (int)sqrt((double)vertices) - 1);
+	MeshGenerator::Mesh domain;
+	MeshGenerator::revolution(domain, n, n, 10.0f);
+	Deformer deformer;
+	deformer.setDomain(domain.posBuf);
+	size_t count = deformer.getVertexCount();
+	vector<float> out(6 * count);
+	cout << count << " vertices, " << out.size() * sizeof(float) / 1e6 << " MB per frame:" << endl;
+
+	auto start = chrono::steady_clock::now();
+	for(int frame = 0; frame < FRAMES; ++frame) {
+		float t = 0.01f * frame;
+		for(size_t i = 0; i < count; ++i) {
+			float x = domain.posBuf[3 * i + 0];
+			float theta = domain.posBuf[3 * i + 1];
+			float f = cos(x + t) + 2.0f;
+			float dfdx = -sin(x + t);
+			float len = 1.0f / sqrt(1.0f + dfdx * dfdx);
+			float *o = &out[6 * i];
+			o[0] = x;
+			o[1] = f * cos(theta);
+			o[2] = f * sin(theta);
+			o[3] = -dfdx * len;
+			o[4] = cos(theta) * len;
+			o[5] = sin(theta) * len;
+		}
+	}
+	cout << "  std::sin/cos:        " << 1000.0 * seconds(start) / FRAMES << " ms per frame" << endl;
+	for(int threads : {1, 0}) {
+		start = chrono::steady_clock::now();
+		for(int frame = 0; frame < FRAMES; ++frame) {
+			deformer.deform(0.01f * frame, &out[0], threads);
+		}
+		cout << "  Deformer, " << (threads ? "1 thread: " : "all cores:") << "  " << 1000.0 * seconds(start) / FRAMES << " ms per frame" << endl;
+	}
+
+	GLFWwindow *hidden = openHiddenWindow("deformbench", 64, 64);
+	if(!hidden) {
+		return;
+	}
+	Program points;
+	points.setShaderNames(resourceDir + "vert.glsl", resourceDir + "frag.glsl");
+	points.init();
+	points.addAttribute("aPos");
+	points.addAttribute("aNor");
+	points.addUniform("P");
+	points.addUniform("MV");
+	points.addUniform("invTransposeMV");
+	points.addUniform("quantScale");
+	points.addUniform("quantOffset");
+	points.addUniform("octNormals");
+	points.bind();
+	glm::mat4 I(1.0f);
+	glUniformMatrix4fv(points.getUniform("P"), 1, GL_FALSE, value_ptr(I));
+	glUniformMatrix4fv(points.getUniform("MV"), 1, GL_FALSE, value_ptr(I));
+	glUniformMatrix4fv(points.getUniform("invTransposeMV"), 1, GL_FALSE, value_ptr(I));
+	glUniform3f(points.getUniform("quantScale"), 1.0f, 1.0f, 1.0f);
+	glUniform3f(points.getUniform("quantOffset"), 0.0f, 0.0f, 0.0f);
+	glUniform1i(points.getUniform("octNormals"), 0);
+	GLint h_pos = points.getAttribute("aPos");
+	GLint h_nor = points.getAttribute("aNor");
+
+	vector<StreamBuffer::Mode> modes;
+	if(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+		modes.push_back(StreamBuffer::PERSISTENT);
+	}
+	if((GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range) && (GLEW_VERSION_3_2 || GLEW_ARB_sync)) {
+		modes.push_back(StreamBuffer::UNSYNCHRONIZED);
+	}
+	modes.push_back(StreamBuffer::SUBDATA);
+	for(StreamBuffer::Mode mode : modes) {
+		StreamBuffer stream;
+		stream.init(out.size() * sizeof(float), mode);
+		start = chrono::steady_clock::now();
+		for(int frame = 0; frame < FRAMES; ++frame) {
+			deformer.deform(0.01f * frame, (float *)stream.map());
+			size_t offset = stream.unmap();
+			glBindBuffer(GL_ARRAY_BUFFER, stream.getBufferID());
+			glEnableVertexAttribArray(h_pos);
+			glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (const void *)offset);
+			if(h_nor != -1) {
+				glEnableVertexAttribArray(h_nor);
+				glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (const void *)(offset + 3 * sizeof(float)));
+			}
+			glDrawArrays(GL_POINTS, 0, (GLsizei)count);
+			stream.fence();
+		}
+		double t = seconds(start);
+		glFinish();
+		cout << "  streamed, " << stream.getModeName() << ": " << 1000.0 * t / FRAMES << " ms per frame, "
+			 << 1000.0 * stream.getWaitTime() / FRAMES << " ms of it waiting for the GPU (" << stream.getWaitCount() << " waits)" << endl;
+	}
+	points.unbind();
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLSL::checkError(GET_FILE_LINE);
+	closeHiddenWindow(hidden);
+}
+
+void Benchmarks::instancing(const vector<size_t> &counts, Objects &objects)
+{
+	GLFWwindow *hidden = openHiddenWindow("instbench", 640, 480);
+	if(!hidden) {
+		return;
+	}
+	glEnable(GL_DEPTH_TEST);
+	bool instanced = InstanceBatch::isSupported();
+	if(!instanced) {
+		cout << "no instanced arrays in this context, timing SceneObject::draw() only" << endl;
+	}
+	objects.init(instanced);
+
+	for(size_t n : counts) {
+		int side = (int)ceil(sqrt((double)n));
+		objects.makeGrid(n, side);
+		Camera camera;
+		camera.setInitDistance(0.75f * side);
+		auto P = make_shared<MatrixStack>();
+		auto MV = make_shared<MatrixStack>();
+		camera.applyProjectionMatrix(P);
+		camera.applyViewMatrix(MV);
+		int frames = max(5, min(100, (int)(200000 / n)));
+		cout << n << " objects, " << frames << " frames:" << endl;
+
+		double cpu = 0.0;
+		for(int frame = 0; frame < frames; ++frame) {
+			auto start = chrono::steady_clock::now();
+			objects.draw(P, MV, 0.01f * frame);
+			cpu += seconds(start);
+			glFinish();
+		}
+		cout << "  SceneObject::draw(): " << 1000.0 * cpu / frames << " ms CPU per frame, " << n << " draw calls" << endl;
+
+		if(instanced) {
+			InstanceBatch batch;
+			auto start = chrono::steady_clock::now();
+			objects.addTo(batch);
+			batch.upload();
+			glFinish();
+			double upload = seconds(start);
+			cpu = 0.0;
+			for(int frame = 0; frame < frames; ++frame) {
+				start = chrono::steady_clock::now();
+				objects.drawBatch(batch, *P, *MV, 0.01f * frame);
+				cpu += seconds(start);
+				glFinish();
+			}
+			cout << "  InstanceBatch:       " << 1000.0 * cpu / frames << " ms CPU per frame, " << batch.getShapeCount() << " draw calls, "
+			     << 1000.0 * upload << " ms to pack and upload once" << endl;
+		}
+	}
+	GLSL::checkError(GET_FILE_LINE);
+	objects.release();
+	closeHiddenWindow(hidden);
+}
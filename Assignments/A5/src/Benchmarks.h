@@ -0,0 +1,62 @@
+#pragma once
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class InstanceBatch;
+class MatrixStack;
+
+/**
+ * The timing modes of the command line (A5 RESOURCE_DIR objbench|deformbench|instbench). They
+ * print their results to cout and return; the GL ones open a hidden window
+ * of their own.
+ */
+class Benchmarks
+{
+public:
+	/**
+	 * What instancing() draws: a grid of objects, one draw call each and then
+	 * through an InstanceBatch. main.cpp implements it with its SceneObjects,
+	 * so that what is timed is what render() does.
+	 */
+	class Objects
+	{
+	public:
+		virtual ~Objects() {}
+		// Creates the programs and shapes in the current context, the
+		// instanced program only if instanced is true
+		virtual void init(bool instanced) = 0;
+		// Replaces the objects with n of them, side to a row, centered on the
+		// origin
+		virtual void makeGrid(size_t n, int side) = 0;
+		// One draw call per object, at time t
+		virtual void draw(const std::shared_ptr<MatrixStack> &P, const std::shared_ptr<MatrixStack> &MV, float t) = 0;
+		virtual void addTo(InstanceBatch &batch) const = 0;
+		// batch.draw() with the instanced program, at time t
+		virtual void drawBatch(const InstanceBatch &batch, const MatrixStack &P, const MatrixStack &V, float t) = 0;
+		// Deletes the GL objects of init() while the context is still there
+		virtual void release() = 0;
+	};
+
+	// tinyobj::LoadObj against ObjLoader on generated grids from 100K
+	// triangles up to maxTriangles, the faces using relative indices on every
+	// other row. tinyobj is skipped past 10M triangles, where it needs tens of
+	// GB. Shape::loadMesh() then loads the grid from the OBJ file and from a
+	// binary STL file of the same triangles.
+	static void objLoading(double maxTriangles);
+	// Deforming the spiral surface for a grid of about the given number of
+	// vertices: the plain loop with std::sin() and std::cos() as the
+	// reference, then Deformer on one thread and on all cores. Each
+	// StreamBuffer mode the context has then streams the result to the GPU
+	// straight from the kernel, and it is drawn as points.
+	static void deformation(const std::string &resourceDir, size_t vertices);
+	// For each count, the CPU time per frame of drawing that many objects
+	// with objects.draw() and with an InstanceBatch. The GPU is waited for
+	// between frames, outside the timing.
+	static void instancing(const std::vector<size_t> &counts, Objects &objects);
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "Deformer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "Parallel.h"
+
+using namespace std;
+
+namespace {
+
+// Starting a thread costs more than deforming this many vertices.
+const size_t MIN_VERTICES_PER_THREAD = 1 << 15;
+
+// pi/2 in three parts, the first two with few enough bits that q times them
+// is exact, so that a - q*pi/2 keeps its precision (Cody and Waite)
+const float PIO2_1 = 1.5703125f;
+const float PIO2_2 = 4.837512969970703125e-4f;
+const float PIO2_3 = 7.54978995489188216e-8f;
+const float TWO_OVER_PI = 0.636619772367581343f;
+// Adding and subtracting 1.5 * 2^23 rounds to the nearest integer.
+const float ROUND = 12582912.0f;
+
+}
+
+Deformer::Deformer()
+{
+}
+
+void Deformer::setDomain(const vector<float> &posBuf)
+{
+	size_t n = posBuf.size()/3;
+	x.resize(n);
+	cosTheta.resize(n);
+	sinTheta.resize(n);
+	for(size_t i = 0; i < n; ++i) {
+		x[i] = posBuf[3*i+0];
+		cosTheta[i] = cos(posBuf[3*i+1]);
+		sinTheta[i] = sin(posBuf[3*i+1]);
+	}
+}
+
+void Deformer::sinCos(const float *a, float *s, float *c, size_t n)
+{
+	// a = q*pi/2 + r with r in [-pi/4, pi/4], then the minimax polynomials
+	// of the Cephes sinf() and cosf() on r, swapped and negated by quadrant.
+	// Selects instead of branches, so each line is one SIMD operation.
+	for(size_t i = 0; i < n; ++i) {
+		float qf = (a[i]*TWO_OVER_PI + ROUND) - ROUND;
+		int q = (int)qf;
+		float r = ((a[i] - qf*PIO2_1) - qf*PIO2_2) - qf*PIO2_3;
+		float r2 = r*r;
+		float sr = r + r*r2*(-1.6666654611e-1f + r2*(8.3321608736e-3f + r2*-1.9515295891e-4f));
+		float cr = 1.0f - 0.5f*r2 + r2*r2*(4.166664568298827e-2f + r2*(-1.388731625493765e-3f + r2*2.443315711809948e-5f));
+		float sq = (q & 1) ? cr : sr;
+		float cq = (q & 1) ? sr : cr;
+		s[i] = (q & 2) ? -sq : sq;
+		c[i] = ((q + 1) & 2) ? -cq : cq;
+	}
+}
+
+void Deformer::deformRange(float t, size_t begin, size_t end, float *out) const
+{
+	// Per block: the angles, their sin and cos, then the five components
+	// that change, each loop over plain arrays. Only the last loop
+	// interleaves them into the output.
+	float a[BLOCK];
+	float s[BLOCK];
+	float c[BLOCK];
+	float py[BLOCK];
+	float pz[BLOCK];
+	float nx[BLOCK];
+	float ny[BLOCK];
+	float nz[BLOCK];
+	for(size_t b = begin; b < end; b += BLOCK) {
+		size_t n = min(BLOCK, end - b);
+		const float *xb = &x[b];
+		const float *ct = &cosTheta[b];
+		const float *st = &sinTheta[b];
+		for(size_t i = 0; i < n; ++i) {
+			a[i] = xb[i] + t;
+		}
+		sinCos(a, s, c, n);
+		for(size_t i = 0; i < n; ++i) {
+			// p = (x, f cos(theta), f sin(theta)), f = cos(x + t) + 2, and
+			// dp/dtheta x dp/dx = f (-f', cos(theta), sin(theta))
+			float f = c[i] + 2.0f;
+			float dfdx = -s[i];
+			float len = 1.0f/sqrt(1.0f + dfdx*dfdx);
+			py[i] = f*ct[i];
+			pz[i] = f*st[i];
+			nx[i] = -dfdx*len;
+			ny[i] = ct[i]*len;
+			nz[i] = st[i]*len;
+		}
+		float *o = out + 6*b;
+		for(size_t i = 0; i < n; ++i) {
+			o[6*i+0] = xb[i];
+			o[6*i+1] = py[i];
+			o[6*i+2] = pz[i];
+			o[6*i+3] = nx[i];
+			o[6*i+4] = ny[i];
+			o[6*i+5] = nz[i];
+		}
+	}
+}
+
+void Deformer::deform(float t, float *out, int threads) const
+{
+	size_t count = x.size();
+	if(threads <= 0) {
+		threads = max(1, (int)thread::hardware_concurrency());
+	}
+	size_t n = max((size_t)1, min((size_t)threads, count/MIN_VERTICES_PER_THREAD));
+	parallelFor(n, [&](size_t i) { deformRange(t, count*i/n, count*(i + 1)/n, out); });
+}
@@ -0,0 +1,45 @@
+#pragma once
+#ifndef DEFORMER_H
+#define DEFORMER_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * The animated surface of revolution of cell_vert.glsl, evaluated on the
+ * CPU: x along the axis, revolved at radius f(x) = cos(x + t) + 2, with the
+ * analytic normal (-f'(x), cos(theta), sin(theta)) normalized, pointing out.
+ *
+ * setDomain() takes the (x, theta) of every vertex once and keeps x,
+ * cos(theta), and sin(theta) in separate arrays. deform() then writes
+ * position and normal (6 floats per vertex) for time t. The vertices are
+ * split across cores, and each core goes through blocks of BLOCK vertices
+ * with plain loops over the arrays and a sin/cos without branches or table
+ * lookups, which the compiler turns into SIMD code.
+ */
+class Deformer
+{
+public:
+	static constexpr size_t BLOCK = 256;
+
+	Deformer();
+	// (x, theta, 0) positions, as made by MeshGenerator::revolution() with
+	// no profile. Any vertex order works.
+	void setDomain(const std::vector<float> &posBuf);
+	size_t getVertexCount() const { return x.size(); }
+	// Writes 6*getVertexCount() floats to out, once each and in order, so out
+	// can be mapped GPU memory. threads = 0 uses one thread per core.
+	void deform(float t, float *out, int threads = 0) const;
+	// sin and cos of n angles, within 1e-7 of std::sin() and std::cos() for
+	// angles up to a few thousand radians
+	static void sinCos(const float *a, float *s, float *c, size_t n);
+
+private:
+	void deformRange(float t, size_t begin, size_t end, float *out) const;
+
+	std::vector<float> x;
+	std::vector<float> cosTheta;
+	std::vector<float> sinTheta;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#pragma once
+#ifndef INSTANCE_BATCH_H
+#define INSTANCE_BATCH_H
+
+#include <memory>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "Program.h"
+
+class Shape;
+
+/**
+ * Objects drawn with one instanced draw call per Shape instead of one draw
+ * call, and a round of uniforms, per object.
+ *
+ * Each Instance holds what SceneObject::draw() builds the model matrix and
+ * material from. upload() packs all of them, grouped by shape, into one
+ * buffer that draw() reads as vertex attributes advancing once per instance
+ * (divisor 1). inst_vert.glsl then builds every instance's model matrix on
+ * the GPU, with the same pulsing scale, shear, and spin over the time
+ * uniform t, so a frame only sets P, V, invTransposeV, and t, whatever the
+ * number of objects. Attributes the shader doesn't declare are skipped.
+ *
+ * Divisors and instanced draws need GL 3.3, or the ARB_instanced_arrays and
+ * ARB_draw_instanced extensions of macOS's legacy context: see isSupported().
+ * Instances are always drawn at full detail, without LODs or meshlet culling.
+ */
+class InstanceBatch
+{
+public:
+	struct Instance
+	{
+		glm::vec3 translation;
+		glm::vec3 scale;
+		glm::vec4 anim; // pulses scale, scale phase, shears, spins (1 or 0)
+		glm::mat3 rotation; // fixed, before the spin
+		glm::vec3 ka;
+		glm::vec3 kd;
+		glm::vec4 ks; // and the shininess
+	};
+
+	InstanceBatch();
+	~InstanceBatch();
+	static bool isSupported();
+
+	void clear();
+	// Clears and frees the buffer, with the context of upload() still
+	// current. The destructor does the same, too late for a global.
+	void release();
+	void add(const std::shared_ptr<Shape> &shape, const Instance &instance);
+	size_t getInstanceCount() const { return instanceCount; }
+	size_t getShapeCount() const { return groups.size(); }
+	// Needs an OpenGL context. Call after the last add().
+	void upload();
+	// With prog bound and its uniforms set. Returns the number of triangles
+	// drawn.
+	size_t draw(const std::shared_ptr<Program> prog) const;
+
+private:
+	InstanceBatch(const InstanceBatch &);
+	InstanceBatch &operator=(const InstanceBatch &);
+
+	struct Group
+	{
+		std::shared_ptr<Shape> shape;
+		std::vector<Instance> instances; // until upload()
+		size_t first; // index of the first instance in the buffer
+		int count;
+	};
+
+	std::vector<Group> groups;
+	size_t instanceCount;
+	unsigned bufID;
+	// Attribute locations of the last program drawn with, by its link id
+	mutable unsigned attribLink;
+	mutable Program::Attribute h_translation;
+	mutable Program::Attribute h_scale;
+	mutable Program::Attribute h_anim;
+	mutable Program::Attribute h_rotation;
+	mutable Program::Attribute h_ka;
+	mutable Program::Attribute h_kd;
+	mutable Program::Attribute h_ks;
+};
+
+#endif
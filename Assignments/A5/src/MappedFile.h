@@ -0,0 +1,38 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * A whole file, memory mapped where we can (read only, private), and read
+ * into a buffer otherwise (Windows, or if mmap fails).
+ */
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string &filename);
+	// Lets the OS drop the pages of [data, data + upTo) from memory, so that
+	// a streaming pass over a large file keeps only a window resident.
+	void release(size_t upTo);
+	// Starts releasing from the top of the file again.
+	void rewind();
+
+	const char *data;
+	size_t size;
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+
+	size_t released;
+	bool mapped;
+	std::vector<char> copy;
+};
+
+#endif
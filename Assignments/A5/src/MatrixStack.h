@@ -2,26 +2,48 @@
 #ifndef MATRIXSTACK_H
 #define MATRIXSTACK_H
 
-#include <stack>
-#include <memory>
-#include <glm/fwd.hpp>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
 
+/**
+ * A stack of matrices like OpenGL's, held inline in the object: pushing and
+ * popping never allocates, and a stack can live on the C stack or be reused
+ * from frame to frame.
+ *
+ * Entries are kept as 3x4 affine matrices (the top three rows), since the
+ * bottom row of anything made of translations, rotations, and scales is
+ * (0, 0, 0, 1). translate() then only updates the last column, scale() the
+ * first three, and rotate() about x, y, or z the two columns it mixes, instead
+ * of a full 4x4 multiply. multMatrix() with a projective matrix (a
+ * perspective projection) makes the entry a full 4x4 one, which is then
+ * multiplied in full.
+ *
+ * topMatrix() expands the top entry to a 4x4 matrix when it has changed since
+ * the last call, so the reference it returns is only good until the next
+ * change to the stack.
+ *
+ * The stack holds at most CAPACITY matrices. A push beyond that, or a pop of
+ * the last matrix, asserts, and in a release build prints an error and is
+ * ignored.
+ */
 class MatrixStack
 {
 public:
+	static const int CAPACITY = 64;
+
 	MatrixStack();
 	virtual ~MatrixStack();
-	
+
 	// glPushMatrix(): Copies the current matrix and adds it to the top of the stack
 	void pushMatrix();
 	// glPopMatrix(): Removes the top of the stack and sets the current matrix to be the matrix that is now on top
 	void popMatrix();
-	
+
 	// glLoadIdentity(): Sets the top matrix to be the identity
 	void loadIdentity();
 	// glMultMatrix(): Right multiplies the top matrix
 	void multMatrix(const glm::mat4 &matrix);
-	
+
 	// glTranslate(): Right multiplies the top matrix by a translation matrix
 	void translate(const glm::vec3 &trans);
 	void translate(float x, float y, float z);
@@ -33,18 +55,34 @@ public:
 	// glRotate(): Right multiplies the top matrix by a rotation matrix (angle in radians)
 	void rotate(float angle, const glm::vec3 &axis);
 	void rotate(float angle, float x, float y, float z);
-	
+
 	// glGet(GL_MODELVIEW_MATRIX): Gets the top matrix
 	const glm::mat4 &topMatrix() const;
-	
+	// Inverse transpose of the upper 3x3 of the top matrix, for normals:
+	// the cross products of its columns over the determinant
+	glm::mat3 normalMatrix() const;
+	int getDepth() const { return depth; }
+
 	// Prints out the specified matrix
 	static void print(const glm::mat4 &mat, const char *name = 0);
 	// Prints out the top matrix
 	void print(const char *name = 0) const;
-	
+
 private:
-	std::shared_ptr< std::stack<glm::mat4> > mstack;
-	
+	struct Entry
+	{
+		glm::vec3 col[4]; // top three rows, by column
+		glm::vec4 row; // bottom row, (0, 0, 0, 1) unless projective
+		bool projective;
+	};
+
+	void set(Entry &e, const glm::mat4 &m);
+	glm::mat4 expand(const Entry &e) const;
+
+	Entry entries[CAPACITY];
+	int depth; // index of the top entry
+	mutable glm::mat4 top;
+	mutable bool topValid;
 };
 
 #endif
@@ -0,0 +1,70 @@
+#include "MeshCache.h"
+
+#include <functional>
+#include <tuple>
+
+using namespace std;
+
+bool MeshCache::Key::operator<(const Key &other) const
+{
+	// Profiles are compared by address, as std::less allows.
+	less<MeshGenerator::Profile> before;
+	if(profile != other.profile) {
+		return before(profile, other.profile);
+	}
+	return tie(kind, segments[0], segments[1], sizes[0], sizes[1], layout) <
+		tie(other.kind, other.segments[0], other.segments[1], other.sizes[0], other.sizes[1], other.layout);
+}
+
+MeshCache::MeshCache() :
+	hits(0)
+{
+}
+
+template <typename F>
+shared_ptr<Shape> MeshCache::get(const Key &key, F generate)
+{
+	auto found = shapes.find(key);
+	if(found != shapes.end()) {
+		hits++;
+		return found->second;
+	}
+	MeshGenerator::Mesh mesh;
+	generate(mesh);
+	auto shape = make_shared<Shape>();
+	shape->loadMesh(mesh);
+	shape->setLayout(key.layout);
+	shape->init();
+	shapes[key] = shape;
+	return shape;
+}
+
+shared_ptr<Shape> MeshCache::sphere(int slices, int stacks, float radius, Shape::Layout layout)
+{
+	Key key = {SPHERE, {slices, stacks}, {radius, 0.0f}, nullptr, layout};
+	return get(key, [&](MeshGenerator::Mesh &mesh) { MeshGenerator::sphere(mesh, slices, stacks, radius); });
+}
+
+shared_ptr<Shape> MeshCache::grid(int columns, int rows, float width, float height, Shape::Layout layout)
+{
+	Key key = {GRID, {columns, rows}, {width, height}, nullptr, layout};
+	return get(key, [&](MeshGenerator::Mesh &mesh) { MeshGenerator::grid(mesh, columns, rows, width, height); });
+}
+
+shared_ptr<Shape> MeshCache::revolution(int xSegments, int thetaSegments, float length, MeshGenerator::Profile profile, Shape::Layout layout)
+{
+	Key key = {REVOLUTION, {xSegments, thetaSegments}, {length, 0.0f}, profile, layout};
+	return get(key, [&](MeshGenerator::Mesh &mesh) { MeshGenerator::revolution(mesh, xSegments, thetaSegments, length, profile); });
+}
+
+shared_ptr<Shape> MeshCache::cylinder(int slices, int stacks, float radius, float height, Shape::Layout layout)
+{
+	Key key = {CYLINDER, {slices, stacks}, {radius, height}, nullptr, layout};
+	return get(key, [&](MeshGenerator::Mesh &mesh) { MeshGenerator::cylinder(mesh, slices, stacks, radius, height); });
+}
+
+shared_ptr<Shape> MeshCache::torus(int slices, int rings, float majorRadius, float minorRadius, Shape::Layout layout)
+{
+	Key key = {TORUS, {slices, rings}, {majorRadius, minorRadius}, nullptr, layout};
+	return get(key, [&](MeshGenerator::Mesh &mesh) { MeshGenerator::torus(mesh, slices, rings, majorRadius, minorRadius); });
+}
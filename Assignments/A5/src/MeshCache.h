@@ -0,0 +1,50 @@
+#pragma once
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <map>
+#include <memory>
+
+#include "MeshGenerator.h"
+#include "Shape.h"
+
+/**
+ * Generated meshes as initialized Shapes, keyed by generator and
+ * parameters. Asking again with the same parameters (and layout) returns
+ * the same Shape, so every object drawn with it shares one set of GPU
+ * buffers. Needs an OpenGL context.
+ */
+class MeshCache
+{
+public:
+	MeshCache();
+	std::shared_ptr<Shape> sphere(int slices, int stacks, float radius = 1.0f, Shape::Layout layout = Shape::PLANAR);
+	std::shared_ptr<Shape> grid(int columns, int rows, float width = 1.0f, float height = 1.0f, Shape::Layout layout = Shape::PLANAR);
+	std::shared_ptr<Shape> revolution(int xSegments, int thetaSegments, float length, MeshGenerator::Profile profile = nullptr, Shape::Layout layout = Shape::PLANAR);
+	std::shared_ptr<Shape> cylinder(int slices, int stacks, float radius = 1.0f, float height = 1.0f, Shape::Layout layout = Shape::PLANAR);
+	std::shared_ptr<Shape> torus(int slices, int rings, float majorRadius = 1.0f, float minorRadius = 0.25f, Shape::Layout layout = Shape::PLANAR);
+	size_t getShapeCount() const { return shapes.size(); }
+	size_t getHits() const { return hits; }
+	void clear() { shapes.clear(); }
+
+private:
+	enum Kind { SPHERE, GRID, REVOLUTION, CYLINDER, TORUS };
+	struct Key
+	{
+		Kind kind;
+		int segments[2];
+		float sizes[2];
+		MeshGenerator::Profile profile;
+		Shape::Layout layout;
+		bool operator<(const Key &other) const;
+	};
+
+	// The shape for key, generated with generate(mesh) if new
+	template <typename F>
+	std::shared_ptr<Shape> get(const Key &key, F generate);
+
+	std::map<Key, std::shared_ptr<Shape> > shapes;
+	size_t hits;
+};
+
+#endif
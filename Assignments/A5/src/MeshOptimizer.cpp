@@ -0,0 +1,252 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+using namespace std;
+
+vector<unsigned int> MeshOptimizer::optimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount, int cacheSize)
+{
+	size_t triCount = indices.size()/3;
+	vector<unsigned int> clusters;
+	if(triCount == 0) {
+		return clusters;
+	}
+
+	// Triangles around each vertex, as offsets into one array
+	vector<unsigned int> live(vertexCount, 0);
+	for(unsigned int v : indices) {
+		live[v]++;
+	}
+	vector<unsigned int> offsets(vertexCount + 1, 0);
+	for(size_t v = 0; v < vertexCount; ++v) {
+		offsets[v + 1] = offsets[v] + live[v];
+	}
+	vector<unsigned int> adjacency(indices.size());
+	vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for(size_t t = 0; t < triCount; ++t) {
+		for(int k = 0; k < 3; ++k) {
+			adjacency[fill[indices[3*t + k]]++] = (unsigned int)t;
+		}
+	}
+
+	vector<int> cacheTime(vertexCount, 0);
+	vector<char> emitted(triCount, 0);
+	vector<unsigned int> deadEnd;
+	vector<unsigned int> candidates;
+	vector<unsigned int> out;
+	out.reserve(indices.size());
+	int time = cacheSize + 1;
+	size_t cursor = 0;
+	int fan = 0;
+	clusters.push_back(0);
+
+	while(fan >= 0) {
+		// Emit every remaining triangle around the fanning vertex.
+		candidates.clear();
+		for(unsigned int a = offsets[fan]; a < offsets[fan + 1]; ++a) {
+			unsigned int t = adjacency[a];
+			if(emitted[t]) {
+				continue;
+			}
+			for(int k = 0; k < 3; ++k) {
+				unsigned int v = indices[3*t + k];
+				out.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if(time - cacheTime[v] > cacheSize) {
+					cacheTime[v] = time++;
+				}
+			}
+			emitted[t] = 1;
+		}
+
+		// Next fan: the candidate still in the cache that is furthest along,
+		// provided its remaining triangles won't push it out.
+		int next = -1;
+		int best = -1;
+		for(unsigned int v : candidates) {
+			if(live[v] == 0) {
+				continue;
+			}
+			int priority = 0;
+			if(time - cacheTime[v] + 2*(int)live[v] <= cacheSize) {
+				priority = time - cacheTime[v];
+			}
+			if(priority > best) {
+				best = priority;
+				next = (int)v;
+			}
+		}
+		if(next < 0) {
+			// Dead end: back up through recent vertices, then scan forward.
+			while(!deadEnd.empty() && next < 0) {
+				unsigned int v = deadEnd.back();
+				deadEnd.pop_back();
+				if(live[v] > 0) {
+					next = (int)v;
+				}
+			}
+			while(next < 0 && cursor < vertexCount) {
+				if(live[cursor] > 0) {
+					next = (int)cursor;
+				}
+				++cursor;
+			}
+			if(next >= 0 && out.size()/3 > clusters.back()) {
+				clusters.push_back((unsigned int)(out.size()/3));
+			}
+		}
+		fan = next;
+	}
+	indices.swap(out);
+	return clusters;
+}
+
+void MeshOptimizer::optimizeOverdraw(vector<unsigned int> &indices, const vector<float> &posBuf, const vector<unsigned int> &hardClusters, int cacheSize, float threshold)
+{
+	size_t triCount = indices.size()/3;
+	if(triCount == 0) {
+		return;
+	}
+	size_t vertexCount = posBuf.size()/3;
+	float limit = threshold*simulate(indices, vertexCount, cacheSize, false).acmr;
+
+	// Split the hard clusters wherever the cluster so far, started from a cold
+	// cache, is within the ACMR limit. Moving it then costs at most the limit.
+	vector<unsigned int> clusters;
+	vector<int> cacheTime(vertexCount, -cacheSize - 1);
+	int time = 0;
+	for(size_t c = 0; c < hardClusters.size(); ++c) {
+		size_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triCount;
+		size_t start = hardClusters[c];
+		int misses = 0;
+		clusters.push_back((unsigned int)start);
+		for(size_t t = start; t < end; ++t) {
+			for(int k = 0; k < 3; ++k) {
+				unsigned int v = indices[3*t + k];
+				if(time - cacheTime[v] > cacheSize) {
+					cacheTime[v] = time++;
+					++misses;
+				}
+			}
+			size_t done = t + 1 - clusters.back();
+			if(t + 1 < end && (float)misses/done <= limit) {
+				clusters.push_back((unsigned int)(t + 1));
+				misses = 0;
+				// Start the next cluster cold.
+				time += cacheSize + 1;
+			}
+		}
+		time += cacheSize + 1;
+	}
+
+	// Clusters that face away from the mesh center occlude the rest, so draw
+	// them first.
+	glm::vec3 meshCenter(0.0f);
+	for(size_t v = 0; v < vertexCount; ++v) {
+		meshCenter += glm::vec3(posBuf[3*v], posBuf[3*v + 1], posBuf[3*v + 2]);
+	}
+	meshCenter /= (float)max((size_t)1, vertexCount);
+	vector<pair<float, unsigned int>> order;
+	for(size_t c = 0; c < clusters.size(); ++c) {
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triCount;
+		glm::vec3 center(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for(size_t t = clusters[c]; t < end; ++t) {
+			glm::vec3 p[3];
+			for(int k = 0; k < 3; ++k) {
+				unsigned int v = indices[3*t + k];
+				p[k] = glm::vec3(posBuf[3*v], posBuf[3*v + 1], posBuf[3*v + 2]);
+			}
+			// Cross product length is twice the area, which is fine as a weight.
+			glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+			float a = glm::length(n);
+			center += a*(p[0] + p[1] + p[2])/3.0f;
+			normal += n;
+			area += a;
+		}
+		if(area > 0.0f) {
+			center /= area;
+		}
+		float len = glm::length(normal);
+		if(len > 0.0f) {
+			normal /= len;
+		}
+		order.push_back(make_pair(-glm::dot(center - meshCenter, normal), (unsigned int)c));
+	}
+	stable_sort(order.begin(), order.end());
+
+	vector<unsigned int> out;
+	out.reserve(indices.size());
+	for(const pair<float, unsigned int> &o : order) {
+		size_t c = o.second;
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triCount;
+		out.insert(out.end(), indices.begin() + 3*clusters[c], indices.begin() + 3*end);
+	}
+	indices.swap(out);
+}
+
+vector<unsigned int> MeshOptimizer::optimizeVertexFetch(vector<unsigned int> &indices, size_t vertexCount)
+{
+	const unsigned int unused = ~0u;
+	vector<unsigned int> remap(vertexCount, unused);
+	unsigned int next = 0;
+	for(unsigned int &v : indices) {
+		if(remap[v] == unused) {
+			remap[v] = next++;
+		}
+		v = remap[v];
+	}
+	// Vertices no triangle uses go at the end.
+	for(unsigned int &r : remap) {
+		if(r == unused) {
+			r = next++;
+		}
+	}
+	return remap;
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::simulate(const vector<unsigned int> &indices, size_t vertexCount, int cacheSize, bool lru)
+{
+	CacheStats stats = {0.0f, 0.0f};
+	if(indices.empty() || vertexCount == 0) {
+		return stats;
+	}
+	size_t misses = 0;
+	if(lru) {
+		// Most recently used first
+		vector<unsigned int> cache;
+		for(unsigned int v : indices) {
+			auto it = find(cache.begin(), cache.end(), v);
+			if(it == cache.end()) {
+				++misses;
+				cache.insert(cache.begin(), v);
+				if((int)cache.size() > cacheSize) {
+					cache.pop_back();
+				}
+			} else {
+				rotate(cache.begin(), it, it + 1);
+			}
+		}
+	} else {
+		// A vertex is in a FIFO cache if fewer than cacheSize vertices have
+		// been added since it was.
+		vector<long long> added(vertexCount, -(long long)cacheSize - 1);
+		long long time = 0;
+		for(unsigned int v : indices) {
+			if(time - added[v] > cacheSize) {
+				added[v] = time++;
+				++misses;
+			}
+		}
+	}
+	stats.acmr = (float)misses/(indices.size()/3);
+	stats.atvr = (float)misses/vertexCount;
+	return stats;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Reorders indexed triangle lists for the GPU:
+ * - optimizeVertexCache() runs Tipsify (Sander et al. 2007) to improve the
+ *   post-transform vertex cache hit rate.
+ * - optimizeOverdraw() cuts that order into clusters that each start with a
+ *   cold cache at an ACMR within threshold of the whole mesh's, then sorts the
+ *   clusters so that those facing out from the mesh center are drawn first.
+ * - optimizeVertexFetch() renumbers the vertices in order of first use.
+ * simulate() runs a FIFO or LRU post-transform cache over an index list and
+ * reports ACMR (transformed vertices per triangle) and ATVR (transformed
+ * vertices per vertex; 1.0 is ideal).
+ */
+class MeshOptimizer
+{
+public:
+	struct CacheStats
+	{
+		float acmr;
+		float atvr;
+	};
+
+	// Vertex cache statistics of a mesh before and after optimization
+	struct Report
+	{
+		CacheStats fifoBefore;
+		CacheStats lruBefore;
+		CacheStats fifoAfter;
+		CacheStats lruAfter;
+	};
+
+	// Returns the triangle index at which every cluster starts (Tipsify's
+	// dead ends), for optimizeOverdraw().
+	static std::vector<unsigned int> optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount, int cacheSize = 16);
+	static void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<float> &posBuf, const std::vector<unsigned int> &clusters, int cacheSize = 16, float threshold = 1.05f);
+	// Returns remap[old vertex] = new vertex; apply it to every vertex attribute.
+	static std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int> &indices, size_t vertexCount);
+	template <typename T> static void remapVertices(std::vector<T> &buf, int components, const std::vector<unsigned int> &remap);
+
+	static CacheStats simulate(const std::vector<unsigned int> &indices, size_t vertexCount, int cacheSize, bool lru);
+};
+
+template <typename T>
+void MeshOptimizer::remapVertices(std::vector<T> &buf, int components, const std::vector<unsigned int> &remap)
+{
+	if(buf.empty()) {
+		return;
+	}
+	std::vector<T> out(buf.size());
+	for(size_t v = 0; v < remap.size(); ++v) {
+		for(int c = 0; c < components; ++c) {
+			out[remap[v]*components + c] = buf[v*components + c];
+		}
+	}
+	buf.swap(out);
+}
+
+#endif
@@ -0,0 +1,287 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <unordered_map>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+using namespace std;
+
+namespace {
+
+// Symmetric 4x4 matrix, upper triangle by rows
+struct Quadric
+{
+	double a[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+	void addPlane(const glm::vec3 &n, float d, double w)
+	{
+		double p[4] = {n.x, n.y, n.z, d};
+		int k = 0;
+		for(int i = 0; i < 4; ++i) {
+			for(int j = i; j < 4; ++j) {
+				a[k++] += w*p[i]*p[j];
+			}
+		}
+	}
+
+	void add(const Quadric &q)
+	{
+		for(int k = 0; k < 10; ++k) {
+			a[k] += q.a[k];
+		}
+	}
+
+	double error(const glm::vec3 &v) const
+	{
+		double x = v.x, y = v.y, z = v.z;
+		return a[0]*x*x + 2*a[1]*x*y + 2*a[2]*x*z + 2*a[3]*x
+			+ a[4]*y*y + 2*a[5]*y*z + 2*a[6]*y
+			+ a[7]*z*z + 2*a[8]*z
+			+ a[9];
+	}
+};
+
+struct Collapse
+{
+	double cost;
+	int from;
+	int to;
+	unsigned stampFrom;
+	unsigned stampTo;
+	bool operator<(const Collapse &other) const { return cost > other.cost; }
+};
+
+struct PositionKey
+{
+	float p[3];
+	bool operator==(const PositionKey &other) const { return memcmp(p, other.p, sizeof(p)) == 0; }
+};
+
+struct PositionKeyHash
+{
+	size_t operator()(const PositionKey &key) const
+	{
+		const unsigned char *b = (const unsigned char *)key.p;
+		size_t h = 14695981039346656037ull;
+		for(size_t i = 0; i < sizeof(key.p); ++i) {
+			h = (h ^ b[i]) * 1099511628211ull;
+		}
+		return h;
+	}
+};
+
+}
+
+vector<MeshSimplifier::Mesh> MeshSimplifier::simplify(const Mesh &mesh, const vector<size_t> &targets)
+{
+	vector<Mesh> lods;
+	size_t nverts = mesh.posBuf.size()/3;
+
+	// Merge vertices that share a position. rep[p] is the original vertex
+	// whose attributes position p keeps.
+	vector<int> positionOf(nverts);
+	vector<int> rep;
+	vector<glm::vec3> pos;
+	unordered_map<PositionKey, int, PositionKeyHash> positions;
+	for(size_t v = 0; v < nverts; ++v) {
+		PositionKey key = {{mesh.posBuf[3*v], mesh.posBuf[3*v + 1], mesh.posBuf[3*v + 2]}};
+		auto inserted = positions.insert(make_pair(key, (int)rep.size()));
+		if(inserted.second) {
+			rep.push_back((int)v);
+			pos.push_back(glm::vec3(key.p[0], key.p[1], key.p[2]));
+		}
+		positionOf[v] = inserted.first->second;
+	}
+	int npos = (int)pos.size();
+
+	vector<int> tris;
+	for(size_t i = 0; i + 2 < mesh.eleBuf.size(); i += 3) {
+		int a = positionOf[mesh.eleBuf[i]];
+		int b = positionOf[mesh.eleBuf[i + 1]];
+		int c = positionOf[mesh.eleBuf[i + 2]];
+		if(a != b && b != c && c != a) {
+			tris.push_back(a);
+			tris.push_back(b);
+			tris.push_back(c);
+		}
+	}
+	int ntris = (int)tris.size()/3;
+	vector<char> triRemoved(ntris, 0);
+	vector<vector<int>> vertTris(npos);
+	vector<Quadric> quadrics(npos);
+	map<pair<int, int>, int> edgeUse;
+	for(int t = 0; t < ntris; ++t) {
+		const int *v = &tris[3*t];
+		glm::vec3 n = glm::cross(pos[v[1]] - pos[v[0]], pos[v[2]] - pos[v[0]]);
+		float area = glm::length(n);
+		if(area > 0.0f) {
+			n /= area;
+		}
+		Quadric q;
+		q.addPlane(n, -glm::dot(n, pos[v[0]]), area);
+		for(int k = 0; k < 3; ++k) {
+			vertTris[v[k]].push_back(t);
+			quadrics[v[k]].add(q);
+			int a = v[k], b = v[(k + 1) % 3];
+			edgeUse[make_pair(min(a, b), max(a, b))]++;
+		}
+	}
+	// Keep open boundaries in place with heavy planes through each boundary
+	// edge, perpendicular to its triangle.
+	for(int t = 0; t < ntris; ++t) {
+		const int *v = &tris[3*t];
+		glm::vec3 n = glm::cross(pos[v[1]] - pos[v[0]], pos[v[2]] - pos[v[0]]);
+		for(int k = 0; k < 3; ++k) {
+			int a = v[k], b = v[(k + 1) % 3];
+			if(edgeUse[make_pair(min(a, b), max(a, b))] != 1) {
+				continue;
+			}
+			glm::vec3 e = pos[b] - pos[a];
+			glm::vec3 bn = glm::cross(e, n);
+			float len = glm::length(bn);
+			if(len <= 0.0f) {
+				continue;
+			}
+			bn /= len;
+			Quadric q;
+			q.addPlane(bn, -glm::dot(bn, pos[a]), 1000.0*glm::dot(e, e));
+			quadrics[a].add(q);
+			quadrics[b].add(q);
+		}
+	}
+
+	vector<char> vertRemoved(npos, 0);
+	vector<unsigned> stamp(npos, 0);
+	vector<int> mark(npos, -1);
+	int markId = 0;
+	priority_queue<Collapse> heap;
+	auto push = [&](int a, int b) {
+		Quadric q = quadrics[a];
+		q.add(quadrics[b]);
+		heap.push({q.error(pos[b]), a, b, stamp[a], stamp[b]});
+	};
+	for(const auto &e : edgeUse) {
+		push(e.first.first, e.first.second);
+		push(e.first.second, e.first.first);
+	}
+
+	// Merging from into to must not flip a triangle or pinch the surface (the
+	// two vertices may share only the two neighbors across the edge).
+	auto valid = [&](int from, int to) {
+		++markId;
+		for(int t : vertTris[to]) {
+			if(!triRemoved[t]) {
+				for(int k = 0; k < 3; ++k) mark[tris[3*t + k]] = markId;
+			}
+		}
+		int shared = 0;
+		++markId;
+		for(int t : vertTris[from]) {
+			if(triRemoved[t]) {
+				continue;
+			}
+			int *v = &tris[3*t];
+			bool hasTo = v[0] == to || v[1] == to || v[2] == to;
+			for(int k = 0; k < 3; ++k) {
+				int w = v[k];
+				if(w != from && w != to && mark[w] == markId - 1) {
+					// Count each shared neighbor once.
+					mark[w] = markId;
+					++shared;
+				}
+			}
+			if(hasTo) {
+				continue;
+			}
+			glm::vec3 p[3], q[3];
+			for(int k = 0; k < 3; ++k) {
+				p[k] = pos[v[k]];
+				q[k] = v[k] == from ? pos[to] : pos[v[k]];
+			}
+			glm::vec3 n0 = glm::cross(p[1] - p[0], p[2] - p[0]);
+			glm::vec3 n1 = glm::cross(q[1] - q[0], q[2] - q[0]);
+			float l0 = glm::length(n0), l1 = glm::length(n1);
+			if(l1 <= 0.0f || (l0 > 0.0f && glm::dot(n0, n1) < 0.2f*l0*l1)) {
+				return false;
+			}
+		}
+		return shared <= 2;
+	};
+
+	int live = ntris;
+	for(size_t target : targets) {
+		while(live > (int)target && !heap.empty()) {
+			Collapse c = heap.top();
+			heap.pop();
+			if(vertRemoved[c.from] || vertRemoved[c.to] || c.stampFrom != stamp[c.from] || c.stampTo != stamp[c.to]) {
+				continue;
+			}
+			if(!valid(c.from, c.to)) {
+				continue;
+			}
+			for(int t : vertTris[c.from]) {
+				if(triRemoved[t]) {
+					continue;
+				}
+				int *v = &tris[3*t];
+				if(v[0] == c.to || v[1] == c.to || v[2] == c.to) {
+					triRemoved[t] = 1;
+					--live;
+				} else {
+					for(int k = 0; k < 3; ++k) {
+						if(v[k] == c.from) v[k] = c.to;
+					}
+					vertTris[c.to].push_back(t);
+				}
+			}
+			vertRemoved[c.from] = 1;
+			vertTris[c.from].clear();
+			quadrics[c.to].add(quadrics[c.from]);
+			++stamp[c.to];
+			vector<int> &around = vertTris[c.to];
+			around.erase(remove_if(around.begin(), around.end(), [&](int t) { return triRemoved[t] != 0; }), around.end());
+			++markId;
+			for(int t : around) {
+				for(int k = 0; k < 3; ++k) {
+					int w = tris[3*t + k];
+					if(w != c.to && mark[w] != markId) {
+						mark[w] = markId;
+						push(c.to, w);
+						push(w, c.to);
+					}
+				}
+			}
+		}
+
+		// Snapshot the current mesh with only the vertices still in use.
+		Mesh lod;
+		vector<int> index(npos, -1);
+		for(int t = 0; t < ntris; ++t) {
+			if(triRemoved[t]) {
+				continue;
+			}
+			for(int k = 0; k < 3; ++k) {
+				int p = tris[3*t + k];
+				if(index[p] < 0) {
+					index[p] = (int)lod.posBuf.size()/3;
+					int v = rep[p];
+					lod.posBuf.insert(lod.posBuf.end(), &mesh.posBuf[3*v], &mesh.posBuf[3*v] + 3);
+					if(!mesh.norBuf.empty()) {
+						lod.norBuf.insert(lod.norBuf.end(), &mesh.norBuf[3*v], &mesh.norBuf[3*v] + 3);
+					}
+					if(!mesh.texBuf.empty()) {
+						lod.texBuf.insert(lod.texBuf.end(), &mesh.texBuf[2*v], &mesh.texBuf[2*v] + 2);
+					}
+				}
+				lod.eleBuf.push_back(index[p]);
+			}
+		}
+		lods.push_back(lod);
+	}
+	return lods;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Quadric error metric simplification (Garland and Heckbert 1997) by
+ * half-edge collapses: a vertex is merged into a neighbor, which keeps its
+ * position, normal, and texture coords. Collapses that would flip a triangle
+ * are skipped, and open boundaries are held in place by extra planes.
+ *
+ * The collapses work on positions, so vertices that were only split for
+ * different normals or texture coords are merged and take the attributes of
+ * one of them. That is fine for distant LODs but not for the full mesh.
+ */
+class MeshSimplifier
+{
+public:
+	struct Mesh
+	{
+		std::vector<float> posBuf;
+		std::vector<float> norBuf;
+		std::vector<float> texBuf;
+		std::vector<unsigned int> eleBuf;
+	};
+
+	// Simplifies once down to each triangle count in targets (largest first)
+	// and returns one mesh per target.
+	static std::vector<Mesh> simplify(const Mesh &mesh, const std::vector<size_t> &targets);
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+vector<Meshlets::Meshlet> Meshlets::build(vector<unsigned int> &indices, const vector<float> &posBuf, int maxVertices, int maxTriangles)
+{
+	vector<Meshlet> meshlets;
+	size_t triCount = indices.size()/3;
+	size_t vertexCount = posBuf.size()/3;
+	if(triCount == 0) {
+		return meshlets;
+	}
+	auto position = [&](unsigned int v) { return glm::vec3(posBuf[3*v], posBuf[3*v + 1], posBuf[3*v + 2]); };
+
+	// Unit normal of each triangle, zero if degenerate
+	vector<glm::vec3> normals(triCount);
+	for(size_t t = 0; t < triCount; ++t) {
+		glm::vec3 p0 = position(indices[3*t]);
+		glm::vec3 n = glm::cross(position(indices[3*t + 1]) - p0, position(indices[3*t + 2]) - p0);
+		float len = glm::length(n);
+		normals[t] = len > 0.0f ? n/len : glm::vec3(0.0f);
+	}
+
+	// Triangles around each vertex, as offsets into one array
+	vector<unsigned int> offsets(vertexCount + 1, 0);
+	for(unsigned int v : indices) {
+		offsets[v + 1]++;
+	}
+	for(size_t v = 0; v < vertexCount; ++v) {
+		offsets[v + 1] += offsets[v];
+	}
+	vector<unsigned int> adjacency(indices.size());
+	vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for(size_t t = 0; t < triCount; ++t) {
+		for(int k = 0; k < 3; ++k) {
+			adjacency[fill[indices[3*t + k]]++] = (unsigned int)t;
+		}
+	}
+
+	// Grow each meshlet from the first free triangle (in the current, cache
+	// friendly order) by adding the neighbor that brings the fewest new
+	// vertices, preferring ones that face the same way to keep the cone narrow.
+	vector<int> owner(triCount, -1);
+	vector<int> vertexOwner(vertexCount, -1);
+	vector<unsigned int> candidates;
+	vector<unsigned int> members;
+	vector<unsigned int> out;
+	out.reserve(indices.size());
+	size_t seed = 0;
+	while(true) {
+		while(seed < triCount && owner[seed] >= 0) {
+			++seed;
+		}
+		if(seed == triCount) {
+			break;
+		}
+		int id = (int)meshlets.size();
+		Meshlet m;
+		m.first = (unsigned int)(out.size()/3);
+		m.count = 0;
+		int verts = 0;
+		glm::vec3 normalSum(0.0f);
+		candidates.clear();
+		members.clear();
+		size_t t = seed;
+		while(true) {
+			owner[t] = id;
+			members.push_back((unsigned int)t);
+			m.count++;
+			normalSum += normals[t];
+			for(int k = 0; k < 3; ++k) {
+				unsigned int v = indices[3*t + k];
+				out.push_back(v);
+				if(vertexOwner[v] != id) {
+					vertexOwner[v] = id;
+					++verts;
+				}
+				for(unsigned int a = offsets[v]; a < offsets[v + 1]; ++a) {
+					if(owner[adjacency[a]] < 0) {
+						candidates.push_back(adjacency[a]);
+					}
+				}
+			}
+			if((int)m.count == maxTriangles) {
+				break;
+			}
+			float len = glm::length(normalSum);
+			glm::vec3 axis = len > 0.0f ? normalSum/len : glm::vec3(0.0f);
+			int best = -1;
+			float bestScore = 0.0f;
+			for(size_t i = 0; i < candidates.size();) {
+				unsigned int c = candidates[i];
+				if(owner[c] >= 0) {
+					candidates[i] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+				int added = 0;
+				for(int k = 0; k < 3; ++k) {
+					if(vertexOwner[indices[3*c + k]] != id) {
+						++added;
+					}
+				}
+				float score = added + (1.0f - glm::dot(normals[c], axis));
+				if(verts + added <= maxVertices && (best < 0 || score < bestScore || (score == bestScore && (int)c < best))) {
+					best = (int)c;
+					bestScore = score;
+				}
+				++i;
+			}
+			if(best < 0) {
+				break;
+			}
+			t = (size_t)best;
+		}
+
+		// Bounding sphere around the box of the meshlet's vertices
+		glm::vec3 vmin = position(out[3*m.first]);
+		glm::vec3 vmax = vmin;
+		for(size_t i = 3*m.first; i < out.size(); ++i) {
+			vmin = glm::min(vmin, position(out[i]));
+			vmax = glm::max(vmax, position(out[i]));
+		}
+		m.center = 0.5f*(vmin + vmax);
+		m.radius = 0.0f;
+		for(size_t i = 3*m.first; i < out.size(); ++i) {
+			m.radius = max(m.radius, glm::length(position(out[i]) - m.center));
+		}
+
+		// Normal cone. Past about 84 degrees it would never cull anything.
+		float len = glm::length(normalSum);
+		m.coneAxis = len > 0.0f ? normalSum/len : glm::vec3(0.0f, 0.0f, 1.0f);
+		float mindp = len > 0.0f ? 1.0f : -1.0f;
+		for(unsigned int c : members) {
+			if(normals[c] != glm::vec3(0.0f)) {
+				mindp = min(mindp, glm::dot(normals[c], m.coneAxis));
+			}
+		}
+		m.coneCutoff = mindp <= 0.1f ? 1.0f : sqrt(1.0f - mindp*mindp);
+		meshlets.push_back(m);
+	}
+	indices.swap(out);
+	return meshlets;
+}
+
+void Meshlets::cull(const vector<Meshlet> &meshlets, const glm::mat4 &P, const glm::mat4 &MV, vector<Range> &ranges, Stats &stats)
+{
+	// Frustum planes in object space (Gribb and Hartmann 2001), normalized so
+	// that they give distances.
+	glm::mat4 M = P*MV;
+	glm::vec4 planes[6];
+	for(int i = 0; i < 3; ++i) {
+		glm::vec4 row(M[0][i], M[1][i], M[2][i], M[3][i]);
+		glm::vec4 w(M[0][3], M[1][3], M[2][3], M[3][3]);
+		planes[2*i] = w + row;
+		planes[2*i + 1] = w - row;
+	}
+	for(glm::vec4 &plane : planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+	// Facing is preserved by any affine map with a positive determinant, so
+	// the cones can be tested in object space against the eye moved there.
+	bool cones = glm::determinant(glm::mat3(MV)) > 0.0f;
+	glm::vec3 eye = glm::vec3(glm::inverse(MV)[3]);
+
+	ranges.clear();
+	for(const Meshlet &m : meshlets) {
+		stats.clusters++;
+		stats.triangles += m.count;
+		bool visible = true;
+		for(const glm::vec4 &plane : planes) {
+			if(glm::dot(glm::vec3(plane), m.center) + plane.w < -m.radius) {
+				visible = false;
+				stats.frustumCulled++;
+				break;
+			}
+		}
+		if(visible && cones) {
+			glm::vec3 v = m.center - eye;
+			if(glm::dot(v, m.coneAxis) >= m.coneCutoff*glm::length(v) + m.radius) {
+				visible = false;
+				stats.coneCulled++;
+			}
+		}
+		if(!visible) {
+			stats.trianglesCulled += m.count;
+		} else if(!ranges.empty() && ranges.back().first + ranges.back().count == m.first) {
+			ranges.back().count += m.count;
+		} else {
+			ranges.push_back({m.first, m.count});
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <cstddef>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+/**
+ * Splits an indexed triangle list into meshlets (clusters) of up to
+ * maxTriangles connected triangles and maxVertices vertices, and culls them on
+ * the CPU each frame.
+ *
+ * build() reorders the indices so that each meshlet is one contiguous range.
+ * Every meshlet has a bounding sphere and a normal cone (Shirman and Abi-Ezzi
+ * 1993): if the whole sphere sees only the backs of the triangles, the
+ * meshlet can be skipped. cull() tests the meshlets against the view frustum
+ * and the cones and returns the visible triangle ranges, with neighboring
+ * ranges merged, ready for glMultiDrawElements().
+ */
+class Meshlets
+{
+public:
+	struct Meshlet
+	{
+		unsigned int first; // first triangle
+		unsigned int count; // number of triangles
+		glm::vec3 center;
+		float radius;
+		glm::vec3 coneAxis;
+		float coneCutoff; // sine of the cone half angle; 1 never culls
+	};
+
+	struct Range
+	{
+		unsigned int first;
+		unsigned int count;
+	};
+
+	// Accumulated over calls to cull()
+	struct Stats
+	{
+		size_t clusters = 0;
+		size_t frustumCulled = 0;
+		size_t coneCulled = 0;
+		size_t triangles = 0;
+		size_t trianglesCulled = 0;
+	};
+
+	static std::vector<Meshlet> build(std::vector<unsigned int> &indices, const std::vector<float> &posBuf, int maxVertices = 64, int maxTriangles = 126);
+	// P and MV are the matrices the mesh is drawn with. Clears ranges.
+	static void cull(const std::vector<Meshlet> &meshlets, const glm::mat4 &P, const glm::mat4 &MV, std::vector<Range> &ranges, Stats &stats);
+};
+
+#endif
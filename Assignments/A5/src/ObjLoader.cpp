@@ -0,0 +1,506 @@
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "MappedFile.h"
+#include "Parallel.h"
+
+using namespace std;
+
+namespace {
+
+// A 'g' or 'o' line: the faces from firstIndex on belong to a shape called name.
+struct Group
+{
+	size_t firstIndex;
+	string name;
+};
+
+enum { V, VN, VT };
+
+// Shift of the bits of a parseTriple() mask that tell which attributes a
+// corner gives
+const int GIVEN = 3;
+
+// What one chunk of lines holds. Relative indices are stored counted from
+// the chunk's first vertex (so they may be negative), and listed in relative
+// as 3*(position in indices) + attribute.
+struct Chunk
+{
+	const char *begin;
+	const char *end;
+	vector<float> v;
+	vector<float> vn;
+	vector<float> vt;
+	vector<tinyobj::index_t> indices;
+	vector<size_t> relative;
+	vector<Group> groups;
+	const char *badFace = nullptr;
+
+	// Called by parseLines()
+	int count(int attribute) const
+	{
+		return attribute == V ? (int)v.size()/3 : attribute == VN ? (int)vn.size()/3 : (int)vt.size()/2;
+	}
+	// Indices reach into earlier chunks, so they are checked once joined.
+	bool inRange(const tinyobj::index_t &, int) const { return true; }
+	void vertex(float x, float y, float z) { v.insert(v.end(), {x, y, z}); }
+	void normal(float x, float y, float z) { vn.insert(vn.end(), {x, y, z}); }
+	void texcoord(float x, float y) { vt.insert(vt.end(), {x, y}); }
+	void triangle(const tinyobj::index_t *corners[3], const int *masks[3])
+	{
+		for(int c = 0; c < 3; ++c) {
+			for(int a = 0; a < 3; ++a) {
+				if(*masks[c] & (1 << a)) {
+					relative.push_back(3*indices.size() + a);
+				}
+			}
+			indices.push_back(*corners[c]);
+		}
+	}
+	void group(const char *name, const char *nameEnd) { groups.push_back({indices.size(), string(name, nameEnd)}); }
+	void progress(const char *) {}
+};
+
+// Feeds a whole file to an ObjLoader::Sink. Relative indices are resolved
+// right away, since every earlier vertex has been seen.
+struct Stream
+{
+	ObjLoader::Sink &sink;
+	MappedFile &file;
+	int counts[3];
+
+	int count(int attribute) const { return counts[attribute]; }
+	// A given index must be in [0, count); one that isn't given is -1. A
+	// relative index that resolves to -1 is not the same as none.
+	bool inRange(const tinyobj::index_t &idx, int mask) const
+	{
+		const int i[3] = {idx.vertex_index, idx.normal_index, idx.texcoord_index};
+		for(int a = 0; a < 3; ++a) {
+			bool given = (mask & (1 << (GIVEN + a))) != 0;
+			if(given ? i[a] < 0 || i[a] >= counts[a] : i[a] != -1) {
+				return false;
+			}
+		}
+		return true;
+	}
+	void vertex(float x, float y, float z) { sink.vertex(x, y, z); counts[V]++; }
+	void normal(float x, float y, float z) { sink.normal(x, y, z); counts[VN]++; }
+	void texcoord(float x, float y) { sink.texcoord(x, y); counts[VT]++; }
+	void triangle(const tinyobj::index_t *corners[3], const int *[3])
+	{
+		tinyobj::index_t t[3] = {*corners[0], *corners[1], *corners[2]};
+		sink.triangle(t);
+	}
+	void group(const char *, const char *) {}
+	void progress(const char *p)
+	{
+		releaseBehind(file, p);
+	}
+
+	// Drops the pages more than 8 MB behind p.
+	static void releaseBehind(MappedFile &file, const char *p)
+	{
+		size_t done = p - file.data;
+		if(done > (8 << 20)) {
+			file.release(done - (8 << 20));
+		}
+	}
+};
+
+inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+inline const char *skipSpace(const char *p, const char *end)
+{
+	while(p < end && isSpace(*p)) {
+		++p;
+	}
+	return p;
+}
+
+inline const char *skipWord(const char *p, const char *end)
+{
+	while(p < end && !isSpace(*p)) {
+		++p;
+	}
+	return p;
+}
+
+// Like tinyobj, a missing or broken number reads as 0.
+const char *parseFloat(const char *p, const char *end, float &x)
+{
+	p = skipSpace(p, end);
+	if(p < end && *p == '+') {
+		++p;
+	}
+	x = 0.0f;
+#if defined(__cpp_lib_to_chars)
+	from_chars_result r = from_chars(p, end, x);
+	if(r.ec == errc()) {
+		return r.ptr;
+	}
+	x = 0.0f;
+#else
+	// No floating point from_chars in this standard library
+	char buf[64];
+	const char *e = skipWord(p, end);
+	size_t n = min((size_t)(e - p), sizeof(buf) - 1);
+	memcpy(buf, p, n);
+	buf[n] = '\0';
+	x = strtof(buf, nullptr);
+#endif
+	return skipWord(p, end);
+}
+
+// Parses one i, i/j, i//k, or i/j/k into idx (zero based, or relative to the
+// chunk for negative indices). Bit a of the returned mask is set if
+// attribute a is relative, and bit GIVEN + a if the corner gives it at all.
+// Returns -1 for an index of 0, which OBJ doesn't have.
+template <typename Target>
+int parseTriple(const char *&p, const char *end, const Target &target, tinyobj::index_t &idx)
+{
+	int mask = 0;
+	bool zero = false;
+	auto number = [&](int attribute, int count) {
+		mask |= 1 << (GIVEN + attribute);
+		int i = 0;
+		if(p < end && *p == '+') {
+			++p;
+		}
+		from_chars_result r = from_chars(p, end, i);
+		p = r.ptr;
+		while(p < end && *p != '/' && !isSpace(*p)) {
+			++p;
+		}
+		if(i > 0) {
+			return i - 1;
+		}
+		if(i < 0) {
+			mask |= 1 << attribute;
+			return count + i;
+		}
+		zero = true;
+		return 0;
+	};
+	idx.vertex_index = number(V, target.count(V));
+	idx.normal_index = -1;
+	idx.texcoord_index = -1;
+	if(p < end && *p == '/') {
+		++p;
+		if(p < end && *p == '/') {
+			++p;
+			idx.normal_index = number(VN, target.count(VN));
+		} else {
+			idx.texcoord_index = number(VT, target.count(VT));
+			if(p < end && *p == '/') {
+				++p;
+				idx.normal_index = number(VN, target.count(VN));
+			}
+		}
+	}
+	return zero ? -1 : mask;
+}
+
+// Calls vertex(), normal(), texcoord(), triangle(), and group() on target
+// for each line of [begin, end), and progress() every 1 MB or so. Stops at
+// a face with a corner that target says is out of range, and returns that
+// line; nullptr if there is none.
+template <typename Target>
+const char *parseLines(const char *begin, const char *stop, Target &target)
+{
+	vector<tinyobj::index_t> face;
+	vector<int> faceMask;
+	const char *p = begin;
+	const char *next = begin + (1 << 20);
+	while(p < stop) {
+		if(p >= next) {
+			target.progress(p);
+			next = p + (1 << 20);
+		}
+		const char *eol = (const char *)memchr(p, '\n', stop - p);
+		if(!eol) {
+			eol = stop;
+		}
+		const char *end = eol;
+		if(end > p && end[-1] == '\r') {
+			--end;
+		}
+		const char *line = p;
+		const char *t = skipSpace(p, end);
+		p = eol + 1;
+		if(end - t < 2) {
+			continue;
+		}
+
+		if(t[0] == 'v' && isSpace(t[1])) {
+			float x, y, z;
+			t = parseFloat(t + 2, end, x);
+			t = parseFloat(t, end, y);
+			parseFloat(t, end, z);
+			target.vertex(x, y, z);
+		} else if(t[0] == 'v' && t[1] == 'n' && end - t > 2 && isSpace(t[2])) {
+			float x, y, z;
+			t = parseFloat(t + 3, end, x);
+			t = parseFloat(t, end, y);
+			parseFloat(t, end, z);
+			target.normal(x, y, z);
+		} else if(t[0] == 'v' && t[1] == 't' && end - t > 2 && isSpace(t[2])) {
+			float x, y;
+			t = parseFloat(t + 3, end, x);
+			parseFloat(t, end, y);
+			target.texcoord(x, y);
+		} else if(t[0] == 'f' && isSpace(t[1])) {
+			face.clear();
+			faceMask.clear();
+			t = skipSpace(t + 2, end);
+			while(t < end) {
+				tinyobj::index_t idx;
+				int mask = parseTriple(t, end, target, idx);
+				if(mask < 0 || !target.inRange(idx, mask)) {
+					return line;
+				}
+				faceMask.push_back(mask);
+				face.push_back(idx);
+				t = skipSpace(t, end);
+			}
+			// Triangle fan, as tinyobj triangulates
+			for(size_t k = 2; k < face.size(); ++k) {
+				const tinyobj::index_t *corners[3] = {&face[0], &face[k - 1], &face[k]};
+				const int *masks[3] = {&faceMask[0], &faceMask[k - 1], &faceMask[k]};
+				target.triangle(corners, masks);
+			}
+		} else if((t[0] == 'g' || t[0] == 'o') && isSpace(t[1])) {
+			// The shape is named by the first word after the keyword, and a 'g'
+			// without one clears the name.
+			const char *n = skipSpace(t + 2, end);
+			target.group(n, skipWord(n, end));
+		}
+	}
+	return nullptr;
+}
+
+// The error message for the face on the line at p
+string badFaceError(const string &filename, const char *p, const char *end)
+{
+	const char *eol = (const char *)memchr(p, '\n', end - p);
+	string line(p, eol ? eol : end);
+	if(!line.empty() && line.back() == '\r') {
+		line.pop_back();
+	}
+	return "Face index out of range in [" + filename + "]: " + line + "\n";
+}
+
+// Counts the vertices, normals, texcoords, and (triangulated) faces of the
+// file without parsing any numbers.
+void countLines(MappedFile &file, size_t counts[4])
+{
+	counts[0] = counts[1] = counts[2] = counts[3] = 0;
+	const char *p = file.data;
+	const char *stop = file.data + file.size;
+	const char *next = p + (1 << 20);
+	while(p < stop) {
+		if(p >= next) {
+			Stream::releaseBehind(file, p);
+			next = p + (1 << 20);
+		}
+		const char *eol = (const char *)memchr(p, '\n', stop - p);
+		if(!eol) {
+			eol = stop;
+		}
+		const char *end = eol;
+		if(end > p && end[-1] == '\r') {
+			--end;
+		}
+		const char *t = skipSpace(p, end);
+		p = eol + 1;
+		if(end - t < 2) {
+			continue;
+		}
+		if(t[0] == 'v' && isSpace(t[1])) {
+			counts[V]++;
+		} else if(t[0] == 'v' && t[1] == 'n' && end - t > 2 && isSpace(t[2])) {
+			counts[VN]++;
+		} else if(t[0] == 'v' && t[1] == 't' && end - t > 2 && isSpace(t[2])) {
+			counts[VT]++;
+		} else if(t[0] == 'f' && isSpace(t[1])) {
+			size_t corners = 0;
+			t = skipSpace(t + 2, end);
+			while(t < end) {
+				++corners;
+				t = skipSpace(skipWord(t, end), end);
+			}
+			counts[3] += corners > 2 ? corners - 2 : 0;
+		}
+	}
+}
+
+}
+
+bool ObjLoader::load(const string &filename, tinyobj::attrib_t *attrib, vector<tinyobj::shape_t> *shapes, string *err, int threads)
+{
+	attrib->vertices.clear();
+	attrib->normals.clear();
+	attrib->texcoords.clear();
+	shapes->clear();
+
+	MappedFile file;
+	if(!file.open(filename)) {
+		if(err) {
+			*err = "Cannot open file [" + filename + "]\n";
+		}
+		return false;
+	}
+
+	// Cut the file at line breaks into chunks of at least 1 MB.
+	if(threads <= 0) {
+		threads = max(1, (int)thread::hardware_concurrency());
+	}
+	size_t count = min((size_t)threads, file.size/(1 << 20) + 1);
+	vector<Chunk> chunks(count);
+	const char *begin = file.data;
+	const char *end = file.data + file.size;
+	for(size_t c = 0; c < count; ++c) {
+		chunks[c].begin = begin;
+		const char *cut = c + 1 == count ? end : file.data + file.size*(c + 1)/count;
+		cut = max(cut, begin);
+		const char *eol = cut < end ? (const char *)memchr(cut, '\n', end - cut) : nullptr;
+		chunks[c].end = eol ? eol + 1 : end;
+		begin = chunks[c].end;
+	}
+
+	parallelFor(count, [&](size_t c) { chunks[c].badFace = parseLines(chunks[c].begin, chunks[c].end, chunks[c]); });
+	for(size_t c = 0; c < count; ++c) {
+		if(chunks[c].badFace) {
+			if(err) {
+				*err = badFaceError(filename, chunks[c].badFace, end);
+			}
+			return false;
+		}
+	}
+
+	// Where each chunk's data goes in the joined arrays
+	vector<size_t> vOffset(count + 1, 0);
+	vector<size_t> vnOffset(count + 1, 0);
+	vector<size_t> vtOffset(count + 1, 0);
+	vector<size_t> indexOffset(count + 1, 0);
+	for(size_t c = 0; c < count; ++c) {
+		vOffset[c + 1] = vOffset[c] + chunks[c].v.size();
+		vnOffset[c + 1] = vnOffset[c] + chunks[c].vn.size();
+		vtOffset[c + 1] = vtOffset[c] + chunks[c].vt.size();
+		indexOffset[c + 1] = indexOffset[c] + chunks[c].indices.size();
+	}
+	attrib->vertices.resize(vOffset[count]);
+	attrib->normals.resize(vnOffset[count]);
+	attrib->texcoords.resize(vtOffset[count]);
+	vector<tinyobj::index_t> indices(indexOffset[count]);
+	int vCount = (int)(vOffset[count]/3);
+	int vnCount = (int)(vnOffset[count]/3);
+	int vtCount = (int)(vtOffset[count]/2);
+	vector<char> outOfRange(count, 0);
+	parallelFor(count, [&](size_t c) {
+		Chunk &chunk = chunks[c];
+		copy(chunk.v.begin(), chunk.v.end(), attrib->vertices.begin() + vOffset[c]);
+		copy(chunk.vn.begin(), chunk.vn.end(), attrib->normals.begin() + vnOffset[c]);
+		copy(chunk.vt.begin(), chunk.vt.end(), attrib->texcoords.begin() + vtOffset[c]);
+		tinyobj::index_t *out = indices.data() + indexOffset[c];
+		copy(chunk.indices.begin(), chunk.indices.end(), out);
+		for(size_t r : chunk.relative) {
+			tinyobj::index_t &idx = out[r/3];
+			int resolved = 0;
+			switch(r % 3) {
+				case V: resolved = idx.vertex_index += (int)(vOffset[c]/3); break;
+				case VN: resolved = idx.normal_index += (int)(vnOffset[c]/3); break;
+				case VT: resolved = idx.texcoord_index += (int)(vtOffset[c]/2); break;
+			}
+			// Before the first one; -1 would otherwise pass for "none" below.
+			if(resolved < 0) {
+				outOfRange[c] = 1;
+			}
+		}
+		// Like stream(), which only allows what has been read so far, but
+		// checked against the whole file
+		for(size_t i = 0; i < chunk.indices.size(); ++i) {
+			const tinyobj::index_t &idx = out[i];
+			if(idx.vertex_index < 0 || idx.vertex_index >= vCount ||
+			   idx.normal_index < -1 || idx.normal_index >= vnCount ||
+			   idx.texcoord_index < -1 || idx.texcoord_index >= vtCount) {
+				outOfRange[c] = 1;
+				break;
+			}
+		}
+		vector<float>().swap(chunk.v);
+		vector<float>().swap(chunk.vn);
+		vector<float>().swap(chunk.vt);
+		vector<tinyobj::index_t>().swap(chunk.indices);
+	});
+
+	if(find(outOfRange.begin(), outOfRange.end(), 1) != outOfRange.end()) {
+		attrib->vertices.clear();
+		attrib->normals.clear();
+		attrib->texcoords.clear();
+		if(err) {
+			*err = "Face index out of range in [" + filename + "]\n";
+		}
+		return false;
+	}
+
+	// Shapes run from one group line to the next; like tinyobj, only those
+	// with faces are kept.
+	vector<pair<size_t, string> > bounds;
+	bounds.push_back(make_pair((size_t)0, string()));
+	for(size_t c = 0; c < count; ++c) {
+		for(const Group &g : chunks[c].groups) {
+			bounds.push_back(make_pair(indexOffset[c] + g.firstIndex, g.name));
+		}
+	}
+	bounds.push_back(make_pair(indices.size(), string()));
+	for(size_t b = 0; b + 1 < bounds.size(); ++b) {
+		size_t first = bounds[b].first;
+		size_t last = bounds[b + 1].first;
+		if(last == first) {
+			continue;
+		}
+		shapes->push_back(tinyobj::shape_t());
+		tinyobj::shape_t &shape = shapes->back();
+		shape.name = bounds[b].second;
+		if(first == 0 && last == indices.size()) {
+			shape.mesh.indices.swap(indices);
+		} else {
+			shape.mesh.indices.assign(indices.begin() + first, indices.begin() + last);
+		}
+		shape.mesh.num_face_vertices.assign((last - first)/3, 3);
+		shape.mesh.material_ids.assign((last - first)/3, -1);
+	}
+	return true;
+}
+
+bool ObjLoader::stream(const string &filename, Sink &sink, string *err)
+{
+	MappedFile file;
+	if(!file.open(filename)) {
+		if(err) {
+			*err = "Cannot open file [" + filename + "]\n";
+		}
+		return false;
+	}
+	size_t counts[4];
+	countLines(file, counts);
+	sink.begin(counts[V], counts[VN], counts[VT], counts[3]);
+	file.rewind();
+	Stream stream = {sink, file, {0, 0, 0}};
+	const char *badFace = parseLines(file.data, file.data + file.size, stream);
+	if(badFace) {
+		if(err) {
+			*err = badFaceError(filename, badFace, file.data + file.size);
+		}
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+
+/**
+ * A faster tinyobj::LoadObj for large OBJ files. The file is memory mapped
+ * and cut at line breaks into one chunk per thread. Each chunk is parsed on
+ * its own (numbers with std::from_chars), and the chunks are then joined
+ * using prefix sums of their vertex and index counts. Relative (negative)
+ * indices are resolved against the vertices of all earlier chunks.
+ *
+ * The result matches tinyobj::LoadObj with triangulation on, except that
+ * materials (mtllib, usemtl) and tags are not read: every face gets material
+ * -1, as it does with tinyobj when there is no .mtl file.
+ */
+class ObjLoader
+{
+public:
+	/**
+	 * Receives a file from stream() line by line. begin() comes first, with the
+	 * exact counts from a quick pass over the file, so the final buffers can
+	 * be sized once. Triangle corners are zero based, -1 if absent, and only
+	 * refer to attributes already passed in: stream() fails at a face that
+	 * refers to any other, before passing it on.
+	 */
+	class Sink
+	{
+	public:
+		virtual ~Sink() {}
+		virtual void begin(size_t vertices, size_t normals, size_t texcoords, size_t triangles) = 0;
+		virtual void vertex(float x, float y, float z) = 0;
+		virtual void normal(float x, float y, float z) = 0;
+		virtual void texcoord(float u, float v) = 0;
+		virtual void triangle(const tinyobj::index_t corners[3]) = 0;
+	};
+
+	// threads = 0 uses one thread per core. Fails if a face refers to an
+	// attribute the file doesn't have.
+	static bool load(const std::string &filename, tinyobj::attrib_t *attrib, std::vector<tinyobj::shape_t> *shapes, std::string *err, int threads = 0);
+	// Single threaded, but holds nothing besides a window of the file, so the
+	// memory used is about what the sink keeps. Groups are ignored.
+	static bool stream(const std::string &filename, Sink &sink, std::string *err);
+};
+
+#endif
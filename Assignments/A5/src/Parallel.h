@@ -0,0 +1,41 @@
+#pragma once
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * Calls f(i) for each i in [0, n), each on its own thread (f(0) on the
+ * calling one), and waits for all of them.
+ */
+template <typename F>
+void parallelFor(size_t n, F f)
+{
+	std::vector<std::thread> workers;
+	for(size_t i = 1; i < n; ++i) {
+		workers.emplace_back(f, i);
+	}
+	if(n > 0) {
+		f(0);
+	}
+	for(std::thread &w : workers) {
+		w.join();
+	}
+}
+
+/**
+ * Splits [0, count) into one range per core, but none shorter than
+ * minCount, and calls f(begin, end) for each range with parallelFor().
+ */
+template <typename F>
+void parallelRanges(size_t count, size_t minCount, F f)
+{
+	size_t cores = std::max(1u, std::thread::hardware_concurrency());
+	size_t n = std::max((size_t)1, std::min(cores, count/std::max(minCount, (size_t)1)));
+	parallelFor(n, [&](size_t i) { f(count*i/n, count*(i + 1)/n); });
+}
+
+#endif
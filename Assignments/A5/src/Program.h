@@ -2,42 +2,113 @@
 #ifndef PROGRAM_H
 #define PROGRAM_H
 
-#include <map>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #define GLEW_STATIC
 #include <GL/glew.h>
 
 /**
  * An OpenGL Program (vertex and fragment shaders)
+ *
+ * init() reflects every active uniform and attribute of the linked program
+ * (glGetActiveUniform() and glGetActiveAttrib()) into a flat array sorted by
+ * the hash of the name. getUniform() and getAttribute() take a Name and
+ * binary search the array by its hash, with no string built per call. What
+ * they return is a handle that converts to the location: look it up once
+ * and keep it for the calls made every frame, or look it up by a constexpr
+ * Name, whose hash is computed at compile time.
  */
 class Program
 {
 public:
+	/**
+	 * The name of a variable and its 32-bit FNV-1a hash. A Name made from a
+	 * literal on the spot is hashed at run time; declare it constexpr to have
+	 * the compiler do it. It keeps the pointer, not a copy, so a std::string
+	 * is passed as c_str() and must outlive the Name.
+	 */
+	class Name
+	{
+	public:
+		constexpr Name(const char *s) : str(s), hash(hashOf(s)) {}
+		static constexpr uint32_t hashOf(const char *s)
+		{
+			uint32_t h = 2166136261u;
+			while(*s) {
+				h = (h ^ (unsigned char)*s++)*16777619u;
+			}
+			return h;
+		}
+		const char *str;
+		uint32_t hash;
+	};
+
+	/**
+	 * A uniform or attribute as reflected at link time. Uniform and
+	 * Attribute are different types, so one can't be used for the other, and
+	 * both convert to the location for glUniform*() and glVertexAttrib*().
+	 */
+	template<int KIND>
+	struct Handle
+	{
+		Handle() : location(-1), type(0), size(0) {}
+		operator GLint() const { return location; }
+		bool isActive() const { return location != -1; }
+		GLint location;
+		GLenum type; // GL_FLOAT_MAT4 etc., 0 if it was added but isn't active
+		GLint size; // number of elements of an array
+	};
+	typedef Handle<0> Uniform;
+	typedef Handle<1> Attribute;
+
 	Program();
 	virtual ~Program();
-	
+
 	void setVerbose(bool v) { verbose = v; }
 	bool isVerbose() const { return verbose; }
-	
+
 	void setShaderNames(const std::string &v, const std::string &f);
 	virtual bool init();
+	// Different after every successful init() of any Program, so handles can
+	// be cached by it; a new Program may get a freed one's address. 0 before
+	// init().
+	unsigned getLinkId() const { return linkId; }
 	virtual void bind();
 	virtual void unbind();
 
-	void addAttribute(const std::string &name);
-	void addUniform(const std::string &name);
-	GLint getAttribute(const std::string &name) const;
-	GLint getUniform(const std::string &name) const;
-	
+	// Active variables are all known after init(). These declare ones the
+	// program uses that the GLSL compiler may have optimized out, so that
+	// looking them up returns location -1 without a warning.
+	void addAttribute(Name name);
+	void addUniform(Name name);
+	Attribute getAttribute(Name name) const;
+	Uniform getUniform(Name name) const;
+
 protected:
 	std::string vShaderName;
 	std::string fShaderName;
-	
+
 private:
+	template<typename H>
+	struct Variable
+	{
+		uint32_t key; // Name::hashOf(name)
+		std::string name; // arrays without the [0]
+		H handle;
+	};
+
+	void reflect();
+	template<typename H>
+	static const H *find(const std::vector<Variable<H> > &vars, const Name &name);
+	template<typename H>
+	static void insert(std::vector<Variable<H> > &vars, const std::string &name, const H &handle);
+
 	GLuint pid;
-	std::map<std::string,GLint> attributes;
-	std::map<std::string,GLint> uniforms;
+	unsigned linkId;
+	std::vector<Variable<Attribute> > attributes;
+	std::vector<Variable<Uniform> > uniforms;
 	bool verbose;
 };
 
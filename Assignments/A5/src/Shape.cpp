@@ -1,22 +1,231 @@
 #include "Shape.h"
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 
+// Ahead of ObjLoader.h, whose include of the header would otherwise leave
+// out the implementation
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
 #include "GLSL.h"
+#include "MeshSimplifier.h"
+#include "ObjLoader.h"
 #include "Program.h"
+#include "StlLoader.h"
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-
 using namespace std;
 
+namespace {
+
+// Hashed at compile time, for bind() to look up whenever the program changes
+constexpr Program::Name A_POS("aPos");
+constexpr Program::Name A_NOR("aNor");
+constexpr Program::Name A_TEX("aTex");
+constexpr Program::Name U_QUANT_SCALE("quantScale");
+constexpr Program::Name U_QUANT_OFFSET("quantOffset");
+constexpr Program::Name U_OCT_NORMALS("octNormals");
+
+}
+
+// A face vertex as it will be stored: position, normal, texture coords
+struct WeldKey
+{
+	float v[8];
+	bool operator==(const WeldKey &other) const
+	{
+		return memcmp(v, other.v, sizeof(v)) == 0;
+	}
+};
+
+struct WeldKeyHash
+{
+	size_t operator()(const WeldKey &key) const
+	{
+		// FNV-1a over the bytes
+		const unsigned char *p = (const unsigned char *)key.v;
+		size_t h = 14695981039346656037ull;
+		for(size_t i = 0; i < sizeof(key.v); ++i) {
+			h = (h ^ p[i]) * 1099511628211ull;
+		}
+		return h;
+	}
+};
+
+// Some OBJ files have different indices for vertex positions, normals, and
+// texture coordinates. For example, a cube corner vertex may have three
+// different normals. Here, we are going to duplicate all such vertices, but
+// only once: face vertices with the same position, normal, and texture coords
+// share one vertex. Besides the output buffers, only the raw attributes and
+// an open addressing table of vertex numbers are held, so the keys live in
+// the output buffers only once.
+class WeldingSink : public ObjLoader::Sink
+{
+public:
+	WeldingSink(vector<float> &posBuf, vector<float> &norBuf, vector<float> &texBuf, vector<unsigned int> &eleBuf) :
+		posBuf(posBuf),
+		norBuf(norBuf),
+		texBuf(texBuf),
+		eleBuf(eleBuf),
+		base(posBuf.size()/3),
+		hasNormals(false),
+		hasTex(false),
+		used(0),
+		count(0)
+	{
+	}
+
+	void begin(size_t vertices, size_t normals, size_t texcoords, size_t triangles)
+	{
+		v.reserve(3*vertices);
+		vn.reserve(3*normals);
+		vt.reserve(2*texcoords);
+		// From the counts of the whole file: vn and vt lines may come after
+		// the first faces.
+		hasNormals = normals > 0;
+		hasTex = texcoords > 0;
+		// Most meshes weld down to about as many vertices as their largest
+		// attribute array.
+		size_t guess = min(3*triangles, max(max(vertices, normals), texcoords));
+		posBuf.reserve(posBuf.size() + 3*guess);
+		if(hasNormals) {
+			norBuf.reserve(norBuf.size() + 3*guess);
+		}
+		if(hasTex) {
+			texBuf.reserve(texBuf.size() + 2*guess);
+		}
+		eleBuf.reserve(eleBuf.size() + 3*triangles);
+		rehash(guess);
+	}
+
+	void vertex(float x, float y, float z) { v.insert(v.end(), {x, y, z}); }
+	void normal(float x, float y, float z) { vn.insert(vn.end(), {x, y, z}); }
+	void texcoord(float s, float t) { vt.insert(vt.end(), {s, t}); }
+
+	void triangle(const tinyobj::index_t corners[3])
+	{
+		for(int c = 0; c < 3; ++c) {
+			const tinyobj::index_t &idx = corners[c];
+			WeldKey key = {};
+			copy(&v[3*idx.vertex_index], &v[3*idx.vertex_index] + 3, key.v);
+			if(hasNormals && idx.normal_index >= 0) {
+				copy(&vn[3*idx.normal_index], &vn[3*idx.normal_index] + 3, key.v + 3);
+			}
+			if(hasTex && idx.texcoord_index >= 0) {
+				copy(&vt[2*idx.texcoord_index], &vt[2*idx.texcoord_index] + 2, key.v + 6);
+			}
+			eleBuf.push_back(find(key));
+			count++;
+		}
+	}
+
+	size_t faceVertices() const { return count; }
+
+private:
+	static constexpr unsigned int EMPTY = ~0u;
+
+	// The vertex number of key, added to the buffers if new
+	unsigned int find(const WeldKey &key)
+	{
+		if(2*(used + 1) > table.size()) {
+			rehash(2*used + 1);
+		}
+		size_t mask = table.size() - 1;
+		for(size_t slot = WeldKeyHash()(key) & mask;; slot = (slot + 1) & mask) {
+			if(table[slot] == EMPTY) {
+				unsigned int vertex = (unsigned int)(posBuf.size()/3);
+				posBuf.insert(posBuf.end(), key.v, key.v + 3);
+				if(hasNormals) {
+					norBuf.insert(norBuf.end(), key.v + 3, key.v + 6);
+				}
+				if(hasTex) {
+					texBuf.insert(texBuf.end(), key.v + 6, key.v + 8);
+				}
+				table[slot] = vertex;
+				used++;
+				return vertex;
+			}
+			if(stored(table[slot]) == key) {
+				return table[slot];
+			}
+		}
+	}
+
+	WeldKey stored(unsigned int vertex) const
+	{
+		WeldKey key = {};
+		copy(&posBuf[3*vertex], &posBuf[3*vertex] + 3, key.v);
+		if(hasNormals) {
+			copy(&norBuf[3*vertex], &norBuf[3*vertex] + 3, key.v + 3);
+		}
+		if(hasTex) {
+			copy(&texBuf[2*vertex], &texBuf[2*vertex] + 2, key.v + 6);
+		}
+		return key;
+	}
+
+	// Sizes the table to hold n vertices at most half full.
+	void rehash(size_t n)
+	{
+		size_t size = 16;
+		while(size < 2*n) {
+			size *= 2;
+		}
+		if(size <= table.size()) {
+			return;
+		}
+		table.assign(size, EMPTY);
+		size_t mask = size - 1;
+		for(size_t vertex = base; vertex < posBuf.size()/3; ++vertex) {
+			size_t slot = WeldKeyHash()(stored((unsigned int)vertex)) & mask;
+			while(table[slot] != EMPTY) {
+				slot = (slot + 1) & mask;
+			}
+			table[slot] = (unsigned int)vertex;
+		}
+	}
+
+	vector<float> &posBuf;
+	vector<float> &norBuf;
+	vector<float> &texBuf;
+	vector<unsigned int> &eleBuf;
+	size_t base; // vertices in the buffers before this file
+	bool hasNormals; // every vertex gets one, zeros if its corner has none
+	bool hasTex;
+	vector<float> v;
+	vector<float> vn;
+	vector<float> vt;
+	vector<unsigned int> table;
+	size_t used;
+	size_t count;
+};
+
 Shape::Shape() :
+	faceVertexCount(0),
 	posBufID(0),
 	norBufID(0),
-	texBufID(0)
+	texBufID(0),
+	eleBufID(0),
+	layout(PLANAR),
+	attributes(POSITION | NORMAL | TEXCOORD),
+	stride(0),
+	norOffset(-1),
+	texOffset(-1),
+	vertBufID(0),
+	quantScale(1.0f),
+	quantOffset(0.0f),
+	halfTex(false),
+	boundsValid(false),
+	attribLink(0),
+	h_pos(-1),
+	h_nor(-1),
+	h_tex(-1),
+	h_quantScale(-1),
+	h_quantOffset(-1),
+	h_octNormals(-1)
 {
 }
 
@@ -24,66 +233,61 @@ Shape::~Shape()
 {
 }
 
-void Shape::loadMesh(const string &meshName)
+void Shape::loadMesh(const string &meshName, bool weld)
 {
-	// Load geometry
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
+	// Load geometry straight into the buffers, without a tinyobj::attrib_t
+	// copy of the whole file in between.
 	string errStr;
-	bool rc = tinyobj::LoadObj(&attrib, &shapes, &materials, &errStr, meshName.c_str());
+	bool rc;
+	if(StlLoader::isStl(meshName) && !weld) {
+		size_t first = posBuf.size();
+		rc = StlLoader::load(meshName, posBuf, norBuf, &errStr);
+		faceVertexCount += (posBuf.size() - first)/3;
+	} else {
+		WeldingSink sink(posBuf, norBuf, texBuf, eleBuf);
+		if(StlLoader::isStl(meshName)) {
+			rc = StlLoader::stream(meshName, sink, &errStr);
+		} else {
+			rc = ObjLoader::stream(meshName, sink, &errStr);
+		}
+		faceVertexCount += sink.faceVertices();
+	}
 	if(!rc) {
 		cerr << errStr << endl;
-	} else {
-		// Some OBJ files have different indices for vertex positions, normals,
-		// and texture coordinates. For example, a cube corner vertex may have
-		// three different normals. Here, we are going to duplicate all such
-		// vertices.
-		// Loop over shapes
-		for(size_t s = 0; s < shapes.size(); s++) {
-			// Loop over faces (polygons)
-			size_t index_offset = 0;
-			for(size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-				size_t fv = shapes[s].mesh.num_face_vertices[f];
-				// Loop over vertices in the face.
-				for(size_t v = 0; v < fv; v++) {
-					// access to vertex
-					tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-					posBuf.push_back(attrib.vertices[3*idx.vertex_index+0]);
-					posBuf.push_back(attrib.vertices[3*idx.vertex_index+1]);
-					posBuf.push_back(attrib.vertices[3*idx.vertex_index+2]);
-					if(!attrib.normals.empty()) {
-						norBuf.push_back(attrib.normals[3*idx.normal_index+0]);
-						norBuf.push_back(attrib.normals[3*idx.normal_index+1]);
-						norBuf.push_back(attrib.normals[3*idx.normal_index+2]);
-					}
-					if(!attrib.texcoords.empty()) {
-						texBuf.push_back(attrib.texcoords[2*idx.texcoord_index+0]);
-						texBuf.push_back(attrib.texcoords[2*idx.texcoord_index+1]);
-					}
-				}
-				index_offset += fv;
-				// per-face material (IGNORE)
-				shapes[s].mesh.material_ids[f];
-			}
+	}
+	bounds.compute(posBuf);
+	boundsValid = true;
+}
+
+void Shape::loadMesh(const MeshGenerator::Mesh &mesh)
+{
+	if(mesh.interleaved) {
+		size_t nverts = mesh.getVertexCount();
+		posBuf.resize(3*nverts);
+		norBuf.resize(3*nverts);
+		texBuf.resize(2*nverts);
+		for(size_t i = 0; i < nverts; ++i) {
+			const float *v = &mesh.vertBuf[8*i];
+			copy(v, v + 3, &posBuf[3*i]);
+			copy(v + 3, v + 6, &norBuf[3*i]);
+			copy(v + 6, v + 8, &texBuf[2*i]);
 		}
+	} else {
+		posBuf = mesh.posBuf;
+		norBuf = mesh.norBuf;
+		texBuf = mesh.texBuf;
 	}
+	eleBuf = mesh.eleBuf;
+	faceVertexCount = eleBuf.size();
+	bounds.compute(posBuf);
+	boundsValid = true;
 }
 
 void Shape::fitToUnitBox()
 {
 	// Scale the vertex positions so that they fit within [-1, +1] in all three dimensions.
-	glm::vec3 vmin(posBuf[0], posBuf[1], posBuf[2]);
-	glm::vec3 vmax(posBuf[0], posBuf[1], posBuf[2]);
-	for(int i = 0; i < (int)posBuf.size(); i += 3) {
-		glm::vec3 v(posBuf[i], posBuf[i+1], posBuf[i+2]);
-		vmin.x = min(vmin.x, v.x);
-		vmin.y = min(vmin.y, v.y);
-		vmin.z = min(vmin.z, v.z);
-		vmax.x = max(vmax.x, v.x);
-		vmax.y = max(vmax.y, v.y);
-		vmax.z = max(vmax.z, v.z);
-	}
+	glm::vec3 vmin = getBounds().vmin;
+	glm::vec3 vmax = getBounds().vmax;
 	glm::vec3 center = 0.5f*(vmin + vmax);
 	glm::vec3 diff = vmax - vmin;
 	float diffmax = diff.x;
@@ -95,60 +299,224 @@ void Shape::fitToUnitBox()
 		posBuf[i+1] = (posBuf[i+1] - center.y) * scale;
 		posBuf[i+2] = (posBuf[i+2] - center.z) * scale;
 	}
+	boundsValid = false;
+}
+
+MeshOptimizer::Report Shape::optimize(int cacheSize)
+{
+	MeshOptimizer::Report report;
+	size_t nverts = getVertexCount();
+	report.fifoBefore = MeshOptimizer::simulate(eleBuf, nverts, cacheSize, false);
+	report.lruBefore = MeshOptimizer::simulate(eleBuf, nverts, cacheSize, true);
+	vector<unsigned int> clusters = MeshOptimizer::optimizeVertexCache(eleBuf, nverts, cacheSize);
+	MeshOptimizer::optimizeOverdraw(eleBuf, posBuf, clusters, cacheSize);
+	vector<unsigned int> remap = MeshOptimizer::optimizeVertexFetch(eleBuf, nverts);
+	MeshOptimizer::remapVertices(posBuf, 3, remap);
+	MeshOptimizer::remapVertices(norBuf, 3, remap);
+	MeshOptimizer::remapVertices(texBuf, 2, remap);
+	report.fifoAfter = MeshOptimizer::simulate(eleBuf, nverts, cacheSize, false);
+	report.lruAfter = MeshOptimizer::simulate(eleBuf, nverts, cacheSize, true);
+	return report;
+}
+
+void Shape::buildLods(const vector<float> &fractions)
+{
+	MeshSimplifier::Mesh mesh;
+	mesh.posBuf = posBuf;
+	mesh.norBuf = norBuf;
+	mesh.texBuf = texBuf;
+	mesh.eleBuf = eleBuf;
+	vector<size_t> targets;
+	for(float f : fractions) {
+		targets.push_back((size_t)(f*getTriangleCount()));
+	}
+	lods.clear();
+	for(MeshSimplifier::Mesh &m : MeshSimplifier::simplify(mesh, targets)) {
+		auto lod = make_shared<Shape>();
+		lod->posBuf.swap(m.posBuf);
+		lod->norBuf.swap(m.norBuf);
+		lod->texBuf.swap(m.texBuf);
+		lod->eleBuf.swap(m.eleBuf);
+		lod->faceVertexCount = lod->eleBuf.size();
+		lod->optimize();
+		lods.push_back(lod);
+	}
+}
+
+void Shape::buildMeshlets(int maxVertices, int maxTriangles)
+{
+	meshlets = Meshlets::build(eleBuf, posBuf, maxVertices, maxTriangles);
+	for(auto &lod : lods) {
+		lod->buildMeshlets(maxVertices, maxTriangles);
+	}
+}
+
+const Shape &Shape::getLod(int level) const
+{
+	if(level <= 0 || lods.empty()) {
+		return *this;
+	}
+	return *lods[min(level, (int)lods.size()) - 1];
+}
+
+const Bounds &Shape::getBounds(bool withObb) const
+{
+	if(!boundsValid || (withObb && !bounds.hasObb)) {
+		bounds.compute(posBuf, withObb);
+		boundsValid = true;
+	}
+	return bounds;
+}
+
+void Shape::getBoundingSphere(glm::vec3 &center, float &radius) const
+{
+	center = getBounds().sphereCenter;
+	radius = getBounds().sphereRadius;
+}
+
+void Shape::setLayout(Layout l, int a, int s)
+{
+	layout = l;
+	attributes = a | POSITION;
+	stride = s;
 }
 
 void Shape::init()
 {
-	// Send the position array to the GPU
-	glGenBuffers(1, &posBufID);
-	glBindBuffer(GL_ARRAY_BUFFER, posBufID);
-	glBufferData(GL_ARRAY_BUFFER, posBuf.size()*sizeof(float), &posBuf[0], GL_STATIC_DRAW);
-	
-	// Send the normal array to the GPU
-	if(!norBuf.empty()) {
-		glGenBuffers(1, &norBufID);
-		glBindBuffer(GL_ARRAY_BUFFER, norBufID);
-		glBufferData(GL_ARRAY_BUFFER, norBuf.size()*sizeof(float), &norBuf[0], GL_STATIC_DRAW);
+	if(layout == INTERLEAVED) {
+		// Pack position, normal, and texture coords of each vertex together.
+		int floats = 3;
+		norOffset = -1;
+		texOffset = -1;
+		if((attributes & NORMAL) && !norBuf.empty()) {
+			norOffset = floats*sizeof(float);
+			floats += 3;
+		}
+		if((attributes & TEXCOORD) && !texBuf.empty()) {
+			texOffset = floats*sizeof(float);
+			floats += 2;
+		}
+		// A larger stride pads each vertex, e.g. to 32 bytes.
+		int strideFloats = max(floats, (stride + 3) / 4);
+		stride = strideFloats*sizeof(float);
+		size_t nverts = posBuf.size()/3;
+		vector<float> vertBuf(nverts*strideFloats, 0.0f);
+		for(size_t i = 0; i < nverts; ++i) {
+			float *v = &vertBuf[i*strideFloats];
+			v[0] = posBuf[3*i+0];
+			v[1] = posBuf[3*i+1];
+			v[2] = posBuf[3*i+2];
+			if(norOffset >= 0) {
+				float *n = v + norOffset/sizeof(float);
+				n[0] = norBuf[3*i+0];
+				n[1] = norBuf[3*i+1];
+				n[2] = norBuf[3*i+2];
+			}
+			if(texOffset >= 0) {
+				float *t = v + texOffset/sizeof(float);
+				t[0] = texBuf[2*i+0];
+				t[1] = texBuf[2*i+1];
+			}
+		}
+		glGenBuffers(1, &vertBufID);
+		glBindBuffer(GL_ARRAY_BUFFER, vertBufID);
+		glBufferData(GL_ARRAY_BUFFER, vertBuf.size()*sizeof(float), &vertBuf[0], GL_STATIC_DRAW);
+	} else if(layout == QUANTIZED) {
+		// Half float attributes need GL 3.0 or the extension (macOS has it).
+		halfTex = GLEW_VERSION_3_0 || GLEW_ARB_half_float_vertex;
+		glm::vec3 vmin = getBounds().vmin;
+		glm::vec3 vmax = getBounds().vmax;
+		quantScale = vmax - vmin;
+		quantOffset = vmin;
+		VertexQuantizer::Format format;
+		vector<unsigned char> vertBuf = VertexQuantizer::pack(posBuf,
+			(attributes & NORMAL) ? norBuf : vector<float>(),
+			(attributes & TEXCOORD) ? texBuf : vector<float>(),
+			vmin, vmax, halfTex, stride, format);
+		stride = format.stride;
+		norOffset = format.norOffset;
+		texOffset = format.texOffset;
+		glGenBuffers(1, &vertBufID);
+		glBindBuffer(GL_ARRAY_BUFFER, vertBufID);
+		glBufferData(GL_ARRAY_BUFFER, vertBuf.size(), &vertBuf[0], GL_STATIC_DRAW);
+	} else {
+		// Send the position array to the GPU
+		glGenBuffers(1, &posBufID);
+		glBindBuffer(GL_ARRAY_BUFFER, posBufID);
+		glBufferData(GL_ARRAY_BUFFER, posBuf.size()*sizeof(float), &posBuf[0], GL_STATIC_DRAW);
+		
+		// Send the normal array to the GPU
+		if(!norBuf.empty()) {
+			glGenBuffers(1, &norBufID);
+			glBindBuffer(GL_ARRAY_BUFFER, norBufID);
+			glBufferData(GL_ARRAY_BUFFER, norBuf.size()*sizeof(float), &norBuf[0], GL_STATIC_DRAW);
+		}
+		
+		// Send the texture array to the GPU
+		if(!texBuf.empty()) {
+			glGenBuffers(1, &texBufID);
+			glBindBuffer(GL_ARRAY_BUFFER, texBufID);
+			glBufferData(GL_ARRAY_BUFFER, texBuf.size()*sizeof(float), &texBuf[0], GL_STATIC_DRAW);
+		}
 	}
 	
-	// Send the texture array to the GPU
-	if(!texBuf.empty()) {
-		glGenBuffers(1, &texBufID);
-		glBindBuffer(GL_ARRAY_BUFFER, texBufID);
-		glBufferData(GL_ARRAY_BUFFER, texBuf.size()*sizeof(float), &texBuf[0], GL_STATIC_DRAW);
+	// Send the element array to the GPU, 16-bit if the vertices allow it
+	if(!eleBuf.empty()) {
+		glGenBuffers(1, &eleBufID);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
+		if(getIndexSize() == sizeof(unsigned short)) {
+			vector<unsigned short> shortBuf(eleBuf.begin(), eleBuf.end());
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortBuf.size()*sizeof(unsigned short), &shortBuf[0], GL_STATIC_DRAW);
+		} else {
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, eleBuf.size()*sizeof(unsigned int), &eleBuf[0], GL_STATIC_DRAW);
+		}
 	}
 	
 	// Unbind the arrays
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	
 	GLSL::checkError(GET_FILE_LINE);
+	
+	for(auto &lod : lods) {
+		lod->setLayout(layout, attributes, stride);
+		lod->init();
+	}
+}
+
+size_t Shape::getIndexSize() const
+{
+	return getVertexCount() < 65536 ? sizeof(unsigned short) : sizeof(unsigned int);
+}
+
+size_t Shape::getUnweldedBytes() const
+{
+	size_t floatsPerVertex = 3 + (norBuf.empty() ? 0 : 3) + (texBuf.empty() ? 0 : 2);
+	return faceVertexCount*floatsPerVertex*sizeof(float);
+}
+
+size_t Shape::getBytes() const
+{
+	return (posBuf.size() + norBuf.size() + texBuf.size())*sizeof(float) + eleBuf.size()*getIndexSize();
+}
+
+VertexQuantizer::Report Shape::getQuantizationReport() const
+{
+	return VertexQuantizer::measure(posBuf, norBuf, texBuf, true);
 }
 
 float Shape::getMinY(){
-    glm::vec3 vmin(posBuf[0], posBuf[1], posBuf[2]);
-    glm::vec3 vmax(posBuf[0], posBuf[1], posBuf[2]);
-    for(int i = 0; i < (int)posBuf.size(); i += 3) {
-        glm::vec3 v(posBuf[i], posBuf[i+1], posBuf[i+2]);
-        vmin.x = min(vmin.x, v.x);
-        vmin.y = min(vmin.y, v.y);
-        vmin.z = min(vmin.z, v.z);
-        vmax.x = max(vmax.x, v.x);
-        vmax.y = max(vmax.y, v.y);
-        vmax.z = max(vmax.z, v.z);
-    }
-    return vmin.y;
+    return getBounds().vmin.y;
 }
 
-void Shape::draw(const shared_ptr<Program> prog) const
+void Shape::bindPlanar() const
 {
 	// Bind position buffer
-	int h_pos = prog->getAttribute("aPos");
 	glEnableVertexAttribArray(h_pos);
 	glBindBuffer(GL_ARRAY_BUFFER, posBufID);
 	glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
 	
 	// Bind normal buffer
-	int h_nor = prog->getAttribute("aNor");
 	if(h_nor != -1 && norBufID != 0) {
 		glEnableVertexAttribArray(h_nor);
 		glBindBuffer(GL_ARRAY_BUFFER, norBufID);
@@ -156,18 +524,83 @@ void Shape::draw(const shared_ptr<Program> prog) const
 	}
 	
 	// Bind texcoords buffer
-	int h_tex = prog->getAttribute("aTex");
 	if(h_tex != -1 && texBufID != 0) {
 		glEnableVertexAttribArray(h_tex);
 		glBindBuffer(GL_ARRAY_BUFFER, texBufID);
 		glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, 0, (const void *)0);
 	}
-	
-	// Draw
-	int count = posBuf.size()/3; // number of indices to be rendered
-	glDrawArrays(GL_TRIANGLES, 0, count);
-	
-	// Disable and unbind
+}
+
+void Shape::bindInterleaved() const
+{
+	// One buffer, every attribute at its offset within the vertex
+	glBindBuffer(GL_ARRAY_BUFFER, vertBufID);
+	glEnableVertexAttribArray(h_pos);
+	glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, stride, (const void *)0);
+	if(h_nor != -1 && norOffset >= 0) {
+		glEnableVertexAttribArray(h_nor);
+		glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, stride, (const void *)(size_t)norOffset);
+	}
+	if(h_tex != -1 && texOffset >= 0) {
+		glEnableVertexAttribArray(h_tex);
+		glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, stride, (const void *)(size_t)texOffset);
+	}
+}
+
+void Shape::bindQuantized() const
+{
+	// Normalized integers come in as [0, 1] and [-1, 1]; the shader maps the
+	// positions to the box and unfolds the normals.
+	glBindBuffer(GL_ARRAY_BUFFER, vertBufID);
+	glEnableVertexAttribArray(h_pos);
+	glVertexAttribPointer(h_pos, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (const void *)0);
+	if(h_nor != -1 && norOffset >= 0) {
+		glEnableVertexAttribArray(h_nor);
+		glVertexAttribPointer(h_nor, 2, GL_SHORT, GL_TRUE, stride, (const void *)(size_t)norOffset);
+	}
+	if(h_tex != -1 && texOffset >= 0) {
+		glEnableVertexAttribArray(h_tex);
+		glVertexAttribPointer(h_tex, 2, halfTex ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE, stride, (const void *)(size_t)texOffset);
+	}
+}
+
+void Shape::bind(const shared_ptr<Program> prog) const
+{
+	// Look the attributes up only when the program changes.
+	if(prog->getLinkId() != attribLink) {
+		attribLink = prog->getLinkId();
+		h_pos = prog->getAttribute(A_POS);
+		h_nor = prog->getAttribute(A_NOR);
+		h_tex = prog->getAttribute(A_TEX);
+		h_quantScale = prog->getUniform(U_QUANT_SCALE);
+		h_quantOffset = prog->getUniform(U_QUANT_OFFSET);
+		h_octNormals = prog->getUniform(U_OCT_NORMALS);
+	}
+	if(layout == INTERLEAVED) {
+		bindInterleaved();
+	} else if(layout == QUANTIZED) {
+		bindQuantized();
+	} else {
+		bindPlanar();
+	}
+	// The decode uniforms must be reset for unquantized shapes too, since
+	// they share the program.
+	bool quantized = layout == QUANTIZED;
+	if(h_quantScale != -1) {
+		glm::vec3 scale = quantized ? quantScale : glm::vec3(1.0f);
+		glUniform3f(h_quantScale, scale.x, scale.y, scale.z);
+	}
+	if(h_quantOffset != -1) {
+		glm::vec3 offset = quantized ? quantOffset : glm::vec3(0.0f);
+		glUniform3f(h_quantOffset, offset.x, offset.y, offset.z);
+	}
+	if(h_octNormals != -1) {
+		glUniform1i(h_octNormals, quantized && norOffset >= 0);
+	}
+}
+
+void Shape::unbind() const
+{
 	if(h_tex != -1) {
 		glDisableVertexAttribArray(h_tex);
 	}
@@ -179,3 +612,77 @@ void Shape::draw(const shared_ptr<Program> prog) const
 	
 	GLSL::checkError(GET_FILE_LINE);
 }
+
+void Shape::draw(const shared_ptr<Program> prog) const
+{
+	bind(prog);
+	
+	// Draw
+	if(eleBufID != 0) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
+		GLenum type = getIndexSize() == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		glDrawElements(GL_TRIANGLES, (GLsizei)eleBuf.size(), type, (const void *)0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	} else {
+		int count = posBuf.size()/3; // number of indices to be rendered
+		glDrawArrays(GL_TRIANGLES, 0, count);
+	}
+	
+	unbind();
+}
+
+void Shape::drawInstanced(const shared_ptr<Program> prog, int instances) const
+{
+	bind(prog);
+	
+	// The core entry points are missing from the legacy contexts of macOS,
+	// which have the ARB ones.
+	if(eleBufID != 0) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
+		GLenum type = getIndexSize() == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		if(GLEW_VERSION_3_1) {
+			glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)eleBuf.size(), type, (const void *)0, instances);
+		} else {
+			glDrawElementsInstancedARB(GL_TRIANGLES, (GLsizei)eleBuf.size(), type, (const void *)0, instances);
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	} else {
+		int count = posBuf.size()/3;
+		if(GLEW_VERSION_3_1) {
+			glDrawArraysInstanced(GL_TRIANGLES, 0, count, instances);
+		} else {
+			glDrawArraysInstancedARB(GL_TRIANGLES, 0, count, instances);
+		}
+	}
+	
+	unbind();
+}
+
+size_t Shape::draw(const shared_ptr<Program> prog, const glm::mat4 &P, const glm::mat4 &MV, Meshlets::Stats &stats) const
+{
+	if(meshlets.empty() || eleBufID == 0) {
+		draw(prog);
+		return getTriangleCount();
+	}
+	Meshlets::cull(meshlets, P, MV, ranges, stats);
+	if(ranges.empty()) {
+		return 0;
+	}
+	size_t triangles = 0;
+	size_t indexSize = getIndexSize();
+	drawCounts.clear();
+	drawOffsets.clear();
+	for(const Meshlets::Range &r : ranges) {
+		drawCounts.push_back((int)(3*r.count));
+		drawOffsets.push_back((const void *)(3*r.first*indexSize));
+		triangles += r.count;
+	}
+	
+	bind(prog);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
+	GLenum type = indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), type, drawOffsets.data(), (GLsizei)drawCounts.size());
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	unbind();
+	return triangles;
+}
@@ -6,33 +6,141 @@
 #include <vector>
 #include <memory>
 
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "MeshGenerator.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "VertexQuantizer.h"
+
 class Program;
 
 /**
- * A shape defined by a list of triangles
- * - posBuf should be of length 3*ntris
- * - norBuf should be of length 3*ntris (if normals are available)
- * - texBuf should be of length 2*ntris (if texture coords are available)
- * posBufID, norBufID, and texBufID are OpenGL buffer identifiers.
+ * A shape defined by a list of indexed triangles
+ * - posBuf should be of length 3*nverts
+ * - norBuf should be of length 3*nverts (if normals are available)
+ * - texBuf should be of length 2*nverts (if texture coords are available)
+ * - eleBuf should be of length 3*ntris
+ * loadMesh() welds face vertices with identical position, normal, and texture
+ * coords into one vertex. The indices are sent to the GPU as 16-bit when there
+ * are fewer than 65536 vertices.
+ * posBufID, norBufID, texBufID, and eleBufID are OpenGL buffer identifiers.
+ *
+ * The bounds are computed when the mesh is loaded and again, on first use,
+ * after anything that moves the vertices (fitToUnitBox()).
+ *
+ * With the INTERLEAVED layout, init() packs the selected attributes into one
+ * buffer (vertBufID) instead of one buffer per attribute, and draw() sets all
+ * of them up from that single buffer.
+ *
+ * The QUANTIZED layout packs one buffer with VertexQuantizer: 16-bit
+ * positions across the bounding box, octahedral normals, and half float
+ * texture coords. draw() sets the quantScale, quantOffset, and octNormals
+ * uniforms for the vertex shader to decode them; other layouts set them to
+ * pass the attributes through.
+ *
+ * buildLods() adds simplified copies of the shape (levels of detail); level 0
+ * is the shape itself.
+ *
+ * buildMeshlets() splits the triangles into meshlets. Drawing with the P and
+ * MV matrices then skips meshlets outside the view frustum or facing away
+ * from the eye, and draws the rest with one glMultiDrawElements() call.
  */
 class Shape
 {
 public:
+	enum Layout { PLANAR, INTERLEAVED, QUANTIZED };
+	enum Attribute { POSITION = 1, NORMAL = 2, TEXCOORD = 4 };
+
 	Shape();
 	virtual ~Shape();
-	void loadMesh(const std::string &meshName);
+	// Loads an OBJ or (by extension) STL file. STL vertices are welded into
+	// indexed ones where position and facet normal match, unless weld is
+	// false; OBJ vertices are always welded.
+	void loadMesh(const std::string &meshName, bool weld = true);
+	// Takes the vertices and indices of a generated mesh (either output).
+	void loadMesh(const MeshGenerator::Mesh &mesh);
 	void fitToUnitBox();
+	// Reorders triangles for the vertex cache and overdraw, then vertices for
+	// fetch locality. Call after loadMesh() and before init().
+	MeshOptimizer::Report optimize(int cacheSize = 16);
+	// Builds LODs with the given fractions of the triangles, e.g. {0.5, 0.25,
+	// 0.12}. Call after optimize() and before init().
+	void buildLods(const std::vector<float> &fractions);
+	int getLodCount() const { return 1 + (int)lods.size(); }
+	const Shape &getLod(int level) const;
+	size_t getTriangleCount() const { return eleBuf.empty() ? posBuf.size()/9 : eleBuf.size()/3; }
+	// Reorders the triangles into meshlets, also in the LODs. Call after
+	// buildLods() and before init().
+	void buildMeshlets(int maxVertices = 64, int maxTriangles = 126);
+	size_t getMeshletCount() const { return meshlets.size(); }
+	// Pass withObb to also get the oriented box.
+	const Bounds &getBounds(bool withObb = false) const;
+	void getBoundingSphere(glm::vec3 &center, float &radius) const;
+	// Call before init(). For INTERLEAVED, attributes picks what goes into the
+	// buffer and stride is the bytes per vertex (0 packs them tightly).
+	void setLayout(Layout layout, int attributes = POSITION | NORMAL | TEXCOORD, int stride = 0);
 	void init();
 	void draw(const std::shared_ptr<Program> prog) const;
+	// The whole shape, instances times, with the per-instance attributes
+	// already set up by the caller (see InstanceBatch)
+	void drawInstanced(const std::shared_ptr<Program> prog, int instances) const;
+	// Culls meshlets, if built, and adds to stats. Returns the number of
+	// triangles drawn.
+	size_t draw(const std::shared_ptr<Program> prog, const glm::mat4 &P, const glm::mat4 &MV, Meshlets::Stats &stats) const;
     float getMinY();
+	// Welding statistics
+	size_t getFaceVertexCount() const { return faceVertexCount; }
+	size_t getVertexCount() const { return posBuf.size()/3; }
+	size_t getUnweldedBytes() const;
+	size_t getBytes() const;
+	// Memory and error of the QUANTIZED layout for this mesh
+	VertexQuantizer::Report getQuantizationReport() const;
 	
 private:
+	size_t getIndexSize() const;
+	void bindPlanar() const;
+	void bindInterleaved() const;
+	void bindQuantized() const;
+	void bind(const std::shared_ptr<Program> prog) const;
+	void unbind() const;
+
 	std::vector<float> posBuf;
 	std::vector<float> norBuf;
 	std::vector<float> texBuf;
+	std::vector<unsigned int> eleBuf;
+	size_t faceVertexCount;
 	unsigned posBufID;
 	unsigned norBufID;
 	unsigned texBufID;
+	unsigned eleBufID;
+	Layout layout;
+	int attributes;
+	int stride;
+	int norOffset; // bytes into an interleaved vertex, -1 if absent
+	int texOffset;
+	unsigned vertBufID;
+	glm::vec3 quantScale;
+	glm::vec3 quantOffset;
+	bool halfTex;
+	mutable Bounds bounds;
+	mutable bool boundsValid;
+	std::vector<std::shared_ptr<Shape> > lods;
+	std::vector<Meshlets::Meshlet> meshlets;
+	// Visible ranges of the last culled draw, kept to avoid reallocating
+	mutable std::vector<Meshlets::Range> ranges;
+	mutable std::vector<int> drawCounts;
+	mutable std::vector<const void *> drawOffsets;
+	// Attribute locations of the last program drawn with, by its link id
+	mutable unsigned attribLink;
+	mutable int h_pos;
+	mutable int h_nor;
+	mutable int h_tex;
+	mutable int h_quantScale;
+	mutable int h_quantOffset;
+	mutable int h_octNormals;
 };
 
 #endif
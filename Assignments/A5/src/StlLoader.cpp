@@ -0,0 +1,265 @@
+#include "StlLoader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+
+using namespace std;
+
+namespace {
+
+const size_t HEADER_SIZE = 84;
+const size_t RECORD_SIZE = 50;
+
+inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Finds the next whitespace separated word at or after p. Returns its end,
+// or end if there is none (then word == end).
+const char *nextWord(const char *p, const char *end, const char *&word)
+{
+	while(p < end && isSpace(*p)) {
+		++p;
+	}
+	word = p;
+	while(p < end && !isSpace(*p)) {
+		++p;
+	}
+	return p;
+}
+
+inline bool isWord(const char *word, const char *wordEnd, const char *keyword)
+{
+	size_t n = strlen(keyword);
+	return (size_t)(wordEnd - word) == n && memcmp(word, keyword, n) == 0;
+}
+
+// Reads the next word as a float and moves p past it. If the word is not a
+// number, p stays in front of it and false is returned.
+bool nextFloat(const char *&p, const char *end, float &x)
+{
+	const char *word;
+	const char *wordEnd = nextWord(p, end, word);
+	char buf[64];
+	size_t n = min((size_t)(wordEnd - word), sizeof(buf) - 1);
+	memcpy(buf, word, n);
+	buf[n] = '\0';
+	char *parsed;
+	float value = strtof(buf, &parsed);
+	if(n == 0 || parsed != buf + n) {
+		return false;
+	}
+	x = value;
+	p = wordEnd;
+	return true;
+}
+
+// The facet normal, or the normal of the winding if that one is zero
+// (or not a number)
+void facetNormal(const float in[3], const float v[9], float n[3])
+{
+	glm::vec3 normal(in[0], in[1], in[2]);
+	float len = glm::length(normal);
+	if(!(len > 0.0f)) {
+		glm::vec3 v0(v[0], v[1], v[2]);
+		glm::vec3 v1(v[3], v[4], v[5]);
+		glm::vec3 v2(v[6], v[7], v[8]);
+		normal = glm::cross(v1 - v0, v2 - v0);
+		len = glm::length(normal);
+	}
+	normal = len > 0.0f ? normal/len : glm::vec3(0.0f);
+	n[0] = normal.x;
+	n[1] = normal.y;
+	n[2] = normal.z;
+}
+
+bool isBinary(const MappedFile &file, size_t &triangles)
+{
+	if(file.size < HEADER_SIZE) {
+		return false;
+	}
+	uint32_t count;
+	memcpy(&count, file.data + 80, sizeof(count));
+	triangles = count;
+	if(file.size == HEADER_SIZE + RECORD_SIZE*triangles) {
+		return true;
+	}
+	// Some exporters pad the end of the file.
+	const char *word;
+	const char *wordEnd = nextWord(file.data, file.data + file.size, word);
+	return !isWord(word, wordEnd, "solid") && file.size > HEADER_SIZE + RECORD_SIZE*triangles;
+}
+
+// Calls begin(triangles) and then triangle(normal, vertices) for each
+// triangle of the file. Polygons in ASCII files are split into fans. A
+// malformed ASCII file can have fewer triangles than begin() was given, but
+// never more.
+template <typename Begin, typename Triangle>
+bool readTriangles(const string &filename, string *err, Begin begin, Triangle triangle)
+{
+	MappedFile file;
+	if(!file.open(filename)) {
+		if(err) {
+			*err = "Cannot open file [" + filename + "]\n";
+		}
+		return false;
+	}
+
+	size_t count;
+	if(isBinary(file, count)) {
+		begin(count);
+		for(size_t t = 0; t < count; ++t) {
+			float record[12];
+			memcpy(record, file.data + HEADER_SIZE + RECORD_SIZE*t, sizeof(record));
+			float n[3];
+			facetNormal(record, record + 3, n);
+			triangle(n, record + 3);
+			// Keep only the last few MB of a large file resident.
+			if((t & 0xffff) == 0 && t*RECORD_SIZE > (8 << 20)) {
+				file.release(t*RECORD_SIZE - (8 << 20));
+			}
+		}
+		return true;
+	}
+
+	const char *end = file.data + file.size;
+	const char *word;
+	const char *p = nextWord(file.data, end, word);
+	if(!isWord(word, p, "solid")) {
+		if(err) {
+			*err = "Not an STL file [" + filename + "]\n";
+		}
+		return false;
+	}
+	// Count the triangles first so that the buffers are sized once.
+	count = 0;
+	size_t corners = 0;
+	for(const char *q = p; q < end;) {
+		q = nextWord(q, end, word);
+		if(isWord(word, q, "vertex")) {
+			++corners;
+		} else if(isWord(word, q, "endfacet")) {
+			count += corners > 2 ? corners - 2 : 0;
+			corners = 0;
+		}
+	}
+	begin(count);
+	size_t written = 0;
+	float normal[3] = {0.0f, 0.0f, 0.0f};
+	vector<float> polygon;
+	while(p < end) {
+		p = nextWord(p, end, word);
+		if(isWord(word, p, "facet")) {
+			// facet normal nx ny nz, zero where a component is missing
+			p = nextWord(p, end, word);
+			for(int k = 0; k < 3; ++k) {
+				normal[k] = 0.0f;
+				nextFloat(p, end, normal[k]);
+			}
+			polygon.clear();
+		} else if(isWord(word, p, "vertex")) {
+			// Only whole vertices are kept. A short line leaves the next
+			// keyword to the loop.
+			float x[3];
+			int k = 0;
+			while(k < 3 && nextFloat(p, end, x[k])) {
+				++k;
+			}
+			if(k == 3) {
+				polygon.insert(polygon.end(), x, x + 3);
+			}
+		} else if(isWord(word, p, "endfacet")) {
+			for(size_t k = 2; 3*k < polygon.size(); ++k) {
+				// Every vertex kept here was counted above, so this only
+				// guards the buffers sized from the count.
+				if(written == count) {
+					if(err) {
+						*err = "Malformed STL file [" + filename + "]\n";
+					}
+					return false;
+				}
+				float v[9];
+				copy(&polygon[0], &polygon[3], v);
+				copy(&polygon[3*(k - 1)], &polygon[3*k], v + 3);
+				copy(&polygon[3*k], &polygon[3*(k + 1)], v + 6);
+				float n[3];
+				facetNormal(normal, v, n);
+				triangle(n, v);
+				++written;
+			}
+			polygon.clear();
+		}
+	}
+	return true;
+}
+
+}
+
+bool StlLoader::isStl(const string &filename)
+{
+	if(filename.size() < 4) {
+		return false;
+	}
+	string ext = filename.substr(filename.size() - 4);
+	transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+	return ext == ".stl";
+}
+
+bool StlLoader::load(const string &filename, vector<float> &posBuf, vector<float> &norBuf, string *err)
+{
+	size_t posSize = posBuf.size();
+	size_t norSize = norBuf.size();
+	float *pos = nullptr;
+	float *nor = nullptr;
+	bool rc = readTriangles(filename, err,
+		[&](size_t triangles) {
+			posBuf.resize(posBuf.size() + 9*triangles);
+			norBuf.resize(norBuf.size() + 9*triangles);
+			pos = posBuf.data() + posBuf.size() - 9*triangles;
+			nor = norBuf.data() + norBuf.size() - 9*triangles;
+		},
+		[&](const float n[3], const float v[9]) {
+			pos = copy(v, v + 9, pos);
+			for(int c = 0; c < 3; ++c) {
+				nor = copy(n, n + 3, nor);
+			}
+		});
+	// Drop what a malformed file left unwritten, or everything on failure.
+	if(rc && pos) {
+		posSize = pos - posBuf.data();
+		norSize = nor - norBuf.data();
+	}
+	posBuf.resize(posSize);
+	norBuf.resize(norSize);
+	return rc;
+}
+
+bool StlLoader::stream(const string &filename, ObjLoader::Sink &sink, string *err)
+{
+	int t = 0;
+	return readTriangles(filename, err,
+		[&](size_t triangles) {
+			sink.begin(3*triangles, triangles, 0, triangles);
+		},
+		[&](const float n[3], const float v[9]) {
+			tinyobj::index_t corners[3];
+			for(int c = 0; c < 3; ++c) {
+				sink.vertex(v[3*c], v[3*c + 1], v[3*c + 2]);
+				corners[c].vertex_index = 3*t + c;
+				corners[c].normal_index = t;
+				corners[c].texcoord_index = -1;
+			}
+			sink.normal(n[0], n[1], n[2]);
+			sink.triangle(corners);
+			++t;
+		});
+}
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef STL_LOADER_H
+#define STL_LOADER_H
+
+#include <string>
+#include <vector>
+
+#include "ObjLoader.h"
+
+/**
+ * Reads binary and ASCII STL files. A binary file is an 80 byte header, a
+ * 32-bit triangle count, and one 50 byte record per triangle: the facet
+ * normal and the three vertices as little endian floats, then 2 unused
+ * bytes. The file is memory mapped and the records copied out directly.
+ * Since some binary exporters also begin the header with "solid", a file
+ * is taken as binary whenever its size matches the triangle count.
+ *
+ * STL has only facet normals, and many exporters write zeros for them, so
+ * those are recomputed from the counterclockwise winding.
+ */
+class StlLoader
+{
+public:
+	// True if filename ends in .stl (any case)
+	static bool isStl(const std::string &filename);
+	// Three vertices per triangle, each with the facet normal, for drawing
+	// without indices
+	static bool load(const std::string &filename, std::vector<float> &posBuf, std::vector<float> &norBuf, std::string *err);
+	// The same triangles for a sink to weld: begin() gets 3 vertices and 1
+	// normal per triangle, and each triangle refers to its own.
+	static bool stream(const std::string &filename, ObjLoader::Sink &sink, std::string *err);
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include "StreamBuffer.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "GLSL.h"
+
+using namespace std;
+
+StreamBuffer::StreamBuffer() :
+	mode(SUBDATA),
+	bufID(0),
+	regionBytes(0),
+	region(0),
+	persistent(nullptr),
+	waitTime(0.0),
+	waitCount(0)
+{
+	for(int i = 0; i < REGIONS; ++i) {
+		fences[i] = nullptr;
+	}
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	release();
+}
+
+void StreamBuffer::release()
+{
+	for(int i = 0; i < REGIONS; ++i) {
+		if(fences[i]) {
+			glDeleteSync((GLsync)fences[i]);
+			fences[i] = nullptr;
+		}
+	}
+	if(persistent) {
+		glBindBuffer(GL_ARRAY_BUFFER, bufID);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		persistent = nullptr;
+	}
+	if(bufID) {
+		glDeleteBuffers(1, &bufID);
+		bufID = 0;
+	}
+}
+
+void StreamBuffer::init(size_t regionBytes)
+{
+	Mode mode = SUBDATA;
+	if(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+		mode = PERSISTENT;
+	} else if((GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range) && (GLEW_VERSION_3_2 || GLEW_ARB_sync)) {
+		mode = UNSYNCHRONIZED;
+	}
+	init(regionBytes, mode);
+}
+
+void StreamBuffer::init(size_t regionBytes, Mode mode)
+{
+	release();
+	this->mode = mode;
+	this->regionBytes = regionBytes;
+	region = 0;
+	waitTime = 0.0;
+	waitCount = 0;
+	size_t bytes = REGIONS*regionBytes;
+	glGenBuffers(1, &bufID);
+	glBindBuffer(GL_ARRAY_BUFFER, bufID);
+	if(mode == PERSISTENT) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+		persistent = (char *)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+		if(!persistent) {
+			cerr << "StreamBuffer: persistent mapping failed, using glBufferSubData" << endl;
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			init(regionBytes, SUBDATA);
+			return;
+		}
+	} else {
+		glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+		if(mode == SUBDATA) {
+			staging.resize(regionBytes);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLSL::checkError(GET_FILE_LINE);
+}
+
+const char *StreamBuffer::getModeName() const
+{
+	return mode == PERSISTENT ? "persistent" : mode == UNSYNCHRONIZED ? "unsynchronized" : "glBufferSubData";
+}
+
+void *StreamBuffer::map()
+{
+	GLsync sync = (GLsync)fences[region];
+	if(sync) {
+		// Usually signaled long ago; only time the waits that aren't.
+		if(glClientWaitSync(sync, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			auto start = chrono::steady_clock::now();
+			while(glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+			}
+			waitTime += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			++waitCount;
+		}
+		glDeleteSync(sync);
+		fences[region] = nullptr;
+	}
+	size_t offset = region*regionBytes;
+	if(mode == PERSISTENT) {
+		return persistent + offset;
+	}
+	if(mode == UNSYNCHRONIZED) {
+		glBindBuffer(GL_ARRAY_BUFFER, bufID);
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+		void *p = glMapBufferRange(GL_ARRAY_BUFFER, offset, regionBytes, flags);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return p;
+	}
+	return &staging[0];
+}
+
+size_t StreamBuffer::unmap()
+{
+	size_t offset = region*regionBytes;
+	if(mode == UNSYNCHRONIZED) {
+		glBindBuffer(GL_ARRAY_BUFFER, bufID);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	} else if(mode == SUBDATA) {
+		glBindBuffer(GL_ARRAY_BUFFER, bufID);
+		glBufferSubData(GL_ARRAY_BUFFER, offset, regionBytes, &staging[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	return offset;
+}
+
+void StreamBuffer::fence()
+{
+	// glBufferSubData() is ordered by the driver, so it needs no fence.
+	if(mode != SUBDATA) {
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	region = (region + 1) % REGIONS;
+}
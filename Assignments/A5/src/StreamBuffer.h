@@ -0,0 +1,69 @@
+#pragma once
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * A vertex buffer for data that is rewritten every frame. The buffer holds
+ * REGIONS copies (a ring), and each frame writes the next one, so the CPU
+ * fills one region while the GPU still reads the ones before it. A fence
+ * after the draws that use a region tells us when it can be written again;
+ * with three regions that wait is normally over before we get there.
+ *
+ * How the region is written depends on what the context has:
+ * - PERSISTENT (GL 4.4 or ARB_buffer_storage): the buffer is mapped once,
+ *   coherent, and map() returns a pointer straight into it.
+ * - UNSYNCHRONIZED (GL 3.0 map_buffer_range and 3.2 sync): the region is
+ *   mapped each frame without the driver's implicit sync, since the fence
+ *   already covers it.
+ * - SUBDATA (anything else, e.g. the legacy context on macOS): map() returns
+ *   a staging copy, and unmap() uploads it with glBufferSubData().
+ */
+class StreamBuffer
+{
+public:
+	enum Mode { PERSISTENT, UNSYNCHRONIZED, SUBDATA };
+	static const int REGIONS = 3;
+
+	StreamBuffer();
+	~StreamBuffer();
+	// Needs an OpenGL context. Picks the mode unless one is forced.
+	void init(size_t regionBytes);
+	void init(size_t regionBytes, Mode mode);
+	// Waits until the next region is free and returns it for writing
+	// regionBytes. Write it once, in order, and don't read it back.
+	void *map();
+	// Ends the write and returns the byte offset of the region in the buffer,
+	// to pass to glVertexAttribPointer() with the buffer bound.
+	size_t unmap();
+	// Call after the draws that read the region, then map() the next one.
+	void fence();
+	// Frees the buffer and fences, with the context that init() had still
+	// current. The destructor does the same, too late for a global.
+	void release();
+	unsigned getBufferID() const { return bufID; }
+	size_t getRegionBytes() const { return regionBytes; }
+	Mode getMode() const { return mode; }
+	const char *getModeName() const;
+	// Seconds spent in map() waiting for the GPU, and number of waits
+	double getWaitTime() const { return waitTime; }
+	size_t getWaitCount() const { return waitCount; }
+
+private:
+	StreamBuffer(const StreamBuffer &);
+	StreamBuffer &operator=(const StreamBuffer &);
+
+	Mode mode;
+	unsigned bufID;
+	size_t regionBytes;
+	int region; // the one being written or to be written next
+	char *persistent; // mapped buffer in PERSISTENT mode
+	std::vector<char> staging; // SUBDATA mode
+	void *fences[REGIONS]; // GLsync, null if the region is free
+	double waitTime;
+	size_t waitCount;
+};
+
+#endif
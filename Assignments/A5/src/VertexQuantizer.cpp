@@ -0,0 +1,207 @@
+#include "VertexQuantizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+unsigned short toUnorm16(float x)
+{
+	return (unsigned short)(min(max(x, 0.0f), 1.0f)*65535.0f + 0.5f);
+}
+
+short toSnorm16(float x)
+{
+	return (short)lround(min(max(x, -1.0f), 1.0f)*32767.0f);
+}
+
+float signNotZero(float x)
+{
+	return x >= 0.0f ? 1.0f : -1.0f;
+}
+
+void boundingBox(const vector<float> &posBuf, glm::vec3 &vmin, glm::vec3 &vmax)
+{
+	vmin = glm::vec3(0.0f);
+	vmax = glm::vec3(0.0f);
+	for(size_t i = 0; i + 2 < posBuf.size(); i += 3) {
+		glm::vec3 p(posBuf[i], posBuf[i + 1], posBuf[i + 2]);
+		vmin = i == 0 ? p : glm::min(vmin, p);
+		vmax = i == 0 ? p : glm::max(vmax, p);
+	}
+}
+
+}
+
+vector<unsigned char> VertexQuantizer::pack(const vector<float> &posBuf, const vector<float> &norBuf, const vector<float> &texBuf,
+	const glm::vec3 &vmin, const glm::vec3 &vmax, bool halfTex, int stride, Format &format)
+{
+	int bytes = 4*sizeof(unsigned short);
+	format.norOffset = -1;
+	format.texOffset = -1;
+	if(!norBuf.empty()) {
+		format.norOffset = bytes;
+		bytes += 2*sizeof(short);
+	}
+	if(!texBuf.empty()) {
+		format.texOffset = bytes;
+		bytes += halfTex ? 2*sizeof(unsigned short) : 2*sizeof(float);
+	}
+	format.stride = (max(bytes, stride) + 3)/4*4;
+
+	size_t nverts = posBuf.size()/3;
+	glm::vec3 extent = vmax - vmin;
+	vector<unsigned char> vertBuf(nverts*format.stride, 0);
+	for(size_t i = 0; i < nverts; ++i) {
+		unsigned char *v = &vertBuf[i*format.stride];
+		unsigned short pos[4] = {0, 0, 0, 0};
+		for(int k = 0; k < 3; ++k) {
+			pos[k] = extent[k] > 0.0f ? toUnorm16((posBuf[3*i + k] - vmin[k])/extent[k]) : 0;
+		}
+		memcpy(v, pos, sizeof(pos));
+		if(format.norOffset >= 0) {
+			short e[2];
+			octEncode(glm::vec3(norBuf[3*i], norBuf[3*i + 1], norBuf[3*i + 2]), e);
+			memcpy(v + format.norOffset, e, sizeof(e));
+		}
+		if(format.texOffset >= 0) {
+			if(halfTex) {
+				unsigned short t[2] = {toHalf(texBuf[2*i]), toHalf(texBuf[2*i + 1])};
+				memcpy(v + format.texOffset, t, sizeof(t));
+			} else {
+				memcpy(v + format.texOffset, &texBuf[2*i], 2*sizeof(float));
+			}
+		}
+	}
+	return vertBuf;
+}
+
+VertexQuantizer::Report VertexQuantizer::measure(const vector<float> &posBuf, const vector<float> &norBuf, const vector<float> &texBuf, bool halfTex)
+{
+	glm::vec3 vmin, vmax;
+	boundingBox(posBuf, vmin, vmax);
+	Format format;
+	vector<unsigned char> vertBuf = pack(posBuf, norBuf, texBuf, vmin, vmax, halfTex, 0, format);
+
+	Report report;
+	report.floatBytes = (posBuf.size() + norBuf.size() + texBuf.size())*sizeof(float);
+	report.packedBytes = vertBuf.size();
+	report.posError = 0.0f;
+	report.norError = 0.0f;
+	report.texError = 0.0f;
+	// Decode the way the vertex shader does and compare.
+	glm::vec3 extent = vmax - vmin;
+	float diagonal = glm::length(extent);
+	size_t nverts = posBuf.size()/3;
+	for(size_t i = 0; i < nverts; ++i) {
+		const unsigned char *v = &vertBuf[i*format.stride];
+		unsigned short pos[4];
+		memcpy(pos, v, sizeof(pos));
+		glm::vec3 p = glm::vec3(pos[0], pos[1], pos[2])/65535.0f*extent + vmin;
+		float d = glm::length(p - glm::vec3(posBuf[3*i], posBuf[3*i + 1], posBuf[3*i + 2]));
+		report.posError = max(report.posError, diagonal > 0.0f ? d/diagonal : 0.0f);
+		if(format.norOffset >= 0) {
+			short e[2];
+			memcpy(e, v + format.norOffset, sizeof(e));
+			glm::vec3 n(norBuf[3*i], norBuf[3*i + 1], norBuf[3*i + 2]);
+			float len = glm::length(n);
+			if(len > 0.0f) {
+				float c = min(max(glm::dot(octDecode(e), n/len), -1.0f), 1.0f);
+				report.norError = max(report.norError, acos(c)*57.2957795f);
+			}
+		}
+		if(format.texOffset >= 0 && halfTex) {
+			unsigned short t[2];
+			memcpy(t, v + format.texOffset, sizeof(t));
+			for(int k = 0; k < 2; ++k) {
+				report.texError = max(report.texError, fabs(fromHalf(t[k]) - texBuf[2*i + k]));
+			}
+		}
+	}
+	return report;
+}
+
+unsigned short VertexQuantizer::toHalf(float f)
+{
+	unsigned int x;
+	memcpy(&x, &f, sizeof(x));
+	unsigned short sign = (x >> 16) & 0x8000;
+	int exponent = (int)((x >> 23) & 0xff);
+	unsigned int mantissa = x & 0x7fffff;
+	if(exponent == 0xff) {
+		// Infinity or NaN
+		return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+	}
+	exponent += 15 - 127;
+	if(exponent >= 31) {
+		return sign | 0x7c00;
+	}
+	if(exponent <= 0) {
+		// Subnormal, or too small for one
+		if(exponent < -10) {
+			return sign;
+		}
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		unsigned int h = mantissa >> shift;
+		if((mantissa >> (shift - 1)) & 1) {
+			++h;
+		}
+		return sign | h;
+	}
+	// Rounding may carry into the exponent, which is still correct.
+	unsigned int h = (exponent << 10) | (mantissa >> 13);
+	if(mantissa & 0x1000) {
+		++h;
+	}
+	return sign | h;
+}
+
+float VertexQuantizer::fromHalf(unsigned short h)
+{
+	float sign = (h & 0x8000) ? -1.0f : 1.0f;
+	int exponent = (h >> 10) & 0x1f;
+	int mantissa = h & 0x3ff;
+	if(exponent == 0) {
+		return sign*ldexp((float)mantissa, -24);
+	}
+	if(exponent == 31) {
+		return mantissa ? NAN : sign*INFINITY;
+	}
+	return sign*ldexp((float)(mantissa | 0x400), exponent - 25);
+}
+
+void VertexQuantizer::octEncode(const glm::vec3 &n, short e[2])
+{
+	// Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half
+	// over the upper one.
+	float l1 = fabs(n.x) + fabs(n.y) + fabs(n.z);
+	if(l1 <= 0.0f) {
+		e[0] = e[1] = 0;
+		return;
+	}
+	glm::vec3 p = n/l1;
+	float x = p.x;
+	float y = p.y;
+	if(p.z < 0.0f) {
+		x = (1.0f - fabs(p.y))*signNotZero(p.x);
+		y = (1.0f - fabs(p.x))*signNotZero(p.y);
+	}
+	e[0] = toSnorm16(x);
+	e[1] = toSnorm16(y);
+}
+
+glm::vec3 VertexQuantizer::octDecode(const short e[2])
+{
+	float x = max(e[0]/32767.0f, -1.0f);
+	float y = max(e[1]/32767.0f, -1.0f);
+	glm::vec3 n(x, y, 1.0f - fabs(x) - fabs(y));
+	if(n.z < 0.0f) {
+		n.x = (1.0f - fabs(y))*signNotZero(x);
+		n.y = (1.0f - fabs(x))*signNotZero(y);
+	}
+	return glm::normalize(n);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef VERTEX_QUANTIZER_H
+#define VERTEX_QUANTIZER_H
+
+#include <cstddef>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+/**
+ * Packs vertices into a compressed interleaved format:
+ * - position: 3 unsigned 16-bit values across the bounding box [vmin, vmax],
+ *   padded to 8 bytes; the shader maps them back with scale = vmax - vmin and
+ *   offset = vmin
+ * - normal: 2 signed 16-bit values, octahedral encoded (Cigolle et al. 2014)
+ * - texcoords: 2 half floats, or 2 floats if halfTex is false
+ * That is 16 bytes per vertex instead of 32 with floats.
+ */
+class VertexQuantizer
+{
+public:
+	struct Format
+	{
+		int stride;
+		int norOffset; // -1 if absent
+		int texOffset; // -1 if absent
+	};
+
+	// Memory and error of the packed format compared to floats
+	struct Report
+	{
+		size_t floatBytes;
+		size_t packedBytes;
+		float posError; // largest distance, as a fraction of the box diagonal
+		float norError; // largest angle in degrees
+		float texError; // largest difference in either coordinate
+	};
+
+	// Pass empty norBuf or texBuf to leave them out. A stride larger than the
+	// packed vertex pads it.
+	static std::vector<unsigned char> pack(const std::vector<float> &posBuf, const std::vector<float> &norBuf, const std::vector<float> &texBuf,
+		const glm::vec3 &vmin, const glm::vec3 &vmax, bool halfTex, int stride, Format &format);
+	static Report measure(const std::vector<float> &posBuf, const std::vector<float> &norBuf, const std::vector<float> &texBuf, bool halfTex);
+
+	static unsigned short toHalf(float f);
+	static float fromHalf(unsigned short h);
+	static void octEncode(const glm::vec3 &n, short e[2]);
+	static glm::vec3 octDecode(const short e[2]);
+};
+
+#endif
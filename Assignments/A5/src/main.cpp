@@ -11,16 +11,22 @@
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
+#include "Benchmarks.h"
 #include "Camera.h"
+#include "Deformer.h"
 #include "GLSL.h"
+#include "InstanceBatch.h"
 #include "MatrixStack.h"
+#include "MeshCache.h"
 #include "Program.h"
 #include "Shape.h"
+#include "StreamBuffer.h"
 #include "Texture.hpp"
 
 
@@ -30,6 +36,7 @@ glm::mat3 T(1.0f);
 // shared_ptr<Program> progPass1;
 shared_ptr<Program> progPass2;
 shared_ptr<Program> prog3; // <-- for surface of revolution
+shared_ptr<Program> progInst; // <-- instanced Blinn - Phong pass 1, if supported
 
 
 GLFWwindow *window; // Main application window
@@ -53,21 +60,30 @@ GLuint textureB;
 GLuint textureC;
 GLuint textureD;
 
-// STUFF FOR BOUNCING SPHERES
-map<string,GLuint> bufIDs;
-int indCount;
+// Bouncing spheres and spirals (surface of revolution): every object asking
+// for the same parameters shares one Shape
+MeshCache meshCache;
 
-// STUFF FOR SPIRALY THINGY (SURFACE REVOLUTION)
-map<string,GLuint> bufIDs2;
-int indCount2;
+// With 'i' the ground, the 100 objects, and the light spheres are drawn from
+// here, one instanced draw call per shape
+InstanceBatch sceneBatch;
 
-// QUAD
-map<string,GLuint> bufIDs3;
-int indCount3;
+// With 'd' the spirals are deformed here instead of in cell_vert.glsl: once
+// per frame into spiralVertices (position and normal), which stays around
+// for CPU-side use, and streamed to the GPU through spiralStream.
+Deformer spiralDeformer;
+StreamBuffer spiralStream;
+vector<float> spiralVertices;
+GLuint spiralEleBufID = 0;
+GLsizei spiralIndCount = 0;
+size_t spiralOffset = 0; // of this frame's vertices in spiralStream
 
 bool useBlur = false;
 
 bool keyToggles[256] = {false}; // only for English keyboards!
+Shape::Layout LAYOUT = Shape::PLANAR; // vertex buffer layout of the meshes
+size_t trianglesDrawn = 0; // by SceneObject::draw since the last report
+Meshlets::Stats cullStats; // meshlet culling since the last report
 
 class Material {
 public:
@@ -77,6 +93,87 @@ public:
     float shininess;
 };
 
+// Handles to what render() sets in prog and prog3, resolved once in init()
+// so that drawing an object looks nothing up by name
+struct ShadingUniforms {
+    Program::Uniform P, MV, invTransposeMV, ka, kd, ks, s, t;
+    Program::Uniform lightsColors, lightsPos;
+    Program::Uniform quantScale, quantOffset, octNormals;
+    Program::Attribute aPos, aNor;
+
+    void resolve(const Program& prog)
+    {
+        P = prog.getUniform("P");
+        MV = prog.getUniform("MV");
+        invTransposeMV = prog.getUniform("invTransposeMV");
+        ka = prog.getUniform("ka");
+        kd = prog.getUniform("kd");
+        ks = prog.getUniform("ks");
+        s = prog.getUniform("s");
+        t = prog.getUniform("t");
+        lightsColors = prog.getUniform("newLightsColors");
+        lightsPos = prog.getUniform("newLightsPos");
+        quantScale = prog.getUniform("quantScale");
+        quantOffset = prog.getUniform("quantOffset");
+        octNormals = prog.getUniform("octNormals");
+        aPos = prog.getAttribute("aPos");
+        aNor = prog.getAttribute("aNor");
+    }
+    // Matrices and material of one object
+    void setObject(const MatrixStack& projection, const MatrixStack& modelview, const Material& colors) const
+    {
+        glm::mat4 invTransposeMVMatrix = glm::mat4(modelview.normalMatrix());
+        glUniformMatrix4fv(P, 1, GL_FALSE, glm::value_ptr(projection.topMatrix()));
+        glUniformMatrix4fv(MV, 1, GL_FALSE, glm::value_ptr(modelview.topMatrix()));
+        glUniformMatrix4fv(invTransposeMV, 1, GL_FALSE, glm::value_ptr(invTransposeMVMatrix));
+        glUniform3f(ka, colors.ambient.r, colors.ambient.g, colors.ambient.b);
+        glUniform3f(kd, colors.diffuse.r, colors.diffuse.g, colors.diffuse.b);
+        glUniform3f(ks, colors.specular.r, colors.specular.g, colors.specular.b);
+        glUniform1f(s, colors.shininess);
+    }
+};
+ShadingUniforms progUniforms;
+ShadingUniforms prog3Uniforms;
+
+// The same for progPass2
+struct ScreenUniforms {
+    Program::Uniform P, MV, windowSize, lightsColors, lightsPos, useBlur;
+
+    void resolve(const Program& prog)
+    {
+        P = prog.getUniform("P");
+        MV = prog.getUniform("MV");
+        windowSize = prog.getUniform("windowSize");
+        lightsColors = prog.getUniform("newLightsColors");
+        lightsPos = prog.getUniform("newLightsPos");
+        useBlur = prog.getUniform("useBlur");
+    }
+};
+ScreenUniforms progPass2Uniforms;
+
+// The same for progInst: the model matrices come from InstanceBatch, so
+// this is all that is set per frame
+struct InstanceUniforms {
+    Program::Uniform P, V, invTransposeV, t;
+
+    void resolve(const Program& prog)
+    {
+        P = prog.getUniform("P");
+        V = prog.getUniform("V");
+        invTransposeV = prog.getUniform("invTransposeV");
+        t = prog.getUniform("t");
+    }
+    void set(const MatrixStack& projection, const MatrixStack& view, float time) const
+    {
+        glm::mat4 invTransposeVMatrix = glm::mat4(view.normalMatrix());
+        glUniformMatrix4fv(P, 1, GL_FALSE, glm::value_ptr(projection.topMatrix()));
+        glUniformMatrix4fv(V, 1, GL_FALSE, glm::value_ptr(view.topMatrix()));
+        glUniformMatrix4fv(invTransposeV, 1, GL_FALSE, glm::value_ptr(invTransposeVMatrix));
+        glUniform1f(t, time);
+    }
+};
+InstanceUniforms progInstUniforms;
+
 class Light {
 public:
     glm::vec3 position;
@@ -101,6 +198,7 @@ public:
     bool doScale;
     bool doRotate;
     bool doShear;
+    int lod = 0;
 
     SceneObject(shared_ptr<Shape> _shape, glm::vec3 _translation, glm::vec3 _rotation, glm::vec3 _scale, Material _material, float _scaleOffset, float _randRotation, bool _doScale, bool _doRotate, bool _doShear)
         : shape(_shape), translation(_translation), rotation(_rotation), scale(_scale), colors(_material), scaleOffset(_scaleOffset), randRotation(_randRotation), doScale(_doScale), doRotate(_doRotate), doShear(_doShear){}
@@ -133,19 +231,52 @@ public:
         if (doRotate) {
             MV->rotate(t, glm::vec3(0.0f, 1.0f, 0.0f));
         }
-        glm::mat4 invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
+        progUniforms.setObject(*P, *MV, colors);
         
-        glUniformMatrix4fv(prog->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
-        glUniformMatrix4fv(prog->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
-        glUniform3f(prog->getUniform("ka"), colors.ambient.r, colors.ambient.g, colors.ambient.b);
-        glUniform3f(prog->getUniform("kd"), colors.diffuse.r, colors.diffuse.g, colors.diffuse.b);
-        glUniform3f(prog->getUniform("ks"), colors.specular.r, colors.specular.g, colors.specular.b);
-        glUniform1f(prog->getUniform("s"), colors.shininess);
-        
-        shape->draw(prog);
+        const Shape& mesh = shape->getLod(selectLod(P->topMatrix(), MV->topMatrix()));
+        // Toggle 'm' to draw every meshlet.
+        if (keyToggles[(unsigned)'m']) {
+            mesh.draw(prog);
+            trianglesDrawn += mesh.getTriangleCount();
+        } else {
+            trianglesDrawn += mesh.draw(prog, P->topMatrix(), MV->topMatrix(), cullStats);
+        }
         MV->popMatrix();
     }
+    // What inst_vert.glsl needs to draw this object as draw() does
+    InstanceBatch::Instance getInstance() const
+    {
+        InstanceBatch::Instance instance;
+        instance.translation = translation;
+        instance.scale = scale;
+        instance.anim = glm::vec4(doScale ? 1.0f : 0.0f, scaleOffset, doShear ? 1.0f : 0.0f, doRotate ? 1.0f : 0.0f);
+        instance.rotation = glm::mat3(glm::rotate(glm::mat4(1.0f), randRotation, rotation));
+        instance.ka = colors.ambient;
+        instance.kd = colors.diffuse;
+        instance.ks = glm::vec4(colors.specular, colors.shininess);
+        return instance;
+    }
+    // Picks the LOD from the projected diameter in pixels. Level l is used down
+    // to 200/2^l pixels, and the 10% margins keep objects near a threshold
+    // from switching back and forth. Toggle 'l' to always draw full detail.
+    int selectLod(const glm::mat4& P, const glm::mat4& MV)
+    {
+        int count = shape->getLodCount();
+        if (count == 1 || keyToggles[(unsigned)'l']) {
+            return 0;
+        }
+        glm::vec3 center;
+        float radius;
+        shape->getBoundingSphere(center, radius);
+        glm::vec3 c = glm::vec3(MV * glm::vec4(center, 1.0f));
+        float s = std::max(glm::length(glm::vec3(MV[0])), std::max(glm::length(glm::vec3(MV[1])), glm::length(glm::vec3(MV[2]))));
+        float r = radius * s;
+        float pixels = -c.z > r ? r * P[1][1] * textureHeight / -c.z : 1e9f;
+        auto threshold = [](int level) { return 200.0f / (1 << level); };
+        while (lod > 0 && pixels > threshold(lod - 1) * 1.1f) lod--;
+        while (lod < count - 1 && pixels < threshold(lod) * 0.9f) lod++;
+        return lod;
+    }
     void drawSphere(shared_ptr<MatrixStack> P, shared_ptr<MatrixStack> MV, double t)
     {
         
@@ -156,15 +287,7 @@ public:
         
         MV->scale(scale);
         
-        glm::mat4 invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
-        
-        glUniformMatrix4fv(prog->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog->getUniform("MV"), 1, GL_FALSE, glm::value_ptr(MV->topMatrix()));
-        glUniformMatrix4fv(prog->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
-        glUniform3f(prog->getUniform("ka"), colors.ambient.r, colors.ambient.g, colors.ambient.b);
-        glUniform3f(prog->getUniform("kd"), colors.diffuse.r, colors.diffuse.g, colors.diffuse.b);
-        glUniform3f(prog->getUniform("ks"), colors.specular.r, colors.specular.g, colors.specular.b);
-        glUniform1f(prog->getUniform("s"), colors.shininess);
+        progUniforms.setObject(*P, *MV, colors);
         
         shape->draw(prog);
         MV->popMatrix();
@@ -180,28 +303,8 @@ public:
         
         MV->scale(glm::vec3(s*scale.x, scale.y, s*scale.z));
         
-        glm::mat4 invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
-        glUniformMatrix4fv(prog->getUniform("P"), 1, GL_FALSE, value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
-        glUniform3f(prog->getUniform("ka"), colors.ambient.r, colors.ambient.g, colors.ambient.b);
-        glUniform3f(prog->getUniform("kd"), colors.diffuse.r, colors.diffuse.g, colors.diffuse.b);
-        glUniform3f(prog->getUniform("ks"), colors.specular.r, colors.specular.g, colors.specular.b);
-        glUniform1f(prog->getUniform("s"), colors.shininess);
-        glEnableVertexAttribArray(prog->getAttribute("aPos"));
-        GLSL::checkError(GET_FILE_LINE);
-        glEnableVertexAttribArray(prog->getAttribute("aNor"));
-        GLSL::checkError(GET_FILE_LINE);
-        glBindBuffer(GL_ARRAY_BUFFER, bufIDs["bPos"]);
-        glVertexAttribPointer(prog->getAttribute("aPos"), 3, GL_FLOAT, GL_FALSE, 0, (void *)0);
-        glBindBuffer(GL_ARRAY_BUFFER, bufIDs["bNor"]);
-        glVertexAttribPointer(prog->getAttribute("aNor"), 3, GL_FLOAT, GL_FALSE, 0, (void *)0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufIDs["bInd"]);
-        glUniformMatrix4fv(prog->getUniform("MV"), 1, GL_FALSE, value_ptr(MV->topMatrix()));
-        glDrawElements(GL_TRIANGLES, indCount, GL_UNSIGNED_INT, (void *)0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glDisableVertexAttribArray(prog->getAttribute("aNor"));
-        glDisableVertexAttribArray(prog->getAttribute("aPos"));
+        progUniforms.setObject(*P, *MV, colors);
+        shape->draw(prog);
         MV->popMatrix();
         
         
@@ -215,30 +318,26 @@ public:
         
         float angle = 90.0f * M_PI/180.0f;
         MV->rotate(angle, glm::vec3(0.0f, 0.0f, 1.0f));
-        glm::mat4 invTransposeMV = glm::transpose(glm::inverse(MV->topMatrix()));
         
-        glUniform1f(prog3->getUniform("t"), t);
-        glUniformMatrix4fv(prog3->getUniform("P"), 1, GL_FALSE, value_ptr(P->topMatrix()));
-        glUniformMatrix4fv(prog3->getUniform("invTransposeMV"), 1, GL_FALSE, glm::value_ptr(invTransposeMV));
-        glUniform3f(prog3->getUniform("ka"), colors.ambient.r, colors.ambient.g, colors.ambient.b);
-        glUniform3f(prog3->getUniform("kd"), colors.diffuse.r, colors.diffuse.g, colors.diffuse.b);
-        glUniform3f(prog3->getUniform("ks"), colors.specular.r, colors.specular.g, colors.specular.b);
-        glUniform1f(prog3->getUniform("s"), colors.shininess);
-        glEnableVertexAttribArray(prog3->getAttribute("aPos"));
-        GLSL::checkError(GET_FILE_LINE);
+        glUniform1f(prog3Uniforms.t, t);
+        prog3Uniforms.setObject(*P, *MV, colors);
+        // (x, theta) only: cell_vert.glsl revolves it
+        shape->draw(prog3);
+        MV->popMatrix();
+    }
+    // The same spiral, already deformed on the CPU, drawn with prog
+    void drawDeformedSpiral(shared_ptr<MatrixStack> P, shared_ptr<MatrixStack> MV)
+    {
+        MV->pushMatrix();
+        MV->translate(translation);
         
-        GLSL::checkError(GET_FILE_LINE);
+        MV->scale(scale);
         
-        glBindBuffer(GL_ARRAY_BUFFER, bufIDs2["bPos"]);
-        glVertexAttribPointer(prog3->getAttribute("aPos"), 3, GL_FLOAT, GL_FALSE, 0, (void *)0);
-        glBindBuffer(GL_ARRAY_BUFFER, bufIDs2["bNor"]);
+        float angle = 90.0f * M_PI/180.0f;
+        MV->rotate(angle, glm::vec3(0.0f, 0.0f, 1.0f));
         
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufIDs2["bInd"]);
-        glUniformMatrix4fv(prog3->getUniform("MV"), 1, GL_FALSE, value_ptr(MV->topMatrix()));
-        glDrawElements(GL_TRIANGLES, indCount2, GL_UNSIGNED_INT, (void *)0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glDisableVertexAttribArray(prog3->getAttribute("aPos"));
+        progUniforms.setObject(*P, *MV, colors);
+        glDrawElements(GL_TRIANGLES, spiralIndCount, GL_UNSIGNED_INT, (const void *)0);
         MV->popMatrix();
     }
 };
@@ -267,7 +366,7 @@ static void key_callback(GLFWwindow *window, int key, int scancode, int action,
         
         progPass2->bind();
         useBlur = !useBlur;
-        glUniform1i(progPass2->getUniform("useBlur"), useBlur);
+        glUniform1i(progPass2Uniforms.useBlur, useBlur);
         progPass2->unbind();
         
     }
@@ -334,6 +433,87 @@ static void saveImage(const char *filepath, GLFWwindow *w)
 	}
 }
 
+// The objects of instbench: alternating shearing boxes and spinning balls,
+// every third one pulsing, as in init(). Cubes and low-poly spheres keep
+// the GPU side small.
+class BenchObjects : public Benchmarks::Objects {
+public:
+    void init(bool instanced) override
+    {
+        // SceneObject::draw() uses prog
+        prog = make_shared<Program>();
+        prog->setShaderNames(RESOURCE_DIR + "vert.glsl", RESOURCE_DIR + "frag.glsl");
+        prog->init();
+        prog->setVerbose(false);
+        progUniforms.resolve(*prog);
+        if (instanced) {
+            progInst = make_shared<Program>();
+            progInst->setShaderNames(RESOURCE_DIR + "inst_vert.glsl", RESOURCE_DIR + "inst_frag.glsl");
+            progInst->init();
+            progInst->setVerbose(false);
+            progInstUniforms.resolve(*progInst);
+        }
+        box = make_shared<Shape>();
+        box->loadMesh(RESOURCE_DIR + "cube.obj");
+        box->init();
+        ball = meshCache.sphere(8, 8, 1.0f, Shape::PLANAR);
+    }
+    void makeGrid(size_t n, int side) override
+    {
+        objects.clear();
+        for (size_t i = 0; i < n; ++i) {
+            float x = (float)(i % side) - 0.5f * side;
+            float z = (float)(i / side) - 0.5f * side;
+            Material material = {glm::vec3(0.0f), glm::vec3((i % 7) / 7.0f, (i % 5) / 5.0f, (i % 3) / 3.0f), glm::vec3(1.0f), 10.0f};
+            bool shear = i % 2 == 0;
+            objects.push_back(SceneObject(shear ? box : ball, glm::vec3(x, 0.0f, z), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.3f), material,
+                                          0.1f * i, (float)(i % 360), i % 3 == 0, !shear, shear));
+        }
+    }
+    void draw(const shared_ptr<MatrixStack>& P, const shared_ptr<MatrixStack>& MV, float t) override
+    {
+        prog->bind();
+        for (SceneObject& object : objects) {
+            object.draw(P, MV, t);
+        }
+        prog->unbind();
+    }
+    void addTo(InstanceBatch& batch) const override
+    {
+        for (const SceneObject& object : objects) {
+            batch.add(object.shape, object.getInstance());
+        }
+    }
+    void drawBatch(const InstanceBatch& batch, const MatrixStack& P, const MatrixStack& V, float t) override
+    {
+        progInst->bind();
+        progInstUniforms.set(P, V, t);
+        batch.draw(progInst);
+        progInst->unbind();
+    }
+    void release() override
+    {
+        objects.clear();
+        box.reset();
+        ball.reset();
+        meshCache.clear();
+        progInst.reset();
+        prog.reset();
+    }
+
+private:
+    shared_ptr<Shape> box;
+    shared_ptr<Shape> ball;
+    vector<SceneObject> objects;
+};
+
+// Post-transform cache simulation (16 entries) before and after Shape::optimize()
+static void printCacheReport(const string &name, const MeshOptimizer::Report &r)
+{
+	cout << name << ": FIFO ACMR " << r.fifoBefore.acmr << " -> " << r.fifoAfter.acmr << ", ATVR " << r.fifoBefore.atvr << " -> " << r.fifoAfter.atvr
+	     << "; LRU ACMR " << r.lruBefore.acmr << " -> " << r.lruAfter.acmr << ", ATVR " << r.lruBefore.atvr << " -> " << r.lruAfter.atvr << endl;
+}
+
 // This function is called once to initialize the scene and OpenGL
 static void init()
 {
@@ -367,7 +547,12 @@ static void init()
     prog->addUniform("kd");
     prog->addUniform("ks");
     prog->addUniform("s");
+    // decoding of the quantized vertex layout, set by Shape::draw
+    prog->addUniform("quantScale");
+    prog->addUniform("quantOffset");
+    prog->addUniform("octNormals");
     prog->setVerbose(false);
+    progUniforms.resolve(*prog);
     
     progPass2 = make_shared<Program>();
     progPass2->setShaderNames(RESOURCE_DIR + "tvert.glsl", RESOURCE_DIR + "tfrag.glsl");
@@ -385,8 +570,11 @@ static void init()
     progPass2->addUniform("newLightsColors");
     progPass2->addUniform("newLightsPos");
     progPass2->addUniform("useBlur");
+    progPass2->addUniform("quantScale");
+    progPass2->addUniform("quantOffset");
     //progPass2->addUniform("ks");
     //progPass2->addUniform("s");
+    progPass2Uniforms.resolve(*progPass2);
 
     progPass2->bind();
     glUniform1i(progPass2->getUniform("textureA"), 0);
@@ -416,25 +604,17 @@ static void init()
     prog3->addUniform("ks");
     prog3->addUniform("s");
     prog3->setVerbose(false);
-    //
-    // Vertex buffer setup
-    //
-    
-    // BOUNCING SPHERE
-    vector<float> posBuf;
-    vector<float> norBuf;
-    vector<unsigned int> indBuf;
-    
-    // SPIRAL THINGY (SURFACE OF REVOLUTION)
-    vector<float> posBuf2;
-    vector<float> norBuf2;
-    vector<unsigned int> indBuf2;
-    
-    // QUAD
-    vector<float> posBuf3;
-    vector<float> norBuf3;
-    vector<unsigned int> indBuf3;
-    
+    prog3Uniforms.resolve(*prog3);
+    
+    // Instanced, with every uniform and attribute found by reflection
+    if (InstanceBatch::isSupported()) {
+        progInst = make_shared<Program>();
+        progInst->setShaderNames(RESOURCE_DIR + "inst_vert.glsl", RESOURCE_DIR + "inst_frag.glsl");
+        progInst->setVerbose(true);
+        progInst->init();
+        progInst->setVerbose(false);
+        progInstUniforms.resolve(*progInst);
+    }
 	camera = make_shared<Camera>();
 	camera->setInitDistance(2.0f); // Camera's initial Z translation
 	
@@ -446,22 +626,52 @@ static void init()
     square = make_shared<Shape>();
     
 	shape->loadMesh(RESOURCE_DIR + "bunny.obj");
+	printCacheReport("bunny", shape->optimize());
+	shape->buildLods({0.5f, 0.25f, 0.12f});
+	shape->buildMeshlets();
+	shape->setLayout(LAYOUT);
 	shape->init();
     
     teapot->loadMesh(RESOURCE_DIR + "teapot.obj");
+    printCacheReport("teapot", teapot->optimize());
+    teapot->buildLods({0.5f, 0.25f, 0.12f});
+    teapot->buildMeshlets();
+    teapot->setLayout(LAYOUT);
     teapot->init();
     
     cube->loadMesh(RESOURCE_DIR + "cube.obj");
+    printCacheReport("cube", cube->optimize());
+    cube->setLayout(LAYOUT);
     cube->init();
     
     sphere->loadMesh(RESOURCE_DIR + "sphere.obj");
+    printCacheReport("sphere", sphere->optimize());
+    sphere->setLayout(LAYOUT);
     sphere->init();
     
     frustum->loadMesh(RESOURCE_DIR + "frustum.obj");
+    printCacheReport("frustum", frustum->optimize());
+    frustum->setLayout(LAYOUT);
     frustum->init();
     
     square->loadMesh(RESOURCE_DIR + "square.obj");
+    printCacheReport("square", square->optimize());
+    square->setLayout(LAYOUT);
     square->init();
+    
+    // How much welding saves on the meshes we draw the most
+    vector<pair<string, shared_ptr<Shape>>> welded = {{"bunny", shape}, {"teapot", teapot}, {"sphere", sphere}};
+    for (auto& mesh : welded) {
+        cout << mesh.first << ": " << mesh.second->getFaceVertexCount() << " -> " << mesh.second->getVertexCount() << " vertices, "
+             << mesh.second->getUnweldedBytes() / 1024.0f << " KB -> " << mesh.second->getBytes() / 1024.0f << " KB" << endl;
+    }
+    // What the quantized layout saves and costs on every mesh
+    vector<pair<string, shared_ptr<Shape>>> meshes = {{"bunny", shape}, {"teapot", teapot}, {"cube", cube}, {"sphere", sphere}, {"frustum", frustum}, {"square", square}};
+    for (auto& mesh : meshes) {
+        VertexQuantizer::Report q = mesh.second->getQuantizationReport();
+        cout << mesh.first << " quantized: " << q.floatBytes / 1024.0f << " KB -> " << q.packedBytes / 1024.0f << " KB vertices, error "
+             << q.posError * 100.0f << "% of diagonal, " << q.norError << " deg normals, " << q.texError << " texcoords" << endl;
+    }
 
     // Create ground plane
     float scaleOffs = 0.0f;
@@ -524,7 +734,7 @@ static void init()
         // ambient is now an emissive color of 0.
         material1 = {glm::vec3(0.0f, 0.0f, 0.0f), bouncingSphColors[(i + 1) % 10], glm::vec3(1.0f, 1.0f, 1.0f), 10.0f};
         
-        SceneObject BBall(shape, glm::vec3(x, 0.0f, z), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.3f), material1, scaleOffs, 0.0f, false, false, false);
+        SceneObject BBall(meshCache.sphere(49, 49, 1.0f, LAYOUT), glm::vec3(x, 0.0f, z), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.3f), material1, scaleOffs, 0.0f, false, false, false);
         sceneObjects.push_back(BBall);
         
         
@@ -538,7 +748,7 @@ static void init()
         // ambient is now an emissive color of 0.
         material1 = {glm::vec3(0.0f, 0.0f, 0.0f), bouncingSphColors[(i + 1) % 10], glm::vec3(1.0f, 1.0f, 1.0f), 10.0f};
         
-        SceneObject spiral(shape, glm::vec3(x, 0.0f, z), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.1f), material1, scaleOffs, 0.0f, false, false, false);
+        SceneObject spiral(meshCache.revolution(49, 49, 10.0f), glm::vec3(x, 0.0f, z), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.1f), material1, scaleOffs, 0.0f, false, false, false);
         sceneObjects.push_back(spiral);
         
         
@@ -564,207 +774,34 @@ static void init()
         newLights.push_back(newlight);
     }
     
+    cout << "mesh cache: " << meshCache.getShapeCount() << " shapes for " << meshCache.getShapeCount() + meshCache.getHits() << " objects" << endl;
     
-    
-    
-    int numPoints = 50;
-    for (int i = 0; i < numPoints; i++) {
-        float theta = static_cast<float>(i) / (numPoints - 1) * M_PI; // From [0, pi]
-        for (int j = 0; j < numPoints; j++) {
-            
-            float phi = static_cast<float>(j) / (numPoints - 1) * 2 * M_PI; // Range [0, 2pi]
-            
-            float x = sin(theta) * sin(phi);
-            float y = cos(theta);
-            float z = sin(theta) * cos(phi);
-
-            posBuf.push_back(x);
-            posBuf.push_back(y);
-            posBuf.push_back(z);
-            
-            norBuf.push_back(x);
-            norBuf.push_back(y);
-            norBuf.push_back(z);
-            
+    // The objects render() draws with SceneObject::draw() or drawSphere(),
+    // which is draw() without animations
+    if (progInst) {
+        for (int i = 0; i < 101; i++) {
+            sceneBatch.add(sceneObjects[i].shape, sceneObjects[i].getInstance());
         }
-    }
-    for (int i = 0; i < numPoints - 1; ++i) {
-        for (int j = 0; j < numPoints - 1; ++j) {
-            int index = i * numPoints + j;
-            indBuf.push_back(index);
-            indBuf.push_back(index + 1);
-            indBuf.push_back(index + 1 + numPoints);
-
-            indBuf.push_back(index);
-            indBuf.push_back(index + numPoints + 1);
-            indBuf.push_back(index + numPoints);
+        for (int i = 136; i < 206; i++) {
+            sceneBatch.add(sceneObjects[i].shape, sceneObjects[i].getInstance());
         }
+        sceneBatch.upload();
+        cout << "instancing ('i'): " << sceneBatch.getInstanceCount() << " objects in " << sceneBatch.getShapeCount() << " draw calls" << endl;
     }
-    // Total number of indices
-    indCount = (int)indBuf.size();
-        
-    // Generate buffer IDs and put them in the bufIDs map.
-    GLuint tmp[3];
-    glGenBuffers(3, tmp);
-    bufIDs["bPos"] = tmp[0];
-    bufIDs["bNor"] = tmp[1];
-    //bufIDs["bTex"] = tmp[2];
-    bufIDs["bInd"] = tmp[2];
-    glBindBuffer(GL_ARRAY_BUFFER, bufIDs["bPos"]);
-    glBufferData(GL_ARRAY_BUFFER, posBuf.size()*sizeof(float), &posBuf[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, bufIDs["bNor"]);
-    glBufferData(GL_ARRAY_BUFFER, norBuf.size()*sizeof(float), &norBuf[0], GL_STATIC_DRAW);
-    //glBindBuffer(GL_ARRAY_BUFFER, bufIDs["bTex"]);
-    //glBufferData(GL_ARRAY_BUFFER, texBuf.size()*sizeof(float), &texBuf[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufIDs["bInd"]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indBuf.size()*sizeof(unsigned int), &indBuf[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    assert(norBuf.size() == posBuf.size());
-    // END DRAWING BOUNCING SPHERES
-    
-    // DRAWING SURFACE OF REVOLUTOIN SPIRLA THINGY
-    float maxX = 10.0f; // Maximum value of x
-    float maxTheta = 2.0f * M_PI; // Maximum value of theta
-    numPoints = 50;
-    
-    for (int i = 0; i < numPoints; i++) {
-       float x = maxX * static_cast<float>(i) / (numPoints - 1);
-       for (int j = 0; j < numPoints; j++) {
-           
-           float theta = maxTheta * static_cast<float>(j) / (numPoints - 1);
-           
-           // Position (send x and theta)
-           posBuf2.push_back(x);
-           posBuf2.push_back(theta);
-           posBuf2.push_back(0.0f);
-           
-           // Normal (send in zeros)
-           norBuf2.push_back(0.0f);
-           norBuf2.push_back(0.0f);
-           norBuf2.push_back(0.0f);
-       }
-    }
-    for (int i = 0; i < numPoints - 1; ++i) {
-       for (int j = 0; j < numPoints - 1; ++j) {
-           int index = i * numPoints + j;
-           indBuf2.push_back(index);
-           indBuf2.push_back(index + 1);
-           indBuf2.push_back(index + 1 + numPoints);
-
-           indBuf2.push_back(index);
-           indBuf2.push_back(index + numPoints + 1);
-           indBuf2.push_back(index + numPoints);
-       }
-    }
-    // Total number of indices
-    indCount2 = (int)indBuf2.size();
     
-    
-       
-    // Generate buffer IDs and put them in the bufIDs map.
-    GLuint tmp2[3];
-    glGenBuffers(3, tmp2);
-    bufIDs2["bPos"] = tmp2[0];
-    bufIDs2["bNor"] = tmp2[1];
-    bufIDs2["bInd"] = tmp2[2];
-    glBindBuffer(GL_ARRAY_BUFFER, bufIDs2["bPos"]);
-    glBufferData(GL_ARRAY_BUFFER, posBuf2.size()*sizeof(float), &posBuf2[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, bufIDs2["bNor"]);
-    glBufferData(GL_ARRAY_BUFFER, norBuf2.size()*sizeof(float), &norBuf2[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufIDs2["bInd"]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indBuf2.size()*sizeof(unsigned int), &indBuf2[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // CPU deformed spirals: the same (x, theta) grid, its own indices, and a
+    // ring of three frames of vertices
+    MeshGenerator::Mesh spiralDomain;
+    MeshGenerator::revolution(spiralDomain, 49, 49, 10.0f);
+    spiralDeformer.setDomain(spiralDomain.posBuf);
+    spiralVertices.resize(6 * spiralDeformer.getVertexCount());
+    spiralStream.init(spiralVertices.size() * sizeof(float));
+    glGenBuffers(1, &spiralEleBufID);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spiralEleBufID);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, spiralDomain.eleBuf.size() * sizeof(unsigned int), &spiralDomain.eleBuf[0], GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-    assert(norBuf2.size() == posBuf2.size());
-    
-    // QUAD
-    // Vert 0
-    
-    posBuf3.push_back(-0.5f);
-    posBuf3.push_back(-0.5f);
-    posBuf3.push_back(0.0f);
-    norBuf3.push_back(0.0f);
-    norBuf3.push_back(0.0f);
-    norBuf3.push_back(1.0f);
-    
-    // Vert 1
-    posBuf3.push_back(0.5f);
-    posBuf3.push_back(-0.5f);
-    posBuf3.push_back(0.0f);
-    norBuf3.push_back(0.0f);
-    norBuf3.push_back(0.0f);
-    norBuf3.push_back(1.0f);
-  
-    // Vert 2
-    posBuf3.push_back(-0.5f);
-    posBuf3.push_back(0.5f);
-    posBuf3.push_back(0.0f);
-    norBuf3.push_back(0.0f);
-    norBuf3.push_back(0.0f);
-    norBuf3.push_back(1.0f);
-    
-    // Vert 3
-    posBuf3.push_back(0.5f);
-    posBuf3.push_back(0.5f);
-    posBuf3.push_back(0.0f);
-    norBuf3.push_back(0.0f);
-    norBuf3.push_back(0.0f);
-    norBuf3.push_back(1.0f);
-    
-    // indices
-    indBuf3.push_back(0);
-    indBuf3.push_back(1);
-    indBuf3.push_back(3);
-    indBuf3.push_back(0);
-    indBuf3.push_back(3);
-    indBuf3.push_back(2);
-    
-    // Creating vertices
-    // WORKS FOR ALL THE WAY TO 50 X 50 POINTS
-    
-    numPoints = 3;
-    float stepSize = 1.0f / (numPoints - 1);
-    for (int i = 0; i < numPoints; i++) {
-        for (int j = 0; j < numPoints; j++) {
-            float x = -0.5f + j * stepSize;
-            float y = -0.5f + i * stepSize;
-            
-            posBuf3.push_back(x);
-            posBuf3.push_back(y);
-            posBuf3.push_back(0.0f);
-            
-            norBuf3.push_back(0.0f);
-            norBuf3.push_back(0.0f);
-            norBuf3.push_back(1.0f);
-            
-        }
-    }
-    for (int i = 0; i < numPoints - 1; ++i) {
-        for (int j = 0; j < numPoints - 1; ++j) {
-                int index = i * numPoints + j;
-                indBuf3.push_back(index);
-                indBuf3.push_back(index + 1);
-                indBuf3.push_back(index + 1 + numPoints);
-
-                indBuf3.push_back(index);
-                indBuf3.push_back(index + numPoints + 1);
-                indBuf3.push_back(index + numPoints);
-            }
-        }
-    GLuint tmp3[2];
-    glGenBuffers(2, tmp3);
-    bufIDs3["bPos"] = tmp3[0];
-    bufIDs3["bInd"] = tmp3[1];
-    glBindBuffer(GL_ARRAY_BUFFER, bufIDs3["bPos"]);
-    glBufferData(GL_ARRAY_BUFFER, posBuf3.size()*sizeof(float), &posBuf3[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufIDs3["bInd"]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indBuf3.size()*sizeof(unsigned int), &indBuf3[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        
-    assert(norBuf3.size() == posBuf3.size());
+    spiralIndCount = (GLsizei)spiralDomain.eleBuf.size();
+    cout << "spirals: 'd' deforms them on the CPU, streamed with " << spiralStream.getModeName() << endl;
     
     GLSL::checkError(GET_FILE_LINE);
     
@@ -861,9 +898,9 @@ static void render()
 		t = 0.0f;
 	}
    
-    // Matrix stacks
-    auto P = make_shared<MatrixStack>();
-    auto MV = make_shared<MatrixStack>();
+    // Matrix stacks, reused every frame: each push in here is popped
+    static auto P = make_shared<MatrixStack>();
+    static auto MV = make_shared<MatrixStack>();
     
     //////////////////////////////////////////////////////
     // Render to the framebuffer
@@ -898,10 +935,8 @@ static void render()
     }
     prog->bind();
     
-    for (int i = 0; i < 70; i++) {
-        glUniform3fv(prog->getUniform("newLightsColors"), 70, glm::value_ptr(lightColors[0]));
-        glUniform3fv(prog->getUniform("newLightsPos"), 70, glm::value_ptr(newLightPositions[0]));
-    }
+    glUniform3fv(progUniforms.lightsColors, 70, glm::value_ptr(lightColors[0]));
+    glUniform3fv(progUniforms.lightsPos, 70, glm::value_ptr(newLightPositions[0]));
     
     // Draw Bonucing Balls
     for (int i = 101; i < 126; i++) {
@@ -909,28 +944,64 @@ static void render()
     }
     
     
-    sceneObjects[0].draw(P, MV, t); // ground
-    // Draw 100 objects
-    for (int i = 1; i < 101; i++) {
-        sceneObjects[i].draw(P, MV, t);
-    }
-    for (int i = 136; i < 206; i++) {
-        sceneObjects[i].drawSphere(P, MV, t);
+    if (keyToggles[(unsigned)'i'] && sceneBatch.getInstanceCount() > 0) {
+        // Ground, 100 objects, and light spheres in one call per shape
+        prog->unbind();
+        progInst->bind();
+        progInstUniforms.set(*P, *MV, t);
+        trianglesDrawn += sceneBatch.draw(progInst);
+        progInst->unbind();
+    } else {
+        sceneObjects[0].draw(P, MV, t); // ground
+        // Draw 100 objects
+        for (int i = 1; i < 101; i++) {
+            sceneObjects[i].draw(P, MV, t);
+        }
+        for (int i = 136; i < 206; i++) {
+            sceneObjects[i].drawSphere(P, MV, t);
+        }
+        prog->unbind();
     }
-    prog->unbind();
     
-    prog3->bind();
-    for (int i = 0; i < 70; i++) {
-        glUniform3fv(prog3->getUniform("newLightsColors"), 70, glm::value_ptr(lightColors[0]));
-        glUniform3fv(prog3->getUniform("newLightsPos"), 70, glm::value_ptr(newLightPositions[0]));
-    }
-    // DRAW SPIRALS (SURFACE OF REVOLUTION
-    for (int i = 126; i < 136; i++) {
-        sceneObjects[i].drawSurfaceOfRevolution(P, MV, t);
+    if (keyToggles[(unsigned)'d']) {
+        // All ten spirals have the same shape at time t: deform it once.
+        spiralDeformer.deform(t, &spiralVertices[0]);
+        memcpy(spiralStream.map(), &spiralVertices[0], spiralStream.getRegionBytes());
+        spiralOffset = spiralStream.unmap();
+        prog->bind();
+        GLint h_pos = progUniforms.aPos;
+        GLint h_nor = progUniforms.aNor;
+        glBindBuffer(GL_ARRAY_BUFFER, spiralStream.getBufferID());
+        glEnableVertexAttribArray(h_pos);
+        glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (const void *)spiralOffset);
+        glEnableVertexAttribArray(h_nor);
+        glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (const void *)(spiralOffset + 3 * sizeof(float)));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spiralEleBufID);
+        // Plain float vertices
+        glUniform3f(progUniforms.quantScale, 1.0f, 1.0f, 1.0f);
+        glUniform3f(progUniforms.quantOffset, 0.0f, 0.0f, 0.0f);
+        glUniform1i(progUniforms.octNormals, 0);
+        for (int i = 126; i < 136; i++) {
+            sceneObjects[i].drawDeformedSpiral(P, MV);
+        }
+        glDisableVertexAttribArray(h_nor);
+        glDisableVertexAttribArray(h_pos);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        prog->unbind();
+        spiralStream.fence();
+    } else {
+        prog3->bind();
+        glUniform3fv(prog3Uniforms.lightsColors, 70, glm::value_ptr(lightColors[0]));
+        glUniform3fv(prog3Uniforms.lightsPos, 70, glm::value_ptr(newLightPositions[0]));
+        // DRAW SPIRALS (SURFACE OF REVOLUTION
+        for (int i = 126; i < 136; i++) {
+            sceneObjects[i].drawSurfaceOfRevolution(P, MV, t);
+        }
+        
+        prog3->unbind();
     }
     
-    prog3->unbind();
-    
     
     MV->popMatrix();
     P->popMatrix();
@@ -950,7 +1021,7 @@ static void render()
     glEnable(GL_DEPTH_TEST);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    auto P_HUD = make_shared<MatrixStack>();
+    static auto P_HUD = make_shared<MatrixStack>();
     
     camera->setAspect((float)width/(float)height);
     P->pushMatrix();
@@ -969,16 +1040,15 @@ static void render()
     
     P_HUD->pushMatrix();
     camera->applyProjectionMatrix(P_HUD);
-    for (int i = 0; i < 70; i++) {
-        glUniform3fv(progPass2->getUniform("newLightsColors"), 70, glm::value_ptr(lightColors[0]));
-        glUniform3fv(progPass2->getUniform("newLightsPos"), 70, glm::value_ptr(newLightPositions[0]));
-    }    MV->pushMatrix();
+    glUniform3fv(progPass2Uniforms.lightsColors, 70, glm::value_ptr(lightColors[0]));
+    glUniform3fv(progPass2Uniforms.lightsPos, 70, glm::value_ptr(newLightPositions[0]));
+    MV->pushMatrix();
     
     // drawing quad
     MV->scale(glm::vec3(2.0f));
-    glUniformMatrix4fv(progPass2->getUniform("P"), 1, GL_FALSE, value_ptr(P->topMatrix()));
-    glUniformMatrix4fv(progPass2->getUniform("MV"), 1, GL_FALSE, value_ptr(MV->topMatrix()));
-    glUniform2f(progPass2->getUniform("windowSize"), width, height);
+    glUniformMatrix4fv(progPass2Uniforms.P, 1, GL_FALSE, value_ptr(P->topMatrix()));
+    glUniformMatrix4fv(progPass2Uniforms.MV, 1, GL_FALSE, value_ptr(MV->topMatrix()));
+    glUniform2f(progPass2Uniforms.windowSize, width, height);
     square->draw(progPass2);
     MV->popMatrix();
     P_HUD->popMatrix();
@@ -1006,15 +1076,35 @@ static void render()
 int main(int argc, char **argv)
 {
 	if(argc < 2) {
-		cout << "Usage: A3 RESOURCE_DIR" << endl;
+		cout << "Usage: A5 RESOURCE_DIR [OFFLINE] [planar|interleaved|quantized]" << endl;
+		cout << "       A5 RESOURCE_DIR objbench [MAX_TRIANGLES]" << endl;
+		cout << "       A5 RESOURCE_DIR deformbench [VERTICES]" << endl;
+		cout << "       A5 RESOURCE_DIR instbench [OBJECTS]" << endl;
+		return 0;
+	}
+	if(argc >= 3 && string(argv[2]) == "objbench") {
+		Benchmarks::objLoading(argc >= 4 ? atof(argv[3]) : 5e7);
 		return 0;
 	}
 	RESOURCE_DIR = argv[1] + string("/");
+	if(argc >= 3 && string(argv[2]) == "deformbench") {
+		Benchmarks::deformation(RESOURCE_DIR, argc >= 4 ? (size_t)atof(argv[3]) : 1000000);
+		return 0;
+	}
+	if(argc >= 3 && string(argv[2]) == "instbench") {
+		BenchObjects objects;
+		Benchmarks::instancing(argc >= 4 ? vector<size_t>(1, (size_t)atof(argv[3])) : vector<size_t>({100, 10000, 100000}), objects);
+		return 0;
+	}
 	
 	// Optional argument
 	if(argc >= 3) {
 		OFFLINE = atoi(argv[2]) != 0;
 	}
+	if(argc >= 4) {
+		string layout = argv[3];
+		LAYOUT = layout == "interleaved" ? Shape::INTERLEAVED : layout == "quantized" ? Shape::QUANTIZED : Shape::PLANAR;
+	}
 
 	// Set error callback.
 	glfwSetErrorCallback(error_callback);
@@ -1055,15 +1145,36 @@ int main(int argc, char **argv)
 	// Initialize scene.
 	init();
 	// Loop until the user closes the window.
+	double frameTime = 0.0;
+	int frames = 0;
 	while(!glfwWindowShouldClose(window)) {
-		// Render scene.
+		// Render scene, timing the CPU side for layout comparisons.
+		double frameStart = glfwGetTime();
 		render();
+		frameTime += glfwGetTime() - frameStart;
+		if(++frames == 300) {
+			cout << (LAYOUT == Shape::INTERLEAVED ? "Interleaved" : LAYOUT == Shape::QUANTIZED ? "Quantized" : "Planar") << (keyToggles[(unsigned)'l'] ? ", no LOD" : ", LOD") << ": "
+			     << 1000.0 * frameTime / frames << " ms CPU per frame, " << trianglesDrawn / frames << " triangles per frame, "
+			     << trianglesDrawn / frameTime / 1e6 << " Mtris/s" << endl;
+			if (cullStats.clusters > 0) {
+				cout << "  meshlets culled per frame: " << cullStats.frustumCulled / frames << " by frustum, " << cullStats.coneCulled / frames
+				     << " by cone, of " << cullStats.clusters / frames << " (" << cullStats.trianglesCulled / frames << " of "
+				     << cullStats.triangles / frames << " triangles)" << endl;
+			}
+			cullStats = Meshlets::Stats();
+			frameTime = 0.0;
+			frames = 0;
+			trianglesDrawn = 0;
+		}
 		// Swap front and back buffers.
 		glfwSwapBuffers(window);
 		// Poll for and process events.
 		glfwPollEvents();
 	}
-	// Quit program.
+	// Quit program, freeing the GL objects of globals while the context is
+	// still there.
+	sceneBatch.release();
+	spiralStream.release();
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	return 0;
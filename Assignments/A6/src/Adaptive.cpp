@@ -0,0 +1,177 @@
+#include "Adaptive.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "Image.h"
+
+using namespace std;
+
+// Sample k of a pixel comes from the R2 low-discrepancy sequence, shifted by a
+// per-pixel hash so that neighboring pixels don't share the same pattern.
+static glm::vec2 samplePosition(int x, int y, int k)
+{
+	const double a1 = 0.7548776662466927; // 1/g, g = plastic number
+	const double a2 = 0.5698402909980532; // 1/g^2
+	uint32_t h = (uint32_t)x*73856093u ^ (uint32_t)y*19349663u;
+	h ^= h >> 13;
+	h *= 0x5bd1e995u;
+	h ^= h >> 15;
+	double o1 = (h & 0xffff) / 65536.0;
+	double o2 = (h >> 16) / 65536.0;
+	double u = o1 + k*a1;
+	double v = o2 + k*a2;
+	return glm::vec2(x + (float)(u - floor(u)), y + (float)(v - floor(v)));
+}
+
+static float luminance(const glm::vec3 &c)
+{
+	return 0.2126f*c.r + 0.7152f*c.g + 0.0722f*c.b;
+}
+
+AdaptiveSampler::AdaptiveSampler(int w, int h) :
+	width(w),
+	height(h),
+	minSpp(4),
+	maxSpp(64),
+	batch(4),
+	threshold(0.01f)
+{
+	reset();
+}
+
+AdaptiveSampler::~AdaptiveSampler()
+{
+}
+
+void AdaptiveSampler::reset()
+{
+	mean.assign(width*height, glm::vec3(0.0f));
+	lumMean.assign(width*height, 0.0f);
+	lumM2.assign(width*height, 0.0f);
+	count.assign(width*height, 0);
+}
+
+void AdaptiveSampler::addSamples(const SampleFunc &sample, int x, int y, int n)
+{
+	int index = y*width + x;
+	for(int i = 0; i < n; ++i) {
+		glm::vec2 p = samplePosition(x, y, count[index]);
+		glm::vec3 c = sample(p.x, p.y);
+		// Clamp like the 8-bit output does, so that the very bright specular
+		// highlights don't dominate the error estimate.
+		c = glm::vec3(std::min(c.r, 1.0f), std::min(c.g, 1.0f), std::min(c.b, 1.0f));
+		int n1 = ++count[index];
+		mean[index] += (c - mean[index]) / (float)n1;
+		float l = luminance(c);
+		float delta = l - lumMean[index];
+		lumMean[index] += delta / n1;
+		lumM2[index] += delta * (l - lumMean[index]);
+	}
+}
+
+float AdaptiveSampler::standardError(int index) const
+{
+	int n = count[index];
+	if(n < 2) {
+		return 0.0f;
+	}
+	float variance = lumM2[index] / (n - 1);
+	return sqrt(variance / n);
+}
+
+long long AdaptiveSampler::render(const SampleFunc &sample)
+{
+	reset();
+	long long rays = 0;
+	for(int y = 0; y < height; ++y) {
+		for(int x = 0; x < width; ++x) {
+			addSamples(sample, x, y, minSpp);
+			rays += minSpp;
+		}
+	}
+
+	vector<unsigned char> noisy(width*height);
+	vector<unsigned char> active(width*height);
+	for(;;) {
+		for(int i = 0; i < width*height; ++i) {
+			noisy[i] = count[i] < maxSpp && standardError(i) > threshold;
+		}
+		// A pixel whose samples all agree may still straddle an edge that its
+		// neighbor has found, so activity is dilated by one pixel.
+		bool any = false;
+		for(int y = 0; y < height; ++y) {
+			for(int x = 0; x < width; ++x) {
+				bool a = false;
+				for(int dy = -1; dy <= 1 && !a; ++dy) {
+					for(int dx = -1; dx <= 1 && !a; ++dx) {
+						int xx = x + dx;
+						int yy = y + dy;
+						if(xx >= 0 && xx < width && yy >= 0 && yy < height) {
+							a = noisy[yy*width + xx] != 0;
+						}
+					}
+				}
+				int index = y*width + x;
+				active[index] = a && count[index] < maxSpp;
+				any = any || active[index];
+			}
+		}
+		if(!any) {
+			break;
+		}
+		for(int y = 0; y < height; ++y) {
+			for(int x = 0; x < width; ++x) {
+				int index = y*width + x;
+				if(active[index]) {
+					int n = std::min(batch, maxSpp - count[index]);
+					addSamples(sample, x, y, n);
+					rays += n;
+				}
+			}
+		}
+	}
+	return rays;
+}
+
+long long AdaptiveSampler::renderUniform(const SampleFunc &sample, int spp)
+{
+	reset();
+	for(int y = 0; y < height; ++y) {
+		for(int x = 0; x < width; ++x) {
+			addSamples(sample, x, y, spp);
+		}
+	}
+	return (long long)width*height*spp;
+}
+
+void AdaptiveSampler::writeHeatmap(const string &filename) const
+{
+	Image heatmap(width, height);
+	int range = std::max(maxSpp - minSpp, 1);
+	for(int y = 0; y < height; ++y) {
+		for(int x = 0; x < width; ++x) {
+			float s = (count[y*width + x] - minSpp) / (float)range;
+			s = std::min(std::max(s, 0.0f), 1.0f);
+			heatmap.setPixel(x, y, s * 255, 0, (1.0f - s) * 255);
+		}
+	}
+	heatmap.writeToFile(filename);
+}
+
+double AdaptiveSampler::rmse(const vector<glm::vec3> &a, const vector<glm::vec3> &b)
+{
+	size_t n = std::min(a.size(), b.size());
+	if(n == 0) {
+		return 0.0;
+	}
+	double sum = 0.0;
+	for(size_t i = 0; i < n; ++i) {
+		for(int k = 0; k < 3; ++k) {
+			double d = std::min(a[i][k], 1.0f) - std::min(b[i][k], 1.0f);
+			sum += d*d;
+		}
+	}
+	return sqrt(sum / (3.0*n));
+}
@@ -0,0 +1,63 @@
+#pragma once
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+/**
+ * Supersamples an image, spending rays only where they are needed. Each pixel
+ * keeps a running mean and variance of its samples (Welford). After minSpp
+ * samples, a pixel keeps receiving batches of samples while the standard error
+ * of its mean luminance is above the threshold (or a neighbor's is), up to
+ * maxSpp.
+ */
+class AdaptiveSampler
+{
+public:
+	// Traces one ray through the continuous pixel position (px, py)
+	typedef std::function<glm::vec3(float px, float py)> SampleFunc;
+
+	AdaptiveSampler(int width, int height);
+	virtual ~AdaptiveSampler();
+
+	void setMinSpp(int n) { minSpp = n; }
+	void setMaxSpp(int n) { maxSpp = n; }
+	void setBatch(int n) { batch = n; }
+	void setThreshold(float t) { threshold = t; }
+
+	// Adaptive render. Returns the number of rays traced.
+	long long render(const SampleFunc &sample);
+	// Every pixel gets exactly spp samples. Returns the number of rays traced.
+	long long renderUniform(const SampleFunc &sample, int spp);
+
+	const std::vector<glm::vec3> &getColors() const { return mean; }
+	const std::vector<int> &getSampleCounts() const { return count; }
+	// Writes the samples per pixel as a blue (minSpp) to red (maxSpp) image
+	void writeHeatmap(const std::string &filename) const;
+
+	// Root-mean-square error between two radiance buffers (clamped to [0, 1])
+	static double rmse(const std::vector<glm::vec3> &a, const std::vector<glm::vec3> &b);
+
+private:
+	void reset();
+	void addSamples(const SampleFunc &sample, int x, int y, int n);
+	float standardError(int index) const;
+
+	int width;
+	int height;
+	int minSpp;
+	int maxSpp;
+	int batch;
+	float threshold;
+	std::vector<glm::vec3> mean;
+	std::vector<float> lumMean;
+	std::vector<float> lumM2;
+	std::vector<int> count;
+};
+
+#endif
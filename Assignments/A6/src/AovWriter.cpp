@@ -0,0 +1,164 @@
+#include "AovWriter.h"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+AovWriter::AovWriter() :
+	width(0),
+	height(0),
+	channels(0),
+	floatsPerPixel(0),
+	headerSize(0),
+	fileSize(0),
+	map(nullptr),
+	data(nullptr),
+#ifdef _WIN32
+	file(INVALID_HANDLE_VALUE),
+	mapping(nullptr)
+#else
+	fd(-1)
+#endif
+{
+}
+
+AovWriter::~AovWriter()
+{
+	close();
+}
+
+int AovWriter::parseChannels(const string &list)
+{
+	int result = 0;
+	stringstream ss(list);
+	string name;
+	while(getline(ss, name, ',')) {
+		if(name == "rgb" || name == "radiance") {
+			result |= RADIANCE;
+		} else if(name == "depth" || name == "z") {
+			result |= DEPTH;
+		} else if(name == "normal") {
+			result |= NORMAL;
+		} else if(name == "id") {
+			result |= OBJECT_ID;
+		} else {
+			cout << "Unknown AOV channel " << name << endl;
+		}
+	}
+	return result;
+}
+
+bool AovWriter::open(const string &filename, int w, int h, int c)
+{
+	close();
+	width = w;
+	height = h;
+	channels = c;
+
+	string names;
+	floatsPerPixel = 0;
+	if(channels & RADIANCE) { names += " R G B"; floatsPerPixel += 3; }
+	if(channels & DEPTH) { names += " Z"; floatsPerPixel += 1; }
+	if(channels & NORMAL) { names += " N.x N.y N.z"; floatsPerPixel += 3; }
+	if(channels & OBJECT_ID) { names += " ID"; floatsPerPixel += 1; }
+	if(floatsPerPixel == 0) {
+		cout << "No AOV channels selected" << endl;
+		return false;
+	}
+
+	stringstream header;
+	header << "AOV\n" << width << " " << height << "\n" << floatsPerPixel << names << "\n-1.0";
+	string text = header.str();
+	// Pad with spaces before the final newline to align the floats.
+	while((text.size() + 1) % 4 != 0) {
+		text += ' ';
+	}
+	text += '\n';
+	headerSize = text.size();
+	fileSize = headerSize + (size_t)width*height*floatsPerPixel*sizeof(float);
+
+#ifdef _WIN32
+	file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file != INVALID_HANDLE_VALUE) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)fileSize >> 32), (DWORD)(fileSize & 0xffffffff), NULL);
+		if(mapping) {
+			map = (char *)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, fileSize);
+		}
+	}
+#else
+	fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fd >= 0 && ftruncate(fd, fileSize) == 0) {
+		void *p = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		map = p == MAP_FAILED ? nullptr : (char *)p;
+	}
+#endif
+	if(!map) {
+		cout << "Couldn't map " << filename << endl;
+		close();
+		return false;
+	}
+	memcpy(map, text.data(), headerSize);
+	data = (float *)(map + headerSize);
+	return true;
+}
+
+void AovWriter::setPixel(int x, int y, const glm::vec3 &radiance, float depth, const glm::vec3 &normal, int objectId)
+{
+	if(x < 0 || x >= width || y < 0 || y >= height) {
+		return;
+	}
+	float *p = data + ((size_t)y*width + x)*floatsPerPixel;
+	if(channels & RADIANCE) {
+		*p++ = radiance.r;
+		*p++ = radiance.g;
+		*p++ = radiance.b;
+	}
+	if(channels & DEPTH) {
+		*p++ = depth;
+	}
+	if(channels & NORMAL) {
+		*p++ = normal.x;
+		*p++ = normal.y;
+		*p++ = normal.z;
+	}
+	if(channels & OBJECT_ID) {
+		*p++ = (float)objectId;
+	}
+}
+
+void AovWriter::close()
+{
+#ifdef _WIN32
+	if(map) {
+		UnmapViewOfFile(map);
+	}
+	if(mapping) {
+		CloseHandle(mapping);
+	}
+	if(file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+	}
+	mapping = nullptr;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if(map) {
+		munmap(map, fileSize);
+	}
+	if(fd >= 0) {
+		::close(fd);
+	}
+	fd = -1;
+#endif
+	map = nullptr;
+	data = nullptr;
+}
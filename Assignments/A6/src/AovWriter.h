@@ -0,0 +1,63 @@
+#pragma once
+#ifndef AOV_WRITER_H
+#define AOV_WRITER_H
+
+#include <string>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+/**
+ * Writes float render channels (AOVs) into one uncompressed file. The layout
+ * follows PFM: a text header, then little-endian float32 pixels with the
+ * channels interleaved, bottom row first.
+ *
+ *   AOV
+ *   <width> <height>
+ *   <channel count> <channel names...>
+ *   -1.0
+ *
+ * The header is padded so that the pixel data is 4-byte aligned. The file is
+ * memory-mapped and pixels are written straight into the mapping, so the frame
+ * is never held in memory a second time. Misses have depth 0 and id -1.
+ */
+class AovWriter
+{
+public:
+	enum Channel {
+		RADIANCE = 1 << 0, // R G B
+		DEPTH = 1 << 1, // Z (ray t)
+		NORMAL = 1 << 2, // N.x N.y N.z (world space)
+		OBJECT_ID = 1 << 3, // ID
+		ALL = RADIANCE | DEPTH | NORMAL | OBJECT_ID
+	};
+
+	AovWriter();
+	virtual ~AovWriter();
+
+	// Parses a comma-separated list of rgb, depth, normal, id
+	static int parseChannels(const std::string &list);
+
+	bool open(const std::string &filename, int width, int height, int channels);
+	void setPixel(int x, int y, const glm::vec3 &radiance, float depth, const glm::vec3 &normal, int objectId);
+	void close();
+	bool isOpen() const { return data != nullptr; }
+
+private:
+	int width;
+	int height;
+	int channels;
+	int floatsPerPixel;
+	size_t headerSize;
+	size_t fileSize;
+	char *map;
+	float *data;
+#ifdef _WIN32
+	void *file;
+	void *mapping;
+#else
+	int fd;
+#endif
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "Bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+// Eigenvectors of a symmetric 3x3 matrix by cyclic Jacobi rotations
+void eigenvectors(double a[3][3], double v[3][3])
+{
+	for(int i = 0; i < 3; ++i) {
+		for(int j = 0; j < 3; ++j) {
+			v[i][j] = i == j ? 1.0 : 0.0;
+		}
+	}
+	for(int sweep = 0; sweep < 16; ++sweep) {
+		double off = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+		if(off < 1e-12*(fabs(a[0][0]) + fabs(a[1][1]) + fabs(a[2][2]))) {
+			break;
+		}
+		for(int p = 0; p < 2; ++p) {
+			for(int q = p + 1; q < 3; ++q) {
+				if(a[p][q] == 0.0) {
+					continue;
+				}
+				double theta = 0.5*(a[q][q] - a[p][p])/a[p][q];
+				double t = (theta >= 0.0 ? 1.0 : -1.0)/(fabs(theta) + sqrt(theta*theta + 1.0));
+				double c = 1.0/sqrt(t*t + 1.0);
+				double s = t*c;
+				for(int k = 0; k < 3; ++k) {
+					double akp = a[k][p];
+					double akq = a[k][q];
+					a[k][p] = c*akp - s*akq;
+					a[k][q] = s*akp + c*akq;
+				}
+				for(int k = 0; k < 3; ++k) {
+					double apk = a[p][k];
+					double aqk = a[q][k];
+					a[p][k] = c*apk - s*aqk;
+					a[q][k] = s*apk + c*aqk;
+				}
+				for(int k = 0; k < 3; ++k) {
+					double vkp = v[k][p];
+					double vkq = v[k][q];
+					v[k][p] = c*vkp - s*vkq;
+					v[k][q] = s*vkp + c*vkq;
+				}
+			}
+		}
+	}
+}
+
+}
+
+Bounds::Bounds() :
+	vmin(0.0f),
+	vmax(0.0f),
+	sphereCenter(0.0f),
+	sphereRadius(0.0f),
+	hasObb(false),
+	obbCenter(0.0f),
+	obbAxes(1.0f),
+	obbHalfExtents(0.0f)
+{
+}
+
+void Bounds::compute(const vector<float> &posBuf, bool withObb)
+{
+	*this = Bounds();
+	size_t n = posBuf.size()/3;
+	if(n == 0) {
+		return;
+	}
+	const float *p = &posBuf[0];
+
+	// Pass 1: box, the points at its faces, and the sums for the covariance
+	float lo[3] = {p[0], p[1], p[2]};
+	float hi[3] = {p[0], p[1], p[2]};
+	size_t loAt[3] = {0, 0, 0};
+	size_t hiAt[3] = {0, 0, 0};
+	double sum[3] = {0.0, 0.0, 0.0};
+	double sum2[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+	for(size_t i = 0; i < n; ++i) {
+		const float *v = p + 3*i;
+		for(int k = 0; k < 3; ++k) {
+			if(v[k] < lo[k]) {
+				lo[k] = v[k];
+				loAt[k] = i;
+			}
+			if(v[k] > hi[k]) {
+				hi[k] = v[k];
+				hiAt[k] = i;
+			}
+		}
+		if(withObb) {
+			sum[0] += v[0];
+			sum[1] += v[1];
+			sum[2] += v[2];
+			sum2[0] += (double)v[0]*v[0];
+			sum2[1] += (double)v[0]*v[1];
+			sum2[2] += (double)v[0]*v[2];
+			sum2[3] += (double)v[1]*v[1];
+			sum2[4] += (double)v[1]*v[2];
+			sum2[5] += (double)v[2]*v[2];
+		}
+	}
+	vmin = glm::vec3(lo[0], lo[1], lo[2]);
+	vmax = glm::vec3(hi[0], hi[1], hi[2]);
+	auto point = [&](size_t i) { return glm::vec3(p[3*i], p[3*i + 1], p[3*i + 2]); };
+
+	// Ritter starts from the most distant pair of extreme points.
+	int axis = 0;
+	float best = -1.0f;
+	for(int k = 0; k < 3; ++k) {
+		float d = glm::length(point(hiAt[k]) - point(loAt[k]));
+		if(d > best) {
+			best = d;
+			axis = k;
+		}
+	}
+	glm::vec3 c = 0.5f*(point(loAt[axis]) + point(hiAt[axis]));
+	float r = 0.5f*best;
+
+	glm::vec3 axes[3];
+	if(withObb) {
+		double mean[3] = {sum[0]/n, sum[1]/n, sum[2]/n};
+		double cov[3][3];
+		cov[0][0] = sum2[0]/n - mean[0]*mean[0];
+		cov[0][1] = cov[1][0] = sum2[1]/n - mean[0]*mean[1];
+		cov[0][2] = cov[2][0] = sum2[2]/n - mean[0]*mean[2];
+		cov[1][1] = sum2[3]/n - mean[1]*mean[1];
+		cov[1][2] = cov[2][1] = sum2[4]/n - mean[1]*mean[2];
+		cov[2][2] = sum2[5]/n - mean[2]*mean[2];
+		double e[3][3];
+		eigenvectors(cov, e);
+		for(int k = 0; k < 3; ++k) {
+			axes[k] = glm::normalize(glm::vec3((float)e[0][k], (float)e[1][k], (float)e[2][k]));
+		}
+		// Keep the frame right handed.
+		axes[2] = glm::cross(axes[0], axes[1]);
+	}
+
+	// Pass 2: grow the sphere over the points outside it, measure the sphere
+	// around the box center, and project onto the box axes.
+	glm::vec3 boxCenter = 0.5f*(vmin + vmax);
+	float boxRadius2 = 0.0f;
+	float r2 = r*r;
+	float olo[3] = {0.0f, 0.0f, 0.0f};
+	float ohi[3] = {0.0f, 0.0f, 0.0f};
+	for(size_t i = 0; i < n; ++i) {
+		glm::vec3 v = point(i);
+		glm::vec3 d = v - c;
+		float dist2 = glm::dot(d, d);
+		if(dist2 > r2) {
+			float dist = sqrt(dist2);
+			float grown = 0.5f*(r + dist);
+			c += (grown - r)/dist*d;
+			r = grown;
+			r2 = r*r;
+		}
+		glm::vec3 b = v - boxCenter;
+		boxRadius2 = max(boxRadius2, glm::dot(b, b));
+		if(withObb) {
+			for(int k = 0; k < 3; ++k) {
+				float t = glm::dot(v, axes[k]);
+				olo[k] = i == 0 ? t : min(olo[k], t);
+				ohi[k] = i == 0 ? t : max(ohi[k], t);
+			}
+		}
+	}
+	float boxRadius = sqrt(boxRadius2);
+	if(boxRadius < r) {
+		sphereCenter = boxCenter;
+		sphereRadius = boxRadius;
+	} else {
+		sphereCenter = c;
+		sphereRadius = r;
+	}
+
+	if(withObb) {
+		hasObb = true;
+		obbCenter = glm::vec3(0.0f);
+		for(int k = 0; k < 3; ++k) {
+			obbAxes[k] = axes[k];
+			obbCenter += 0.5f*(olo[k] + ohi[k])*axes[k];
+			obbHalfExtents[k] = 0.5f*(ohi[k] - olo[k]);
+		}
+		// Principal axes are no help for symmetric shapes like a cube, and
+		// can even be worse than the axis aligned box.
+		glm::vec3 half = 0.5f*(vmax - vmin);
+		if(half.x*half.y*half.z <= obbHalfExtents.x*obbHalfExtents.y*obbHalfExtents.z) {
+			obbCenter = boxCenter;
+			obbAxes = glm::mat3(1.0f);
+			obbHalfExtents = half;
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+/**
+ * Bounding volumes of a list of points (x, y, z, x, y, z, ...), computed
+ * together in two passes over the points:
+ * - the axis aligned box [vmin, vmax]
+ * - a bounding sphere: Ritter's (1990) sphere grown from the most distant
+ *   pair of extreme points, or the sphere around the box center if that one
+ *   is smaller
+ * - optionally an oriented box along the principal axes of the points, or
+ *   the axis aligned box if that is smaller
+ */
+class Bounds
+{
+public:
+	Bounds();
+	void compute(const std::vector<float> &posBuf, bool withObb = false);
+	
+	glm::vec3 vmin;
+	glm::vec3 vmax;
+	glm::vec3 sphereCenter;
+	float sphereRadius;
+	bool hasObb;
+	glm::vec3 obbCenter;
+	glm::mat3 obbAxes; // unit axes in the columns
+	glm::vec3 obbHalfExtents;
+};
+
+#endif
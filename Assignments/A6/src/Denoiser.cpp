@@ -0,0 +1,208 @@
+#include "Denoiser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using namespace std;
+
+// The row loops only ever write the sums and read the inputs, but the compiler
+// can't prove that, so tell it the iterations are independent.
+#if defined(__clang__)
+#define INDEPENDENT_ITERATIONS _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define INDEPENDENT_ITERATIONS _Pragma("GCC ivdep")
+#else
+#define INDEPENDENT_ITERATIONS
+#endif
+
+// exp(-x) for x >= 0 by the reciprocal of its cubic Taylor expansion. It is
+// accurate enough for edge-stopping weights and, unlike expf, vectorizes.
+static inline float expNeg(float x)
+{
+	return 1.0f / (1.0f + x*(1.0f + x*(0.5f + x*(1.0f/6.0f))));
+}
+
+namespace {
+
+// Planar copy of the inputs so that the row loops read contiguous floats.
+struct Planes
+{
+	int width;
+	int height;
+	vector<float> r, g, b;
+	vector<float> d;
+	vector<float> nx, ny, nz;
+	vector<float> ar, ag, ab;
+};
+
+struct Params
+{
+	int step;
+	float invColor;
+	float invDepth;
+	float invNormal;
+	float invAlbedo;
+};
+
+void filterRows(const Planes &in, const Params &p, float *outR, float *outG, float *outB, int y0, int y1)
+{
+	static const float kernel[5] = {1.0f/16.0f, 1.0f/4.0f, 3.0f/8.0f, 1.0f/4.0f, 1.0f/16.0f};
+	const int w = in.width;
+	const float invColor = p.invColor;
+	const float invDepth = p.invDepth;
+	const float invNormal = p.invNormal;
+	const float invAlbedo = p.invAlbedo;
+	vector<float> sums(4*w);
+	float *sr = &sums[0];
+	float *sg = &sums[w];
+	float *sb = &sums[2*w];
+	float *sw = &sums[3*w];
+	for(int y = y0; y < y1; ++y) {
+		std::fill(sums.begin(), sums.end(), 0.0f);
+		const int row = y*w;
+		const float *cr = &in.r[row];
+		const float *cg = &in.g[row];
+		const float *cb = &in.b[row];
+		const float *cd = &in.d[row];
+		const float *cnx = &in.nx[row];
+		const float *cny = &in.ny[row];
+		const float *cnz = &in.nz[row];
+		const float *car = &in.ar[row];
+		const float *cag = &in.ag[row];
+		const float *cab = &in.ab[row];
+		for(int ky = -2; ky <= 2; ++ky) {
+			int yy = y + ky*p.step;
+			if(yy < 0 || yy >= in.height) {
+				continue;
+			}
+			for(int kx = -2; kx <= 2; ++kx) {
+				// Taps that fall outside the image are skipped, and the
+				// normalization at the end accounts for them.
+				const int off = kx*p.step;
+				const int x0 = std::max(0, -off);
+				const int x1 = std::min(w, w - off);
+				const int qrow = yy*w + off;
+				const float h = kernel[ky + 2]*kernel[kx + 2];
+				const float *qr = &in.r[0] + qrow;
+				const float *qg = &in.g[0] + qrow;
+				const float *qb = &in.b[0] + qrow;
+				const float *qd = &in.d[0] + qrow;
+				const float *qnx = &in.nx[0] + qrow;
+				const float *qny = &in.ny[0] + qrow;
+				const float *qnz = &in.nz[0] + qrow;
+				const float *qar = &in.ar[0] + qrow;
+				const float *qag = &in.ag[0] + qrow;
+				const float *qab = &in.ab[0] + qrow;
+				INDEPENDENT_ITERATIONS
+				for(int x = x0; x < x1; ++x) {
+					float dr = cr[x] - qr[x];
+					float dg = cg[x] - qg[x];
+					float db = cb[x] - qb[x];
+					float ec = (dr*dr + dg*dg + db*db) * invColor;
+					float ed = fabsf(cd[x] - qd[x]) * invDepth;
+					float nd = cnx[x]*qnx[x] + cny[x]*qny[x] + cnz[x]*qnz[x];
+					float en = std::max(0.0f, 1.0f - nd) * invNormal;
+					float ar = car[x] - qar[x];
+					float ag = cag[x] - qag[x];
+					float ab = cab[x] - qab[x];
+					float ea = (ar*ar + ag*ag + ab*ab) * invAlbedo;
+					float weight = h * expNeg(ec + ed + en + ea);
+					sr[x] += weight * qr[x];
+					sg[x] += weight * qg[x];
+					sb[x] += weight * qb[x];
+					sw[x] += weight;
+				}
+			}
+		}
+		// The center tap always has a positive weight.
+		for(int x = 0; x < w; ++x) {
+			float inv = 1.0f / sw[x];
+			outR[row + x] = sr[x] * inv;
+			outG[row + x] = sg[x] * inv;
+			outB[row + x] = sb[x] * inv;
+		}
+	}
+}
+
+}
+
+Denoiser::Denoiser() :
+	iterations(5),
+	sigmaColor(0.5f),
+	sigmaDepth(0.1f),
+	sigmaNormal(0.1f),
+	sigmaAlbedo(0.1f),
+	threads(0)
+{
+}
+
+Denoiser::~Denoiser()
+{
+}
+
+void Denoiser::denoise(int width, int height, vector<glm::vec3> &color,
+	const vector<float> &depth,
+	const vector<glm::vec3> &normal,
+	const vector<glm::vec3> &albedo) const
+{
+	int n = width*height;
+	if(n == 0) {
+		return;
+	}
+	Planes planes;
+	planes.width = width;
+	planes.height = height;
+	planes.r.resize(n); planes.g.resize(n); planes.b.resize(n);
+	planes.d.resize(n);
+	planes.nx.resize(n); planes.ny.resize(n); planes.nz.resize(n);
+	planes.ar.resize(n); planes.ag.resize(n); planes.ab.resize(n);
+	for(int i = 0; i < n; ++i) {
+		planes.r[i] = color[i].r;
+		planes.g[i] = color[i].g;
+		planes.b[i] = color[i].b;
+		planes.d[i] = depth[i];
+		planes.nx[i] = normal[i].x;
+		planes.ny[i] = normal[i].y;
+		planes.nz[i] = normal[i].z;
+		planes.ar[i] = albedo[i].r;
+		planes.ag[i] = albedo[i].g;
+		planes.ab[i] = albedo[i].b;
+	}
+	vector<float> outR(n), outG(n), outB(n);
+
+	int nthreads = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+	nthreads = std::max(1, std::min(nthreads, height));
+	for(int i = 0; i < iterations; ++i) {
+		Params p;
+		p.step = 1 << i;
+		// The color weight tightens as the holes widen so that coarse levels
+		// don't smear features that the fine levels kept.
+		float sc = sigmaColor / (float)(1 << i);
+		p.invColor = 1.0f / std::max(sc*sc, 1e-8f);
+		p.invDepth = 1.0f / std::max(sigmaDepth, 1e-8f);
+		p.invNormal = 1.0f / std::max(sigmaNormal, 1e-8f);
+		p.invAlbedo = 1.0f / std::max(sigmaAlbedo*sigmaAlbedo, 1e-8f);
+
+		vector<thread> workers;
+		int band = (height + nthreads - 1) / nthreads;
+		for(int t = 0; t < nthreads; ++t) {
+			int y0 = t*band;
+			int y1 = std::min(height, y0 + band);
+			if(y0 >= y1) {
+				break;
+			}
+			workers.push_back(thread(filterRows, std::cref(planes), p, &outR[0], &outG[0], &outB[0], y0, y1));
+		}
+		for(thread &worker : workers) {
+			worker.join();
+		}
+		planes.r.swap(outR);
+		planes.g.swap(outG);
+		planes.b.swap(outB);
+	}
+
+	for(int i = 0; i < n; ++i) {
+		color[i] = glm::vec3(planes.r[i], planes.g[i], planes.b[i]);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+/**
+ * Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010). Each iteration
+ * applies a 5x5 B3-spline kernel with holes of 2^i pixels, and every tap is
+ * weighted by how similar its color, depth, normal, and albedo are to the
+ * center pixel, so that the filter blurs noise but stops at edges.
+ *
+ * The image is split into row bands, one per thread. Each row loop runs over
+ * planar float arrays without branches so the compiler can vectorize it.
+ */
+class Denoiser
+{
+public:
+	Denoiser();
+	virtual ~Denoiser();
+
+	void setIterations(int n) { iterations = n; }
+	void setSigmaColor(float s) { sigmaColor = s; }
+	void setSigmaDepth(float s) { sigmaDepth = s; }
+	void setSigmaNormal(float s) { sigmaNormal = s; }
+	void setSigmaAlbedo(float s) { sigmaAlbedo = s; }
+	// 0 uses all hardware threads
+	void setThreads(int n) { threads = n; }
+
+	// Filters color in place. The guide buffers are width*height, row by row.
+	void denoise(int width, int height, std::vector<glm::vec3> &color,
+		const std::vector<float> &depth,
+		const std::vector<glm::vec3> &normal,
+		const std::vector<glm::vec3> &albedo) const;
+
+private:
+	int iterations;
+	float sigmaColor;
+	float sigmaDepth;
+	float sigmaNormal;
+	float sigmaAlbedo;
+	int threads;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "LightTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+LightTree::LightTree() :
+	quality(0.02f)
+{
+}
+
+LightTree::~LightTree()
+{
+}
+
+void LightTree::build(const vector<glm::vec3> &pos, const vector<float> &intensities)
+{
+	positions = pos;
+	nodes.clear();
+	if(positions.empty()) {
+		return;
+	}
+	nodes.reserve(2*positions.size() - 1);
+	vector<int> lights(positions.size());
+	for(size_t i = 0; i < lights.size(); ++i) {
+		lights[i] = (int)i;
+	}
+	// Fixed seed so that the same lights always give the same tree
+	unsigned seed = 1;
+	build(intensities, lights, 0, (int)lights.size(), seed);
+}
+
+int LightTree::build(const vector<float> &intensities, vector<int> &lights, int begin, int end, unsigned &seed)
+{
+	int index = (int)nodes.size();
+	nodes.push_back(Node());
+	Node node;
+	node.min = node.max = positions[lights[begin]];
+	for(int i = begin + 1; i < end; ++i) {
+		node.min = glm::min(node.min, positions[lights[i]]);
+		node.max = glm::max(node.max, positions[lights[i]]);
+	}
+	if(end - begin == 1) {
+		node.intensity = intensities[lights[begin]];
+		node.representative = lights[begin];
+		node.left = node.right = -1;
+		nodes[index] = node;
+		return index;
+	}
+
+	glm::vec3 extent = node.max - node.min;
+	int axis = 0;
+	if(extent[1] > extent[axis]) axis = 1;
+	if(extent[2] > extent[axis]) axis = 2;
+	sort(lights.begin() + begin, lights.begin() + end, [&](int a, int b) {
+		return positions[a][axis] < positions[b][axis];
+	});
+	// Intensity-weighted median, keeping at least one light on each side
+	float total = 0.0f;
+	for(int i = begin; i < end; ++i) {
+		total += intensities[lights[i]];
+	}
+	int mid = begin + 1;
+	float sum = intensities[lights[begin]];
+	while(mid < end - 1 && sum + intensities[lights[mid]] <= 0.5f*total) {
+		sum += intensities[lights[mid]];
+		++mid;
+	}
+
+	node.left = build(intensities, lights, begin, mid, seed);
+	node.right = build(intensities, lights, mid, end, seed);
+	const Node &l = nodes[node.left];
+	const Node &r = nodes[node.right];
+	node.intensity = l.intensity + r.intensity;
+	// Pick a representative with probability proportional to intensity.
+	seed = seed*1664525u + 1013904223u;
+	float u = (seed >> 8) * (1.0f / 16777216.0f);
+	node.representative = u*node.intensity < l.intensity ? l.representative : r.representative;
+	nodes[index] = node;
+	return index;
+}
+
+float LightTree::error(const Node &node, const glm::vec3 &p) const
+{
+	if(node.left < 0) {
+		return 0.0f;
+	}
+	glm::vec3 d = glm::max(glm::max(node.min - p, p - node.max), glm::vec3(0.0f));
+	float dist = glm::length(d);
+	float size = glm::length(node.max - node.min);
+	if(dist <= 0.0f || size >= dist) {
+		return node.intensity;
+	}
+	return node.intensity * size / dist;
+}
+
+void LightTree::selectCut(const glm::vec3 &p, vector<Entry> &cut) const
+{
+	cut.clear();
+	if(nodes.empty()) {
+		return;
+	}
+	float threshold = quality*nodes[0].intensity;
+	// Max-heap on the error bound
+	vector<pair<float, int>> heap;
+	heap.push_back(make_pair(error(nodes[0], p), 0));
+	while(!heap.empty() && heap.front().first > threshold) {
+		pop_heap(heap.begin(), heap.end());
+		const Node &node = nodes[heap.back().second];
+		heap.pop_back();
+		heap.push_back(make_pair(error(nodes[node.left], p), node.left));
+		push_heap(heap.begin(), heap.end());
+		heap.push_back(make_pair(error(nodes[node.right], p), node.right));
+		push_heap(heap.begin(), heap.end());
+	}
+	for(const pair<float, int> &h : heap) {
+		const Node &node = nodes[h.second];
+		cut.push_back({node.representative, node.intensity});
+	}
+}
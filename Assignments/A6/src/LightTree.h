@@ -0,0 +1,61 @@
+#pragma once
+#ifndef LIGHT_TREE_H
+#define LIGHT_TREE_H
+
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+/**
+ * Binary tree over point lights, split on the longest axis at the
+ * intensity-weighted median. Each node stores its bounding box, total
+ * intensity, and a representative light picked from its children in
+ * proportion to their intensity.
+ *
+ * For a shading point, selectCut() finds a cut through the tree (a lightcut):
+ * every cluster in the cut is shaded as its representative light carrying the
+ * cluster's total intensity, so the cut size is the number of shadow rays.
+ * A cluster's error is bounded by its intensity times the angle its box
+ * subtends, and the cluster with the largest error is split until every error
+ * is below quality times the total intensity. A quality of 0 gives every light.
+ */
+class LightTree
+{
+public:
+	struct Entry
+	{
+		int light; // index of the representative light
+		float intensity; // total intensity of the cluster
+	};
+
+	LightTree();
+	virtual ~LightTree();
+
+	void build(const std::vector<glm::vec3> &positions, const std::vector<float> &intensities);
+	void setQuality(float q) { quality = q; }
+	float getQuality() const { return quality; }
+
+	void selectCut(const glm::vec3 &p, std::vector<Entry> &cut) const;
+	int getLightCount() const { return (int)positions.size(); }
+
+private:
+	struct Node
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		float intensity;
+		int representative;
+		int left; // -1 for a leaf
+		int right;
+	};
+
+	int build(const std::vector<float> &intensities, std::vector<int> &lights, int begin, int end, unsigned &seed);
+	float error(const Node &node, const glm::vec3 &p) const;
+
+	std::vector<glm::vec3> positions;
+	std::vector<Node> nodes;
+	float quality;
+};
+
+#endif
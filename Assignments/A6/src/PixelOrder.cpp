@@ -0,0 +1,88 @@
+#include "PixelOrder.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// Splits the bits of d between x (even bits) and y (odd bits).
+static void mortonDecode(int d, int &x, int &y)
+{
+	x = y = 0;
+	for(int bit = 0; d >> (2*bit); ++bit) {
+		x |= ((d >> (2*bit)) & 1) << bit;
+		y |= ((d >> (2*bit + 1)) & 1) << bit;
+	}
+}
+
+// Position of step d along the Hilbert curve filling an n x n square, n a
+// power of two.
+static void hilbertDecode(int n, int d, int &x, int &y)
+{
+	x = y = 0;
+	for(int s = 1; s < n; s *= 2) {
+		int rx = 1 & (d / 2);
+		int ry = 1 & (d ^ rx);
+		if(ry == 0) {
+			if(rx == 1) {
+				x = s - 1 - x;
+				y = s - 1 - y;
+			}
+			swap(x, y);
+		}
+		x += s*rx;
+		y += s*ry;
+		d /= 4;
+	}
+}
+
+PixelOrder::PixelOrder(int width, int height, int tileSize, Curve curve)
+{
+	pixels.reserve(width*height);
+	if(curve == ROWS) {
+		for(int i = 0; i < width*height; ++i) {
+			pixels.push_back(i);
+		}
+		return;
+	}
+	// The curves need a power-of-two square; steps that land outside a
+	// partial tile at the image edge are skipped.
+	int n = 1;
+	while(n < max(1, tileSize)) {
+		n *= 2;
+	}
+	for(int ty = 0; ty < height; ty += n) {
+		for(int tx = 0; tx < width; tx += n) {
+			for(int d = 0; d < n*n; ++d) {
+				int x, y;
+				if(curve == MORTON) {
+					mortonDecode(d, x, y);
+				} else {
+					hilbertDecode(n, d, x, y);
+				}
+				x += tx;
+				y += ty;
+				if(x < width && y < height) {
+					pixels.push_back(y*width + x);
+				}
+			}
+		}
+	}
+}
+
+PixelOrder::~PixelOrder()
+{
+}
+
+bool PixelOrder::parse(const string &name, Curve &curve)
+{
+	if(name == "rows") {
+		curve = ROWS;
+	} else if(name == "morton" || name == "z") {
+		curve = MORTON;
+	} else if(name == "hilbert") {
+		curve = HILBERT;
+	} else {
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef PIXEL_ORDER_H
+#define PIXEL_ORDER_H
+
+#include <string>
+#include <vector>
+
+/**
+ * The order in which the pixels of an image are traced. ROWS is the plain
+ * scanline order. MORTON and HILBERT visit the image tile by tile, with tiles
+ * in row order and the pixels inside each tile along the curve, so that
+ * consecutive rays stay close together on screen.
+ *
+ * getPixels() lists the pixel indices (y*width + x) in traversal order; the ray
+ * buffer is generated in the same order and written back through it.
+ */
+class PixelOrder
+{
+public:
+	enum Curve { ROWS, MORTON, HILBERT };
+
+	PixelOrder(int width, int height, int tileSize, Curve curve);
+	virtual ~PixelOrder();
+
+	// Parses rows, morton or hilbert
+	static bool parse(const std::string &name, Curve &curve);
+
+	const std::vector<int> &getPixels() const { return pixels; }
+
+private:
+	std::vector<int> pixels;
+};
+
+#endif
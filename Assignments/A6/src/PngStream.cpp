@@ -0,0 +1,241 @@
+#include "PngStream.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+static unsigned crcTable[256];
+
+static void makeCrcTable()
+{
+	for(unsigned n = 0; n < 256; ++n) {
+		unsigned c = n;
+		for(int k = 0; k < 8; ++k) {
+			c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+		}
+		crcTable[n] = c;
+	}
+}
+
+static unsigned crc32(unsigned crc, const unsigned char *data, size_t size)
+{
+	crc = ~crc;
+	for(size_t i = 0; i < size; ++i) {
+		crc = crcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static unsigned adler32(unsigned adler, const unsigned char *data, size_t size)
+{
+	unsigned a = adler & 0xffff;
+	unsigned b = adler >> 16;
+	while(size > 0) {
+		// 5552 bytes is the most that can be summed before b overflows.
+		size_t n = size < 5552 ? size : 5552;
+		size -= n;
+		while(n--) {
+			a += *data++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return (b << 16) | a;
+}
+
+static void putBigEndian(unsigned char *p, unsigned v)
+{
+	p[0] = (v >> 24) & 0xff;
+	p[1] = (v >> 16) & 0xff;
+	p[2] = (v >> 8) & 0xff;
+	p[3] = v & 0xff;
+}
+
+PngStream::PngStream() :
+	fp(nullptr),
+	width(0),
+	height(0),
+	bandHeight(0),
+	nextBand(0),
+	adler(1),
+	offset(0)
+{
+	if(crcTable[1] == 0) {
+		makeCrcTable();
+	}
+}
+
+PngStream::~PngStream()
+{
+	if(fp) {
+		fclose(fp);
+	}
+}
+
+bool PngStream::open(const string &name, int w, int h, int band, bool resume)
+{
+	filename = name;
+	width = w;
+	height = h;
+	bandHeight = band;
+	nextBand = 0;
+	adler = 1;
+	offset = 0;
+
+	if(resume && loadCheckpoint()) {
+		cout << "Resuming " << filename << " at band " << nextBand << " of " << getBandCount() << endl;
+		return fp != nullptr;
+	}
+
+	fp = fopen(filename.c_str(), "wb");
+	if(!fp) {
+		cout << "Couldn't write to " << filename << endl;
+		return false;
+	}
+	static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+	fwrite(signature, 1, 8, fp);
+	offset = 8;
+	unsigned char ihdr[13];
+	putBigEndian(ihdr, width);
+	putBigEndian(ihdr + 4, height);
+	ihdr[8] = 8; // bit depth
+	ihdr[9] = 2; // RGB
+	ihdr[10] = 0; // deflate
+	ihdr[11] = 0; // adaptive filtering
+	ihdr[12] = 0; // no interlace
+	writeChunk("IHDR", ihdr, 13);
+	return true;
+}
+
+bool PngStream::writeBand(const unsigned char *rgb)
+{
+	if(!fp || nextBand >= getBandCount()) {
+		return false;
+	}
+	int rows = min(bandHeight, height - nextBand*bandHeight);
+	size_t stride = (size_t)width*3;
+
+	// Raw scanlines, each prefixed with filter type 0 (none)
+	vector<unsigned char> raw;
+	raw.reserve(rows*(stride + 1));
+	for(int r = 0; r < rows; ++r) {
+		raw.push_back(0);
+		raw.insert(raw.end(), rgb + r*stride, rgb + (r + 1)*stride);
+	}
+	adler = adler32(adler, raw.data(), raw.size());
+
+	vector<unsigned char> idat;
+	idat.reserve(raw.size() + raw.size()/65535*5 + 8);
+	if(nextBand == 0) {
+		// zlib header: deflate, 32K window, no dictionary, fastest
+		idat.push_back(0x78);
+		idat.push_back(0x01);
+	}
+	for(size_t pos = 0; pos < raw.size(); pos += 65535) {
+		unsigned len = (unsigned)min(raw.size() - pos, (size_t)65535);
+		idat.push_back(0x00); // stored block, not final
+		idat.push_back(len & 0xff);
+		idat.push_back(len >> 8);
+		idat.push_back(~len & 0xff);
+		idat.push_back((~len >> 8) & 0xff);
+		idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + len);
+	}
+	writeChunk("IDAT", idat.data(), idat.size());
+	fflush(fp);
+	++nextBand;
+	saveCheckpoint();
+	return true;
+}
+
+bool PngStream::finish()
+{
+	if(!fp) {
+		return false;
+	}
+	if(nextBand < getBandCount()) {
+		cout << "PNG stream closed after " << nextBand << " of " << getBandCount() << " bands" << endl;
+		fclose(fp);
+		fp = nullptr;
+		return false;
+	}
+	// Empty final stored block followed by the Adler-32 of all the scanlines
+	unsigned char tail[9] = {0x01, 0x00, 0x00, 0xff, 0xff};
+	putBigEndian(tail + 5, adler);
+	writeChunk("IDAT", tail, 9);
+	writeChunk("IEND", nullptr, 0);
+	fclose(fp);
+	fp = nullptr;
+	std::error_code ec;
+	filesystem::remove(filename + ".ckpt", ec);
+	cout << "Wrote to " << filename << endl;
+	return true;
+}
+
+void PngStream::writeChunk(const char *type, const unsigned char *data, size_t size)
+{
+	unsigned char header[8];
+	putBigEndian(header, (unsigned)size);
+	header[4] = type[0];
+	header[5] = type[1];
+	header[6] = type[2];
+	header[7] = type[3];
+	unsigned crc = crc32(0, header + 4, 4);
+	if(size > 0) {
+		crc = crc32(crc, data, size);
+	}
+	unsigned char footer[4];
+	putBigEndian(footer, crc);
+	fwrite(header, 1, 8, fp);
+	if(size > 0) {
+		fwrite(data, 1, size, fp);
+	}
+	fwrite(footer, 1, 4, fp);
+	offset += 12 + size;
+}
+
+void PngStream::saveCheckpoint()
+{
+	// Written to a temporary first so that a kill mid-write can't leave a
+	// truncated checkpoint behind.
+	string tmp = filename + ".ckpt.tmp";
+	{
+		ofstream out(tmp);
+		out << width << " " << height << " " << bandHeight << " " << nextBand << " " << offset << " " << adler << endl;
+	}
+	std::error_code ec;
+	filesystem::rename(tmp, filename + ".ckpt", ec);
+}
+
+bool PngStream::loadCheckpoint()
+{
+	ifstream in(filename + ".ckpt");
+	int w, h, b, band;
+	unsigned long long off;
+	unsigned a;
+	if(!(in >> w >> h >> b >> band >> off >> a)) {
+		return false;
+	}
+	if(w != width || h != height || b != bandHeight) {
+		cout << "Checkpoint for " << filename << " doesn't match this render, starting over" << endl;
+		return false;
+	}
+	// Drop anything written after the last completed band.
+	std::error_code ec;
+	filesystem::resize_file(filename, off, ec);
+	if(ec) {
+		return false;
+	}
+	fp = fopen(filename.c_str(), "r+b");
+	if(!fp) {
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	offset = off;
+	nextBand = band;
+	adler = a;
+	return true;
+}
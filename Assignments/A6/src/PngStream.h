@@ -0,0 +1,47 @@
+#pragma once
+#ifndef PNG_STREAM_H
+#define PNG_STREAM_H
+
+#include <cstdio>
+#include <string>
+
+/**
+ * Writes an 8-bit RGB PNG one band of rows at a time, top band first, so the
+ * whole frame never has to be in memory. Every band becomes its own IDAT chunk
+ * of stored (uncompressed) deflate blocks, which is what lets the zlib stream
+ * be continued across bands and across runs.
+ *
+ * After every band, a checkpoint (<filename>.ckpt) records the next band, the
+ * file offset, and the running Adler-32. Opening with resume = true continues
+ * from the last completed band. The checkpoint is removed by finish().
+ */
+class PngStream
+{
+public:
+	PngStream();
+	virtual ~PngStream();
+
+	bool open(const std::string &filename, int width, int height, int bandHeight, bool resume);
+	// Index of the first band still to be written (nonzero after a resume)
+	int getNextBand() const { return nextBand; }
+	int getBandCount() const { return (height + bandHeight - 1) / bandHeight; }
+	// rgb holds the band's rows top to bottom, 3 bytes per pixel
+	bool writeBand(const unsigned char *rgb);
+	bool finish();
+
+private:
+	void writeChunk(const char *type, const unsigned char *data, size_t size);
+	void saveCheckpoint();
+	bool loadCheckpoint();
+
+	std::string filename;
+	FILE *fp;
+	int width;
+	int height;
+	int bandHeight;
+	int nextBand;
+	unsigned adler;
+	unsigned long long offset;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "Progressive.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Image.h"
+
+using namespace std;
+
+ProgressiveRenderer::ProgressiveRenderer(int w, int h, int b) :
+	width(w),
+	height(h),
+	startBlock(1),
+	samplesTraced(0),
+	samples(w*h),
+	traced(w*h, 0)
+{
+	// Block sizes are halved every pass, so start from a power of two.
+	while(startBlock < b) {
+		startBlock *= 2;
+	}
+}
+
+ProgressiveRenderer::~ProgressiveRenderer()
+{
+}
+
+int ProgressiveRenderer::render(const SampleFunc &sample, Image &image, double budgetSeconds, const PassFunc &onPass)
+{
+	auto start = chrono::steady_clock::now();
+	auto outOfTime = [&]() {
+		if(budgetSeconds <= 0.0) {
+			return false;
+		}
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+		return elapsed.count() >= budgetSeconds;
+	};
+
+	int finished = 0;
+	for(int block = startBlock; block >= 1; block /= 2) {
+		bool interrupted = false;
+		for(int y = 0; y < height && !interrupted; y += block) {
+			for(int x = 0; x < width; x += block) {
+				int index = y*width + x;
+				if(traced[index]) {
+					continue; // traced by a coarser pass
+				}
+				samples[index] = sample(x, y);
+				traced[index] = 1;
+				++samplesTraced;
+			}
+			// The coarsest pass always finishes so that there is an image to show.
+			interrupted = block != startBlock && outOfTime();
+		}
+		fill(image, block);
+		if(interrupted) {
+			break;
+		}
+		finished = block;
+		if(onPass) {
+			onPass(image, block);
+		}
+	}
+	return finished;
+}
+
+void ProgressiveRenderer::fill(Image &image, int blockSize) const
+{
+	for(int y = 0; y < height; ++y) {
+		for(int x = 0; x < width; ++x) {
+			// Use the finest traced sample whose block contains this pixel.
+			int index = 0;
+			for(int b = blockSize; b <= startBlock; b *= 2) {
+				index = (y - y%b)*width + (x - x%b);
+				if(traced[index]) {
+					break;
+				}
+			}
+			const glm::vec3 &c = samples[index];
+			float r = std::min(c.r, 1.0f);
+			float g = std::min(c.g, 1.0f);
+			float b = std::min(c.b, 1.0f);
+			image.setPixel(x, y, r * 255, g * 255, b * 255);
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef PROGRESSIVE_H
+#define PROGRESSIVE_H
+
+#include <functional>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+class Image;
+
+/**
+ * Renders an image coarse-to-fine. The first pass traces one ray per
+ * startBlock x startBlock block, and every later pass halves the block size.
+ * A pixel traced in an earlier pass is never traced again; untraced pixels are
+ * filled with the sample of the finest block that contains them.
+ */
+class ProgressiveRenderer
+{
+public:
+	// Traces pixel (x, y) and returns its radiance
+	typedef std::function<glm::vec3(int x, int y)> SampleFunc;
+	// Called with the filled image after every finished pass
+	typedef std::function<void(const Image &image, int blockSize)> PassFunc;
+
+	ProgressiveRenderer(int width, int height, int startBlock = 8);
+	virtual ~ProgressiveRenderer();
+
+	// Refines until every pixel is traced or budgetSeconds runs out (<= 0 means
+	// no budget). The first pass always completes so the image is valid.
+	// Returns the block size of the last finished pass.
+	int render(const SampleFunc &sample, Image &image, double budgetSeconds, const PassFunc &onPass);
+	int getSamplesTraced() const { return samplesTraced; }
+
+private:
+	void fill(Image &image, int blockSize) const;
+
+	int width;
+	int height;
+	int startBlock;
+	int samplesTraced;
+	std::vector<glm::vec3> samples;
+	std::vector<unsigned char> traced;
+};
+
+#endif
@@ -16,7 +16,8 @@ using namespace std;
 Shape::Shape() :
 	posBufID(0),
 	norBufID(0),
-	texBufID(0)
+	texBufID(0),
+	boundsValid(false)
 {
 }
 
@@ -68,22 +69,15 @@ void Shape::loadMesh(const string &meshName)
 			}
 		}
 	}
+	bounds.compute(posBuf);
+	boundsValid = true;
 }
 
 void Shape::fitToUnitBox()
 {
 	// Scale the vertex positions so that they fit within [-1, +1] in all three dimensions.
-	glm::vec3 vmin(posBuf[0], posBuf[1], posBuf[2]);
-	glm::vec3 vmax(posBuf[0], posBuf[1], posBuf[2]);
-	for(int i = 0; i < (int)posBuf.size(); i += 3) {
-		glm::vec3 v(posBuf[i], posBuf[i+1], posBuf[i+2]);
-		vmin.x = min(vmin.x, v.x);
-		vmin.y = min(vmin.y, v.y);
-		vmin.z = min(vmin.z, v.z);
-		vmax.x = max(vmax.x, v.x);
-		vmax.y = max(vmax.y, v.y);
-		vmax.z = max(vmax.z, v.z);
-	}
+	glm::vec3 vmin = getBounds().vmin;
+	glm::vec3 vmax = getBounds().vmax;
 	glm::vec3 center = 0.5f*(vmin + vmax);
 	glm::vec3 diff = vmax - vmin;
 	float diffmax = diff.x;
@@ -95,6 +89,16 @@ void Shape::fitToUnitBox()
 		posBuf[i+1] = (posBuf[i+1] - center.y) * scale;
 		posBuf[i+2] = (posBuf[i+2] - center.z) * scale;
 	}
+	boundsValid = false;
+}
+
+const Bounds &Shape::getBounds(bool withObb) const
+{
+	if(!boundsValid || (withObb && !bounds.hasObb)) {
+		bounds.compute(posBuf, withObb);
+		boundsValid = true;
+	}
+	return bounds;
 }
 
 void Shape::init()
@@ -6,6 +6,8 @@
 #include <vector>
 #include <memory>
 
+#include "Bounds.h"
+
 class Program;
 
 /**
@@ -14,6 +16,9 @@ class Program;
  * - norBuf should be of length 3*ntris (if normals are available)
  * - texBuf should be of length 2*ntris (if texture coords are available)
  * posBufID, norBufID, and texBufID are OpenGL buffer identifiers.
+ *
+ * The bounds are computed when the mesh is loaded and again, on first use,
+ * after anything that moves the vertices (fitToUnitBox()).
  */
 class Shape
 {
@@ -22,6 +27,8 @@ public:
 	virtual ~Shape();
 	void loadMesh(const std::string &meshName);
 	void fitToUnitBox();
+	// Pass withObb to also get the oriented box.
+	const Bounds &getBounds(bool withObb = false) const;
 	void init();
 	void draw(const std::shared_ptr<Program> prog) const;
     std::vector<float> getPosBuf(){
@@ -38,6 +45,8 @@ private:
 	unsigned posBufID;
 	unsigned norBufID;
 	unsigned texBufID;
+	mutable Bounds bounds;
+	mutable bool boundsValid;
 };
 
 #endif
@@ -0,0 +1,322 @@
+#include "TileCoordinator.h"
+#include "Image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+struct TileCoordinator::Worker
+{
+#ifndef _WIN32
+	pid_t pid = -1;
+#endif
+	int toWorker = -1; // tile indices, -1 to quit
+	int fromWorker = -1; // tile index then pixels
+	int tile = -1; // tile being rendered, -1 when idle
+	chrono::steady_clock::time_point started;
+	vector<unsigned char> buffer;
+	size_t received = 0;
+};
+
+TileCoordinator::TileCoordinator(int w, int h, int t) :
+	width(w),
+	height(h),
+	tileSize(max(1, t)),
+	workers(1),
+	timeout(30.0),
+	maxAttempts(3),
+	reassigned(0),
+	respawned(0)
+{
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+}
+
+TileCoordinator::~TileCoordinator()
+{
+}
+
+void TileCoordinator::tileRect(int tile, int &x0, int &y0, int &w, int &h) const
+{
+	x0 = (tile % tilesX)*tileSize;
+	y0 = (tile / tilesX)*tileSize;
+	w = min(tileSize, width - x0);
+	h = min(tileSize, height - y0);
+}
+
+void TileCoordinator::storeTile(int tile, const unsigned char *rgb, Image &image) const
+{
+	int x0, y0, w, h;
+	tileRect(tile, x0, y0, w, h);
+	for(int y = 0; y < h; ++y) {
+		for(int x = 0; x < w; ++x) {
+			const unsigned char *p = rgb + (y*w + x)*3;
+			image.setPixel(x0 + x, y0 + y, p[0], p[1], p[2]);
+		}
+	}
+}
+
+#ifdef _WIN32
+
+bool TileCoordinator::spawn(Worker &, const TileFunc &, const vector<Worker> &)
+{
+	return false;
+}
+
+void TileCoordinator::retire(Worker &, bool)
+{
+}
+
+bool TileCoordinator::render(const TileFunc &renderTile, Image &image)
+{
+	cout << "Worker processes need fork; rendering the tiles in-process" << endl;
+	vector<unsigned char> rgb(tileSize*tileSize*3);
+	for(int tile = 0; tile < getTileCount(); ++tile) {
+		int x0, y0, w, h;
+		tileRect(tile, x0, y0, w, h);
+		renderTile(x0, y0, w, h, rgb.data());
+		storeTile(tile, rgb.data(), image);
+	}
+	return true;
+}
+
+#else
+
+static bool readFull(int fd, void *data, size_t size)
+{
+	unsigned char *p = (unsigned char *)data;
+	while(size > 0) {
+		ssize_t n = read(fd, p, size);
+		if(n < 0 && errno == EINTR) {
+			continue;
+		}
+		if(n <= 0) {
+			return false;
+		}
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool writeFull(int fd, const void *data, size_t size)
+{
+	const unsigned char *p = (const unsigned char *)data;
+	while(size > 0) {
+		ssize_t n = write(fd, p, size);
+		if(n < 0 && errno == EINTR) {
+			continue;
+		}
+		if(n <= 0) {
+			return false;
+		}
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+bool TileCoordinator::spawn(Worker &worker, const TileFunc &renderTile, const vector<Worker> &all)
+{
+	int down[2], up[2];
+	if(pipe(down) != 0) {
+		return false;
+	}
+	if(pipe(up) != 0) {
+		close(down[0]);
+		close(down[1]);
+		return false;
+	}
+	// Anything still buffered would otherwise be printed by the child too.
+	cout.flush();
+	pid_t pid = fork();
+	if(pid < 0) {
+		close(down[0]); close(down[1]);
+		close(up[0]); close(up[1]);
+		return false;
+	}
+	if(pid == 0) {
+		// Worker: drop the other workers' pipes so that their EOFs still
+		// reach the coordinator, then render tiles until told to quit.
+		for(const Worker &other : all) {
+			if(other.toWorker >= 0) close(other.toWorker);
+			if(other.fromWorker >= 0) close(other.fromWorker);
+		}
+		close(down[1]);
+		close(up[0]);
+		vector<unsigned char> message(sizeof(int32_t) + tileSize*tileSize*3);
+		int32_t tile;
+		while(readFull(down[0], &tile, sizeof(tile)) && tile >= 0) {
+			int x0, y0, w, h;
+			tileRect(tile, x0, y0, w, h);
+			memcpy(message.data(), &tile, sizeof(tile));
+			renderTile(x0, y0, w, h, message.data() + sizeof(tile));
+			if(!writeFull(up[1], message.data(), sizeof(tile) + w*h*3)) {
+				break;
+			}
+		}
+		_exit(0);
+	}
+	close(down[0]);
+	close(up[1]);
+	fcntl(up[0], F_SETFL, fcntl(up[0], F_GETFL) | O_NONBLOCK);
+	worker.pid = pid;
+	worker.toWorker = down[1];
+	worker.fromWorker = up[0];
+	worker.tile = -1;
+	worker.received = 0;
+	worker.buffer.resize(sizeof(int32_t) + tileSize*tileSize*3);
+	return true;
+}
+
+void TileCoordinator::retire(Worker &worker, bool killWorker)
+{
+	if(worker.pid > 0) {
+		if(killWorker) {
+			kill(worker.pid, SIGKILL);
+		} else {
+			int32_t quit = -1;
+			writeFull(worker.toWorker, &quit, sizeof(quit));
+		}
+	}
+	if(worker.toWorker >= 0) close(worker.toWorker);
+	if(worker.fromWorker >= 0) close(worker.fromWorker);
+	if(worker.pid > 0) {
+		waitpid(worker.pid, nullptr, 0);
+	}
+	worker.pid = -1;
+	worker.toWorker = -1;
+	worker.fromWorker = -1;
+	worker.tile = -1;
+}
+
+bool TileCoordinator::render(const TileFunc &renderTile, Image &image)
+{
+	// A worker dying mid-write must not take the coordinator down with it.
+	void (*oldPipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+	int tileCount = getTileCount();
+	deque<int> queue;
+	for(int tile = 0; tile < tileCount; ++tile) {
+		queue.push_back(tile);
+	}
+	vector<int> attempts(tileCount, 0);
+	int done = 0;
+	bool ok = true;
+
+	vector<Worker> pool(max(1, min(workers, tileCount)));
+	for(Worker &worker : pool) {
+		if(!spawn(worker, renderTile, pool)) {
+			cout << "Couldn't start a worker process" << endl;
+		}
+	}
+
+	// Puts the worker's tile back on the queue and starts a replacement.
+	auto fail = [&](Worker &worker) {
+		int tile = worker.tile;
+		retire(worker, true);
+		if(tile >= 0) {
+			++reassigned;
+			if(++attempts[tile] >= maxAttempts) {
+				cout << "Tile " << tile << " failed " << attempts[tile] << " times" << endl;
+				ok = false;
+			}
+			queue.push_front(tile);
+		}
+		if(spawn(worker, renderTile, pool)) {
+			++respawned;
+		}
+	};
+
+	while(ok && done < tileCount) {
+		// Hand a tile to every idle worker.
+		for(Worker &worker : pool) {
+			if(worker.pid < 0 || worker.tile >= 0 || queue.empty()) {
+				continue;
+			}
+			int32_t tile = queue.front();
+			queue.pop_front();
+			worker.tile = tile;
+			worker.received = 0;
+			worker.started = chrono::steady_clock::now();
+			if(!writeFull(worker.toWorker, &tile, sizeof(tile))) {
+				fail(worker);
+			}
+		}
+
+		vector<pollfd> fds;
+		vector<Worker *> busy;
+		for(Worker &worker : pool) {
+			if(worker.pid > 0 && worker.tile >= 0) {
+				fds.push_back({worker.fromWorker, POLLIN, 0});
+				busy.push_back(&worker);
+			}
+		}
+		if(busy.empty()) {
+			cout << "No worker processes left" << endl;
+			ok = false;
+			break;
+		}
+		// Wake up regularly to check for workers that have stalled.
+		poll(fds.data(), fds.size(), 100);
+
+		auto now = chrono::steady_clock::now();
+		for(size_t i = 0; i < busy.size(); ++i) {
+			Worker &worker = *busy[i];
+			bool failed = false;
+			if(fds[i].revents != 0) {
+				int x0, y0, w, h;
+				tileRect(worker.tile, x0, y0, w, h);
+				size_t expected = sizeof(int32_t) + w*h*3;
+				ssize_t n = read(worker.fromWorker, worker.buffer.data() + worker.received, expected - worker.received);
+				if(n > 0) {
+					worker.received += n;
+					if(worker.received == expected) {
+						int32_t tile;
+						memcpy(&tile, worker.buffer.data(), sizeof(tile));
+						if(tile == worker.tile) {
+							storeTile(tile, worker.buffer.data() + sizeof(tile), image);
+							++done;
+							worker.tile = -1;
+						} else {
+							failed = true;
+						}
+					}
+				} else if(n == 0 || (errno != EAGAIN && errno != EINTR)) {
+					// The worker exited or crashed.
+					failed = true;
+				}
+			}
+			if(!failed && worker.tile >= 0 && chrono::duration<double>(now - worker.started).count() > timeout) {
+				cout << "Worker " << worker.pid << " timed out on tile " << worker.tile << endl;
+				failed = true;
+			}
+			if(failed) {
+				fail(worker);
+			}
+		}
+	}
+
+	for(Worker &worker : pool) {
+		retire(worker, !ok);
+	}
+	signal(SIGPIPE, oldPipe);
+	return ok;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+#ifndef TILE_COORDINATOR_H
+#define TILE_COORDINATOR_H
+
+#include <functional>
+#include <vector>
+
+class Image;
+
+/**
+ * Renders an image by handing tiles to a pool of local worker processes. The
+ * workers are forked from the coordinator, so they inherit the scene and no
+ * scene description has to be sent. Each worker is fed one tile index at a
+ * time over a pipe and answers with the tile index followed by the tile's
+ * pixels as raw RGB bytes, bottom row first.
+ *
+ * A worker that exits, or that holds a tile longer than the timeout, is killed
+ * and replaced, and its tile goes back on the queue. A tile that fails
+ * maxAttempts times aborts the render.
+ *
+ * On Windows, which has no fork, the tiles are rendered in-process.
+ */
+class TileCoordinator
+{
+public:
+	// Fills rgb (w*h*3 bytes, bottom row first) with the tile at (x0, y0)
+	typedef std::function<void(int x0, int y0, int w, int h, unsigned char *rgb)> TileFunc;
+
+	TileCoordinator(int width, int height, int tileSize = 64);
+	virtual ~TileCoordinator();
+
+	void setWorkers(int n) { workers = n; }
+	// Seconds a worker may spend on one tile before it is replaced
+	void setTimeout(double seconds) { timeout = seconds; }
+	void setMaxAttempts(int n) { maxAttempts = n; }
+
+	// Returns false if a tile could not be rendered
+	bool render(const TileFunc &renderTile, Image &image);
+	int getTileCount() const { return tilesX*tilesY; }
+	int getReassigned() const { return reassigned; }
+	int getRespawned() const { return respawned; }
+
+private:
+	struct Worker;
+
+	void tileRect(int tile, int &x0, int &y0, int &w, int &h) const;
+	void storeTile(int tile, const unsigned char *rgb, Image &image) const;
+	bool spawn(Worker &worker, const TileFunc &renderTile, const std::vector<Worker> &all);
+	void retire(Worker &worker, bool kill);
+
+	int width;
+	int height;
+	int tileSize;
+	int tilesX;
+	int tilesY;
+	int workers;
+	double timeout;
+	int maxAttempts;
+	int reassigned;
+	int respawned;
+};
+
+#endif
@@ -1,8 +1,12 @@
 #include <cassert>
+#include <chrono>
 #include <cstring>
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <random>
 #include <vector>
 
 
@@ -23,6 +27,14 @@
 #include "Program.h"
 #include "Shape.h"
 #include "Image.h"
+#include "Progressive.h"
+#include "Adaptive.h"
+#include "Denoiser.h"
+#include "AovWriter.h"
+#include "PngStream.h"
+#include "TileCoordinator.h"
+#include "LightTree.h"
+#include "PixelOrder.h"
 
 #include <math.h>
 
@@ -92,6 +104,9 @@ public:
     virtual vec3 computeRayColor(vec3 cameraPosition, vec3 rayDirection, vector<Light>& lights, vector<Object*>& objects, Object& object, vec3 hitPoint, int depth) = 0;
     virtual float intersectTest(vec3 cameraPos, vec3 rayDirection) = 0;
     virtual bool doHit(vec3 cameraPos, vec3 rayDirection) = 0;
+    // Surface normal and diffuse color at the hit found by the last intersectTest()
+    virtual vec3 getNormal(vec3 hitPoint) = 0;
+    virtual vec3 getAlbedo() = 0;
 };
 
 class Sphere : public Object {
@@ -113,6 +128,14 @@ public:
         return hitPoint;
         
     }
+    vec3 getNormal(vec3 hitPoint) override
+    {
+        return (hitPoint - center) / radius;
+    }
+    vec3 getAlbedo() override
+    {
+        return diffuseColor;
+    }
     vec3 computeRayColor(vec3 cameraPosition, vec3 rayDirection, vector<Light>& lights, vector<Object*>& objects, Object& object, vec3 hitPoint, int depth) override {
         vec3 ca = ambientColor;
         vec3 color = ca;
@@ -227,6 +250,14 @@ public:
         return hitPoint;
         
     }
+    vec3 getNormal(vec3 hitPoint) override
+    {
+        return rotation;
+    }
+    vec3 getAlbedo() override
+    {
+        return diffuseColor;
+    }
 
     vec3 computeRayColor(vec3 cameraPosition, vec3 rayDirection, vector<Light>& lights, vector<Object*>& objects, Object& object, vec3 hitPoint, int depth) override {
         
@@ -326,6 +357,14 @@ public:
     {
         return ellipseHP;
     }
+    vec3 getNormal(vec3 hitPoint) override
+    {
+        return ellipseNor;
+    }
+    vec3 getAlbedo() override
+    {
+        return diffuseColor;
+    }
     vec3 computeRayColor(vec3 cameraPosition, vec3 rayDirection, vector<Light>& lights, vector<Object*>& objects, Object& object, vec3 hitPoint, int depth) override {
         vec3 ca = ambientColor;
         vec3 color = ca;
@@ -491,6 +530,15 @@ public:
         return hitPoint;
         
     }
+    vec3 getNormal(vec3 hitPoint) override
+    {
+        return (hitPoint - center) / radius;
+    }
+    vec3 getAlbedo() override
+    {
+        // A mirror has no color of its own
+        return vec3(1.0f);
+    }
     vec3 computeRayColor(vec3 cameraPosition, vec3 rayDirection, vector<Light>& lights, vector<Object*>& objects, Object& object, vec3 hitPoint, int depth) override {
         // Compute the color of the object at the hit point
         vec3 finalColor = vec3(0.0f);
@@ -580,6 +628,9 @@ public:
 
 // NEED TO TAKE INTO ACCOUNT FOV AT SOME POINT
 std::vector<glm::vec3> generateRays(int imageSize) {
+    // Start over, or every call would append another frame of rays
+    rays.clear();
+
     // Calculate the width and height of the image
     int width = imageSize;
     int height = imageSize;
@@ -616,29 +667,10 @@ float distance(vec3& v1, vec3& v2) {
                      (v1.z - v2.z) * (v1.z - v2.z));
 }
 
-// Function to create a bounding sphere
-void createBoundingSphere(std::vector<float>& posBuf, vec3& center, float& radius) {
-    // Find the center
-    float sumX = 0;
-    float sumY = 0;
-    float sumZ = 0;
-    for (int i = 0; i < posBuf.size(); i += 3) {
-        sumX += posBuf[i];
-        sumY += posBuf[i + 1];
-        sumZ += posBuf[i + 2];
-    }
-    center.x = sumX / (posBuf.size() / 3);
-    center.y = sumY / (posBuf.size() / 3);
-    center.z = sumZ / (posBuf.size() / 3);
-
-    // Find the radius
-    radius = 0;
-    for (int i = 0; i < posBuf.size(); i += 3)  {
-        vec3 vertex = vec3(posBuf[i], posBuf[i + 1], posBuf[i + 2]);
-        float dist = distance(vertex, center);
-        if (dist > radius)
-            radius = dist;
-    }
+// Function to create a bounding sphere; the shape computes it when it loads
+void createBoundingSphere(const Shape& shape, vec3& center, float& radius) {
+    center = shape.getBounds().sphereCenter;
+    radius = shape.getBounds().sphereRadius;
 }
 /* code rewritten to do tests on the sign of the determinant */
 /* the division is at the end in the code                    */
@@ -744,175 +776,641 @@ std::vector<glm::vec3> newGenerateRays(int imageSize, vec3 cameraPostion) {
 
 
 
+// Direction of the primary ray through the continuous pixel position (px, py).
+// Pixel (x, y) has its center at (x + 0.5, y + 0.5), matching generateRays().
+vec3 generateRay(float px, float py, int imageSize)
+{
+    return glm::normalize(vec3(px / imageSize - 0.5f, py / imageSize - 0.5f, -1.0f));
+}
+
+// Everything a render mode needs to trace a scene. The objects are owned here
+// so a scene can be built once and handed to any of the render loops.
+struct Scene {
+    vector<Light> lights;
+    vector<shared_ptr<Object>> owned;
+    vector<Object*> objects;
+    int depth;
+    // Bumped whenever the geometry changes, so cached primary hits can tell
+    // they are stale. Moving lights doesn't touch it.
+    int geometryVersion = 0;
+    // With a light tree, points are shaded with a cut of it instead of every light.
+    shared_ptr<LightTree> lightTree;
+    vector<LightTree::Entry> cut;
+    vector<Light> cutLights;
+    long long lightEvaluations = 0;
+
+    void add(shared_ptr<Object> object)
+    {
+        owned.push_back(object);
+        objects.push_back(object.get());
+        geometryVersion++;
+    }
+
+    // Must be called again after the lights change.
+    void buildLightTree(float quality)
+    {
+        vector<vec3> positions;
+        vector<float> intensities;
+        for (const Light& light : lights) {
+            positions.push_back(light.position);
+            intensities.push_back(light.intensity);
+        }
+        lightTree = make_shared<LightTree>();
+        lightTree->setQuality(quality);
+        lightTree->build(positions, intensities);
+    }
+
+    // The lights to shade point p with. Reflections are shaded with the cut of
+    // the point the reflection was seen from.
+    vector<Light>& lightsAt(vec3 p)
+    {
+        if (!lightTree) {
+            lightEvaluations += lights.size();
+            return lights;
+        }
+        lightTree->selectCut(p, cut);
+        cutLights.clear();
+        for (const LightTree::Entry& e : cut) {
+            cutLights.push_back({lights[e.light].position, e.intensity});
+        }
+        lightEvaluations += cutLights.size();
+        return cutLights;
+    }
+};
+
+// Builds the analytic scenes. Returns false for the mesh scenes (6 and 7),
+// which have their own loop in main().
+bool buildScene(int scene, ManualCamera& camera, Scene& world)
+{
+    // Task 2
+    if (scene <= 2) {
+        world.depth = 30;
+        world.lights.push_back({{-2.0, 1.0, 1.0}, 1.0});
+        world.add(make_shared<Sphere>(vec3(-0.5f, -1.0f, 1.0f), 1.0f, vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f));
+        world.add(make_shared<Sphere>(vec3(0.5f, -1.0f, -1.0f), 1.0f, vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f));
+        world.add(make_shared<Sphere>(vec3(0.0f, 1.0f, 0.0f), 1.0f, vec3(0.0f, 0.0f, 1.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f));
+        return true;
+    }
+    // Task 3
+    if (scene == 3) {
+        world.depth = 5;
+        world.lights.push_back({{1.0f, 2.0f, 2.0f}, 0.5f});
+        world.lights.push_back({{-1.0f, 2.0f, -1.0f}, 0.5f});
+        
+        auto M = make_shared<MatrixStack>();
+        M->translate(0.5f, 0.0f, 0.5f);
+        M->scale(0.5f, 0.6f, 0.2f);
+        glm::mat4 E = M->topMatrix();
+        world.add(make_shared<Ellipsoid>(vec3(0.5f, 0.0f, 0.5f), vec3(0.5f, 0.6f, 0.2f), vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f, E));
+        world.add(make_shared<Sphere>(vec3(-0.5f, 0.0f, -0.5f), 1.0f, vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f));
+        world.add(make_shared<Plane>(vec3(0.0f, -1.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 1.0f), vec3(0.0f, 0.0f, 0.0f), vec3(0.1f, 0.1f, 0.1f), 0.0f));
+        return true;
+    }
+    // Task 4
+    if (scene == 4 || scene == 5) {
+        world.depth = 3;
+        world.lights.push_back({{-1.0, 2.0, 1.0}, 0.5f});
+        world.lights.push_back({{0.5, -0.5, 0.0}, 0.5f});
+        
+        world.add(make_shared<Plane>(vec3(0.0, 0.0, -3.0), vec3(0.0f, 0.0f, 1.0f), vec3(1.0f, 1.0f, 1.0f), vec3(0.0f, 0.0f, 0.0f), vec3(0.1f, 0.1f, 0.1f), 0.0f));
+        world.add(make_shared<Plane>(vec3(0.0, -1.0, 0.0), vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 1.0f), vec3(0.0f, 0.0f, 0.0f), vec3(0.1f, 0.1f, 0.1f), 0.0f));
+        world.add(make_shared<Sphere>(vec3(1.0, -0.7, 0.0), 0.3f, vec3(0.0f, 0.0f, 1.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f));
+        world.add(make_shared<Sphere>(vec3(0.5, -0.7, 0.5), 0.3f, vec3(1.0, 0.0, 0.0), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f));
+        world.add(make_shared<ReflectiveSphere>(vec3(-0.5, 0.0, -0.5), 1.0f));
+        world.add(make_shared<ReflectiveSphere>(vec3(1.5, 0.0, -1.5), 1.0f));
+        return true;
+    }
+    // TASK 6
+    if (scene == 8) {
+        world.depth = 30;
+        //camera.changeFOV(60.0f);
+        camera.changePosition(vec3(-3,0,0));
+       
+        glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);  // Look at the positve x axis
+        glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);  // Y-axis is up
+
+        glm::mat4 view = glm::lookAt(camera.getPosition(), cameraTarget, up);
+        glm::mat4 transformMatrix = view;
+
+        vec3 rSpherePos = vec3(transformMatrix *  vec4(vec3(-0.5f, -1.0f, 1.0f), 1.0f));
+        vec3 gSpherePos = vec3(transformMatrix *  vec4(vec3(0.5f, -1.0f, -1.0f), 1.0f));
+        vec3 bSpherePos = vec3(transformMatrix *  vec4(vec3(0.0f, 1.0f, 0.0f), 1.0f));
+        
+        // Define the light
+        Light light = {{-2.0, 1.0, 1.0}, 1.0};
+        light.position = vec3(transformMatrix *  vec4(light.position, 1.0f));
+        world.lights.push_back(light);
+        
+        camera.changePosition(vec3(0,0,0));
+        world.add(make_shared<Sphere>(rSpherePos, 1.0f, vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f));
+        world.add(make_shared<Sphere>(gSpherePos, 1.0f, vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f));
+        world.add(make_shared<Sphere>(bSpherePos, 1.0f, vec3(0.0f, 0.0f, 1.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f));
+        return true;
+    }
+    return false;
+}
+
+// What the primary ray hit, for the AOV buffers. objectId is the index into
+// Scene::objects, or -1 on a miss.
+struct HitInfo {
+    float t;
+    vec3 normal;
+    vec3 albedo;
+    int objectId;
+};
+
+// Shades the closest object along a primary ray. Returns black on a miss.
+vec3 tracePrimary(Scene& world, vec3 origin, vec3 rayDirection, HitInfo* hit = nullptr)
+{
+    vec3 colors = {0.0f, 0.0f, 0.0f};
+    float closestT = static_cast<float>(numeric_limits<int>::max());
+    if (hit) {
+        *hit = {0.0f, vec3(0.0f), vec3(0.0f), -1};
+    }
+    for (size_t k = 0; k < world.objects.size(); k++)
+    {
+        Object* obj = world.objects[k];
+        bool hasHit = obj->doHit(origin, rayDirection);
+        float t = obj->intersectTest(origin, rayDirection);
+        if (hasHit && t < closestT) {
+            closestT = t;
+            vec3 hitPoint = obj->findHit(t, origin, rayDirection);
+            if (hit) {
+                // Before shading, whose shadow rays may overwrite the ellipsoid's hit
+                *hit = {t, obj->getNormal(hitPoint), obj->getAlbedo(), (int)k};
+            }
+            colors = obj->computeRayColor(origin, rayDirection, world.lightsAt(hitPoint), world.objects, *obj, hitPoint, world.depth);
+        }
+    }
+    return colors;
+}
+
+// Replaces the scene's lights with count random lights above the scene that
+// have the same total intensity, for testing scenes with many lights.
+void setRandomLights(Scene& world, int count)
+{
+    float total = 0.0f;
+    for (const Light& light : world.lights) {
+        total += light.intensity;
+    }
+    std::mt19937 rng(count);
+    std::uniform_real_distribution<float> xz(-3.0f, 3.0f), y(1.0f, 4.0f), weight(0.5f, 1.5f);
+    world.lights.clear();
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++) {
+        world.lights.push_back({vec3(xz(rng), y(rng), xz(rng)), weight(rng)});
+        sum += world.lights.back().intensity;
+    }
+    for (Light& light : world.lights) {
+        light.intensity *= total / sum;
+    }
+}
+
+// Primary hits of one view (a G-buffer). Frames that only change the lights or
+// shading reshade from it instead of intersecting every object again. Shading
+// still traces its own shadow and reflection rays.
+struct PrimaryHitCache {
+    vec3 origin;
+    int imageSize = 0;
+    int geometryVersion = -1;
+    vector<HitInfo> hits;
+    vector<vec3> hitPoints;
+    vector<vec3> directions;
+
+    bool isValid(const Scene& world, vec3 cameraPosition, int size) const
+    {
+        return imageSize == size && origin == cameraPosition && geometryVersion == world.geometryVersion;
+    }
+
+    void build(Scene& world, vec3 cameraPosition, int size)
+    {
+        origin = cameraPosition;
+        imageSize = size;
+        geometryVersion = world.geometryVersion;
+        hits.assign(size * size, {0.0f, vec3(0.0f), vec3(0.0f), -1});
+        hitPoints.assign(size * size, vec3(0.0f));
+        directions = generateRays(size);
+        for (int p = 0; p < size * size; p++) {
+            float closestT = static_cast<float>(numeric_limits<int>::max());
+            for (size_t k = 0; k < world.objects.size(); k++) {
+                Object* obj = world.objects[k];
+                bool hasHit = obj->doHit(origin, directions[p]);
+                float t = obj->intersectTest(origin, directions[p]);
+                if (hasHit && t < closestT) {
+                    closestT = t;
+                    hitPoints[p] = obj->findHit(t, origin, directions[p]);
+                    hits[p] = {t, obj->getNormal(hitPoints[p]), obj->getAlbedo(), (int)k};
+                }
+            }
+        }
+    }
+
+    // Same color as tracePrimary() for pixel p under the current lights
+    vec3 shade(Scene& world, int p) const
+    {
+        if (hits[p].objectId < 0) {
+            return vec3(0.0f);
+        }
+        Object* obj = world.objects[hits[p].objectId];
+        // The ellipsoid shades with the normal of its last intersection, so
+        // restore it with this one object rather than the whole scene.
+        obj->intersectTest(origin, directions[p]);
+        return obj->computeRayColor(origin, directions[p], world.lightsAt(hitPoints[p]), world.objects, *obj, hitPoints[p], world.depth);
+    }
+};
+
+void setPixelColor(Image& image, int x, int y, vec3 colors)
+{
+    float r = std::min(colors.r , 1.0f);
+    float g = std::min(colors.g , 1.0f);
+    float b = std::min(colors.b , 1.0f);
+    image.setPixel(x, y, r * 255, g * 255, b * 255);
+}
+
+// Optional arguments after the output filename are given as `name` or
+// `name=value`. Returns true if `name` was given and stores its value.
+bool getOption(int argc, char **argv, const string& name, string* value = nullptr)
+{
+    for (int i = 5; i < argc; i++) {
+        string arg(argv[i]);
+        if (arg == name) {
+            return true;
+        }
+        if (arg.compare(0, name.size() + 1, name + "=") == 0) {
+            if (value) {
+                *value = arg.substr(name.size() + 1);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// Out-of-core render: bands of tile x tile blocks are traced into a buffer one
+// band high and streamed into the PNG, so memory doesn't grow with the image.
+// With resume, a killed render picks up after its last completed band.
+void renderTiled(Scene& world, ManualCamera& camera, int imageSize, int tile, const string& filename, bool resume)
+{
+    PngStream png;
+    if (!png.open(filename, imageSize, imageSize, tile, resume)) {
+        return;
+    }
+    vector<unsigned char> band((size_t)imageSize * tile * 3);
+    for (int b = png.getNextBand(); b < png.getBandCount(); b++) {
+        int rows = std::min(tile, imageSize - b * tile);
+        for (int x0 = 0; x0 < imageSize; x0 += tile) {
+            int x1 = std::min(imageSize, x0 + tile);
+            for (int r = 0; r < rows; r++) {
+                // PNG rows go top to bottom, but row 0 of the render is at the bottom.
+                int i = imageSize - 1 - (b * tile + r);
+                for (int j = x0; j < x1; j++) {
+                    vec3 colors = tracePrimary(world, camera.getPosition(), generateRay(j + 0.5f, i + 0.5f, imageSize));
+                    unsigned char* p = &band[((size_t)r * imageSize + j) * 3];
+                    p[0] = std::min(colors.r , 1.0f) * 255;
+                    p[1] = std::min(colors.g , 1.0f) * 255;
+                    p[2] = std::min(colors.b , 1.0f) * 255;
+                }
+            }
+        }
+        png.writeBand(band.data());
+        cout << "Band " << b + 1 << "/" << png.getBandCount() << endl;
+    }
+    png.finish();
+}
+
 int main(int argc, char **argv)
 {
-    if(argc < 4) {
+    if(argc < 5) {
         cout << "A6 not enough arguments" << endl;
+        cout << "Usage: A6 RESOURCE_DIR SCENE SIZE OUTPUT [progressive[=BLOCK]] [budget=SECONDS]" << endl;
+        cout << "       [adaptive] [spp=MAX] [minspp=MIN] [threshold=ERR] [heatmap=FILE] [reference=SPP]" << endl;
+        cout << "       [denoise] [spp=N] [iterations=N] [sigma_color|sigma_depth|sigma_normal|sigma_albedo=S] [threads=N]" << endl;
+        cout << "       [aov=FILE] [channels=rgb,depth,normal,id]" << endl;
+        cout << "       [tiled[=TILE]] [resume]" << endl;
+        cout << "       [workers=N] [tile=SIZE] [timeout=SECONDS] [scaling]" << endl;
+        cout << "       [sweep[=FRAMES]]" << endl;
+        cout << "       [lights=N] [lightquality=ERR] [lightbench]" << endl;
+        cout << "       [order=rows|morton|hilbert] [ordertile=SIZE]" << endl;
         return 0;
     }
     int scene = atoi(argv[2]);
     int imageSize = atoi(argv[3]);
     string output_filename(argv[4]);
     
-    auto image = make_shared<Image>(imageSize, imageSize);
-    
     // Task 1
     glm::vec3 position = glm::vec3(0.0f, 0.0f, 5.0f);
     float fov = 45.0f;
     
     ManualCamera camera(position, fov);
-    std::vector<glm::vec3> rays = generateRays(imageSize);
-        
-    // Task 2
-    if (scene <= 2) {
-        vector<vector<float>> distBuf(imageSize, vector<float>(imageSize, static_cast<float>(numeric_limits<int>::max())));
-        // Define the light
-        Light light = {{-2.0, 1.0, 1.0}, 1.0};
-        vector<Light> lights;
-        lights.push_back(light);
-        // Define the spheres
-        Sphere redSphere(vec3(-0.5f, -1.0f, 1.0f), 1.0f, vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f);
-        Sphere greenSphere(vec3(0.5f, -1.0f, -1.0f), 1.0f, vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f);
-        Sphere blueSphere(vec3(0.0f, 1.0f, 0.0f), 1.0f, vec3(0.0f, 0.0f, 1.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f);
-        
-        vector<Object*> objects;
-        objects.push_back(&redSphere);
-        objects.push_back(&greenSphere);
-        objects.push_back(&blueSphere);
-
-        for (int i = 0; i < imageSize; i++) {
-            for (int j = 0; j < imageSize; j++) {
-                vec3 colors = {0.0f, 0.0f, 0.0f};
-                for (Object* obj : objects)
-                {
-                    bool hasHit = obj->doHit(camera.getPosition(), rays[i * imageSize + j]);
-                    float t = obj->intersectTest(camera.getPosition(), rays[i * imageSize + j]);
-                    if (hasHit && t < distBuf[i][j]) {
-                        distBuf[i][j] = t;
-                        
-                        
-                        vec3 hitPoint = obj->findHit(t, camera.getPosition(), rays[i * imageSize + j]);
-                        
-                        colors = obj->computeRayColor(camera.getPosition(), rays[i * imageSize + j], lights, objects, *obj, hitPoint, 30);
-                        
+    
+    Scene world;
+    bool analytic = buildScene(scene, camera, world);
+    string value;
+    if (analytic && getOption(argc, argv, "lights", &value)) {
+        setRandomLights(world, std::max(1, atoi(value.c_str())));
+    }
+    float lightQuality = getOption(argc, argv, "lightquality", &value) ? atof(value.c_str()) : 0.02f;
+    if (analytic && getOption(argc, argv, "lightquality")) {
+        world.buildLightTree(lightQuality);
+    }
+    if (analytic && getOption(argc, argv, "tiled", &value)) {
+        // Streams straight to disk, so there is no full-frame Image.
+        int tile = value.empty() ? 64 : std::max(1, atoi(value.c_str()));
+        renderTiled(world, camera, imageSize, tile, output_filename, getOption(argc, argv, "resume"));
+        return 0;
+    }
+    
+    auto image = make_shared<Image>(imageSize, imageSize);
+    
+    if (analytic) {
+        if (getOption(argc, argv, "progressive", &value)) {
+            // Coarse-to-fine: the image on disk is refreshed after every pass.
+            int startBlock = value.empty() ? 8 : atoi(value.c_str());
+            double budget = getOption(argc, argv, "budget", &value) ? atof(value.c_str()) : 0.0;
+            ProgressiveRenderer progressive(imageSize, imageSize, startBlock);
+            auto sample = [&](int x, int y) {
+                return tracePrimary(world, camera.getPosition(), generateRay(x + 0.5f, y + 0.5f, imageSize));
+            };
+            auto onPass = [&](const Image& img, int blockSize) {
+                cout << "Pass " << blockSize << "x" << blockSize << ": " << progressive.getSamplesTraced() << " samples" << endl;
+                image->writeToFile(output_filename);
+            };
+            progressive.render(sample, *image, budget, onPass);
+        } else if (getOption(argc, argv, "workers", &value)) {
+            // Tiles are rendered by forked worker processes. With scaling, the
+            // frame is rendered with 1, 2, ..., N workers and the speedups printed.
+            int maxWorkers = std::max(1, atoi(value.c_str()));
+            int tile = getOption(argc, argv, "tile", &value) ? atoi(value.c_str()) : 32;
+            double timeout = getOption(argc, argv, "timeout", &value) ? atof(value.c_str()) : 30.0;
+            auto renderTile = [&](int x0, int y0, int w, int h, unsigned char* rgb) {
+                for (int y = 0; y < h; y++) {
+                    for (int x = 0; x < w; x++) {
+                        vec3 colors = tracePrimary(world, camera.getPosition(), generateRay(x0 + x + 0.5f, y0 + y + 0.5f, imageSize));
+                        unsigned char* p = &rgb[(y * w + x) * 3];
+                        p[0] = std::min(colors.r , 1.0f) * 255;
+                        p[1] = std::min(colors.g , 1.0f) * 255;
+                        p[2] = std::min(colors.b , 1.0f) * 255;
                     }
                 }
-                
-                float r = std::min(colors.r , 1.0f);
-                float g = std::min(colors.g , 1.0f);
-                float b = std::min(colors.b , 1.0f);
-                
-                image->setPixel(j, i, r * 255, g * 255, b * 255);
+            };
+            bool scaling = getOption(argc, argv, "scaling");
+            double baseline = 0.0;
+            for (int n = scaling ? 1 : maxWorkers; n <= maxWorkers; n++) {
+                TileCoordinator coordinator(imageSize, imageSize, tile);
+                coordinator.setWorkers(n);
+                coordinator.setTimeout(timeout);
+                auto start = std::chrono::steady_clock::now();
+                if (!coordinator.render(renderTile, *image)) {
+                    cout << "Render with " << n << " workers failed" << endl;
+                    return 1;
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                if (baseline == 0.0) baseline = elapsed.count();
+                cout << n << " workers: " << elapsed.count() << " s, "
+                     << coordinator.getTileCount() / elapsed.count() << " tiles/s, "
+                     << baseline / elapsed.count() << "x";
+                if (coordinator.getReassigned() > 0) cout << ", " << coordinator.getReassigned() << " tiles reassigned";
+                cout << endl;
             }
-        }
-    }
-    
-    // Task 3
-    if (scene == 3) {
-        Light lightOne = {{1.0f, 2.0f, 2.0f}, 0.5f};
-        Light lightTwo = {{-1.0f, 2.0f, -1.0f}, 0.5f};
-        vector<Light> lights;
-        lights.push_back(lightOne);
-        lights.push_back(lightTwo);
-        
-        Plane infPlane(vec3(0.0f, -1.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 1.0f), vec3(0.0f, 0.0f, 0.0f), vec3(0.1f, 0.1f, 0.1f), 0.0f);
-        Sphere greenSphere(vec3(-0.5f, 0.0f, -0.5f), 1.0f, vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f);
-        
-        
-        auto M = make_shared<MatrixStack>();
-        M->translate(0.5f, 0.0f, 0.5f);
-        M->scale(0.5f, 0.6f, 0.2f);
-        glm::mat4 E = M->topMatrix();
-        Ellipsoid ellipse(vec3(0.5f, 0.0f, 0.5f), vec3(0.5f, 0.6f, 0.2f), vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f, E);
-        vector<Object*> objects;
-        objects.push_back(&ellipse);
-        objects.push_back(&greenSphere);
-        objects.push_back(&infPlane);
-       
-        
-        
-        vector<vector<float>> distBuf(imageSize, vector<float>(imageSize, static_cast<float>(numeric_limits<int>::max())));
-        for (int i = 0; i < imageSize; i++) {
-            for (int j = 0; j < imageSize; j++) {
-                vec3 colors = {0.0f, 0.0f, 0.0f};
-                for (Object* obj : objects)
-                {
-                    bool hasHit = obj->doHit(camera.getPosition(), rays[i * imageSize + j]);
-                    float t = obj->intersectTest(camera.getPosition(), rays[i * imageSize + j]);
-                    
-                    if (hasHit && t < distBuf[i][j]) {
-                        distBuf[i][j] = t;
-                        
-                        vec3 hitPoint = obj->findHit(t, camera.getPosition(), rays[i * imageSize + j]);
-                        colors = obj->computeRayColor(camera.getPosition(), rays[i * imageSize + j], lights, objects, *obj, hitPoint, 5);
+        } else if (getOption(argc, argv, "sweep", &value)) {
+            // Light-placement sweep: the first light circles the scene's y axis
+            // for FRAMES frames. The frames are rendered once from the cached
+            // primary hits and once in full, and the last frame is written.
+            int frames = value.empty() ? 100 : std::max(1, atoi(value.c_str()));
+            vec3 start = world.lights[0].position;
+            float radius = glm::length(vec2(start.x, start.z));
+            if (radius < 1e-3f) radius = 1.0f;
+            float angle0 = atan2(start.z, start.x);
+            auto placeLight = [&](int f) {
+                float angle = angle0 + 6.28318531f * f / frames;
+                world.lights[0].position = vec3(radius * cos(angle), start.y, radius * sin(angle));
+                if (world.lightTree) world.buildLightTree(world.lightTree->getQuality());
+            };
+            int pixels = imageSize * imageSize;
+            std::vector<vec3> cachedColors(pixels), fullColors(pixels);
+            
+            PrimaryHitCache cache;
+            auto start0 = std::chrono::steady_clock::now();
+            for (int f = 0; f < frames; f++) {
+                placeLight(f);
+                if (!cache.isValid(world, camera.getPosition(), imageSize)) {
+                    cache.build(world, camera.getPosition(), imageSize);
+                }
+                for (int p = 0; p < pixels; p++) {
+                    cachedColors[p] = cache.shade(world, p);
+                }
+            }
+            std::chrono::duration<double> cachedTime = std::chrono::steady_clock::now() - start0;
+            
+            start0 = std::chrono::steady_clock::now();
+            for (int f = 0; f < frames; f++) {
+                placeLight(f);
+                std::vector<glm::vec3> rays = generateRays(imageSize);
+                for (int p = 0; p < pixels; p++) {
+                    fullColors[p] = tracePrimary(world, camera.getPosition(), rays[p]);
+                }
+            }
+            std::chrono::duration<double> fullTime = std::chrono::steady_clock::now() - start0;
+            
+            float maxDiff = 0.0f;
+            for (int p = 0; p < pixels; p++) {
+                vec3 d = abs(cachedColors[p] - fullColors[p]);
+                maxDiff = std::max(maxDiff, std::max(d.r, std::max(d.g, d.b)));
+            }
+            cout << frames << " frames: cached " << cachedTime.count() << " s, full " << fullTime.count()
+                 << " s, " << fullTime.count() / cachedTime.count() << "x (max difference " << maxDiff << ")" << endl;
+            for (int i = 0; i < imageSize; i++) {
+                for (int j = 0; j < imageSize; j++) {
+                    setPixelColor(*image, j, i, cachedColors[i * imageSize + j]);
+                }
+            }
+        } else if (getOption(argc, argv, "lightbench")) {
+            // Every light against the light tree, at 10 to 10k random lights
+            int pixels = imageSize * imageSize;
+            std::vector<glm::vec3> rays = generateRays(imageSize);
+            std::vector<vec3> exact(pixels), approx(pixels);
+            auto renderFrame = [&](std::vector<vec3>& colors) {
+                world.lightEvaluations = 0;
+                auto start = std::chrono::steady_clock::now();
+                for (int p = 0; p < pixels; p++) {
+                    colors[p] = tracePrimary(world, camera.getPosition(), rays[p]);
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                return elapsed.count();
+            };
+            for (int count : {10, 100, 1000, 10000}) {
+                setRandomLights(world, count);
+                world.lightTree.reset();
+                double exactTime = renderFrame(exact);
+                long long exactEvaluations = world.lightEvaluations;
+                world.buildLightTree(lightQuality);
+                double treeTime = renderFrame(approx);
+                double error = 0.0;
+                for (int p = 0; p < pixels; p++) {
+                    vec3 d = glm::min(approx[p], vec3(1.0f)) - glm::min(exact[p], vec3(1.0f));
+                    error += dot(d, d) / 3.0;
+                }
+                cout << count << " lights: all " << exactTime << " s (" << (double)exactEvaluations / pixels << " lights/pixel), tree "
+                     << treeTime << " s (" << (double)world.lightEvaluations / pixels << " lights/pixel), "
+                     << exactTime / treeTime << "x, RMSE " << sqrt(error / pixels) << endl;
+            }
+            for (int i = 0; i < imageSize; i++) {
+                for (int j = 0; j < imageSize; j++) {
+                    setPixelColor(*image, j, i, approx[i * imageSize + j]);
+                }
+            }
+        } else if (getOption(argc, argv, "adaptive")) {
+            // Variance-driven supersampling. With reference=SPP the result is
+            // compared against a uniform SPP render, as is uniform sampling at
+            // the adaptive maximum.
+            AdaptiveSampler sampler(imageSize, imageSize);
+            if (getOption(argc, argv, "minspp", &value)) sampler.setMinSpp(atoi(value.c_str()));
+            int maxSpp = getOption(argc, argv, "spp", &value) ? atoi(value.c_str()) : 64;
+            sampler.setMaxSpp(maxSpp);
+            if (getOption(argc, argv, "threshold", &value)) sampler.setThreshold(atof(value.c_str()));
+            auto sample = [&](float px, float py) {
+                return tracePrimary(world, camera.getPosition(), generateRay(px, py, imageSize));
+            };
+            
+            vector<vec3> reference;
+            vector<vec3> uniform;
+            long long uniformRays = 0;
+            if (getOption(argc, argv, "reference", &value)) {
+                sampler.renderUniform(sample, atoi(value.c_str()));
+                reference = sampler.getColors();
+                uniformRays = sampler.renderUniform(sample, maxSpp);
+                uniform = sampler.getColors();
+            }
+            long long rays = sampler.render(sample);
+            cout << "Adaptive: " << rays << " rays (" << (double)rays / (imageSize * imageSize) << " spp average)" << endl;
+            if (!reference.empty()) {
+                cout << "Uniform " << maxSpp << " spp: " << uniformRays << " rays, RMSE " << AdaptiveSampler::rmse(uniform, reference) << endl;
+                cout << "Adaptive: RMSE " << AdaptiveSampler::rmse(sampler.getColors(), reference) << ", " << (double)uniformRays / rays << "x fewer rays" << endl;
+            }
+            if (getOption(argc, argv, "heatmap", &value)) {
+                sampler.writeHeatmap(value);
+            }
+            const vector<vec3>& colors = sampler.getColors();
+            for (int i = 0; i < imageSize; i++) {
+                for (int j = 0; j < imageSize; j++) {
+                    setPixelColor(*image, j, i, colors[i * imageSize + j]);
+                }
+            }
+        } else if (getOption(argc, argv, "denoise")) {
+            // Low-spp render plus the guide buffers, then an edge-aware filter.
+            // The guides come from the first sample, which is the pixel center.
+            int spp = getOption(argc, argv, "spp", &value) ? std::max(1, atoi(value.c_str())) : 1;
+            int strata = (int)ceil(sqrt((float)spp));
+            int n = imageSize * imageSize;
+            vector<vec3> colors(n);
+            vector<float> depth(n);
+            vector<vec3> normals(n);
+            vector<vec3> albedo(n);
+            for (int i = 0; i < imageSize; i++) {
+                for (int j = 0; j < imageSize; j++) {
+                    vec3 sum(0.0f);
+                    for (int s = 0; s < spp; s++) {
+                        float dx = s == 0 ? 0.5f : ((s % strata) + 0.5f) / strata;
+                        float dy = s == 0 ? 0.5f : ((s / strata % strata) + 0.5f) / strata;
+                        HitInfo hit;
+                        vec3 c = tracePrimary(world, camera.getPosition(), generateRay(j + dx, i + dy, imageSize), &hit);
+                        sum += glm::min(c, vec3(1.0f));
+                        if (s == 0) {
+                            depth[i * imageSize + j] = hit.t;
+                            normals[i * imageSize + j] = hit.normal;
+                            albedo[i * imageSize + j] = hit.albedo;
+                        }
                     }
+                    colors[i * imageSize + j] = sum / (float)spp;
                 }
-                
-                float r = std::min(colors.r , 1.0f);
-                float g = std::min(colors.g , 1.0f);
-                float b = std::min(colors.b , 1.0f);
-                
-                image->setPixel(j, i, r * 255, g * 255, b * 255);
             }
-        }
-    }
-    // Task 4
-    if (scene == 4 || scene == 5) {
-        Light lightOne = {{-1.0, 2.0, 1.0}, 0.5f};
-        Light lightTwo = {{0.5, -0.5, 0.0}, 0.5f};
-        vector<Light> lights;
-        lights.push_back(lightOne);
-        lights.push_back(lightTwo);
-        
-        Plane backWall(vec3(0.0, 0.0, -3.0), vec3(0.0f, 0.0f, 1.0f), vec3(1.0f, 1.0f, 1.0f), vec3(0.0f, 0.0f, 0.0f), vec3(0.1f, 0.1f, 0.1f), 0.0f);
-        Plane floor(vec3(0.0, -1.0, 0.0), vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 1.0f), vec3(0.0f, 0.0f, 0.0f), vec3(0.1f, 0.1f, 0.1f), 0.0f);
-        
-        Sphere redSphere(vec3(0.5, -0.7, 0.5), 0.3f, vec3(1.0, 0.0, 0.0), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f);
-        Sphere blueSphere(vec3(1.0, -0.7, 0.0), 0.3f, vec3(0.0f, 0.0f, 1.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f);
-        
-        ReflectiveSphere reflectiveSphere1(vec3(-0.5, 0.0, -0.5), 1.0f);
-        ReflectiveSphere reflectiveSphere2(vec3(1.5, 0.0, -1.5), 1.0f);
-        
-        
-       
-        vector<Object*> objects;
-        objects.push_back(&backWall);
-        objects.push_back(&floor);
-        objects.push_back(&blueSphere);
-        objects.push_back(&redSphere);
-        objects.push_back(&reflectiveSphere1);
-        objects.push_back(&reflectiveSphere2);
-        
-        
-        vector<vector<float>> distBuf(imageSize, vector<float>(imageSize, static_cast<float>(numeric_limits<int>::max())));
-        for (int i = 0; i < imageSize; i++) {
-            for (int j = 0; j < imageSize; j++) {
-                vec3 colors = {0.0f, 0.0f, 0.0f};
-                for (Object* obj : objects)
-                {
-                    bool hasHit = obj->doHit(camera.getPosition(), rays[i * imageSize + j]);
-                    float t = obj->intersectTest(camera.getPosition(), rays[i * imageSize + j]);
-                    
-                    if (hasHit && t < distBuf[i][j]) {
-                        distBuf[i][j] = t;
-                        
-                        vec3 hitPoint = obj->findHit(t, camera.getPosition(), rays[i * imageSize + j]);
-                        colors = obj->computeRayColor(camera.getPosition(), rays[i * imageSize + j], lights, objects, *obj, hitPoint, 3);
+            
+            Denoiser denoiser;
+            if (getOption(argc, argv, "iterations", &value)) denoiser.setIterations(atoi(value.c_str()));
+            if (getOption(argc, argv, "sigma_color", &value)) denoiser.setSigmaColor(atof(value.c_str()));
+            if (getOption(argc, argv, "sigma_depth", &value)) denoiser.setSigmaDepth(atof(value.c_str()));
+            if (getOption(argc, argv, "sigma_normal", &value)) denoiser.setSigmaNormal(atof(value.c_str()));
+            if (getOption(argc, argv, "sigma_albedo", &value)) denoiser.setSigmaAlbedo(atof(value.c_str()));
+            if (getOption(argc, argv, "threads", &value)) denoiser.setThreads(atoi(value.c_str()));
+            auto start = chrono::steady_clock::now();
+            denoiser.denoise(imageSize, imageSize, colors, depth, normals, albedo);
+            chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+            cout << "Denoised in " << elapsed.count() << " ms" << endl;
+            
+            for (int i = 0; i < imageSize; i++) {
+                for (int j = 0; j < imageSize; j++) {
+                    setPixelColor(*image, j, i, colors[i * imageSize + j]);
+                }
+            }
+        } else {
+            // aov=FILE also writes float channels from the same primary rays.
+            AovWriter aov;
+            string aovFile;
+            if (getOption(argc, argv, "aov", &aovFile)) {
+                int channels = getOption(argc, argv, "channels", &value) ? AovWriter::parseChannels(value) : AovWriter::ALL;
+                aov.open(aovFile, imageSize, imageSize, channels);
+            }
+            // order=morton|hilbert walks ordertile=SIZE tiles along the curve; the
+            // rays are generated in that order and written back through it.
+            PixelOrder::Curve curve = PixelOrder::ROWS;
+            bool ordered = getOption(argc, argv, "order", &value);
+            if (ordered && !PixelOrder::parse(value, curve)) {
+                cout << "Unknown pixel order " << value << endl;
+            }
+            int orderTile = getOption(argc, argv, "ordertile", &value) ? atoi(value.c_str()) : 8;
+            PixelOrder order(imageSize, imageSize, orderTile, curve);
+            const std::vector<int>& pixels = order.getPixels();
+            std::vector<glm::vec3> rays(pixels.size());
+            for (size_t k = 0; k < pixels.size(); k++) {
+                rays[k] = generateRay(pixels[k] % imageSize + 0.5f, pixels[k] / imageSize + 0.5f, imageSize);
+            }
+            // Locality: how often the next ray hits another object, and how
+            // much of its light cut the next pixel shares.
+            long long objectSwitches = 0, cutShared = 0, cutTotal = 0;
+            int lastObject = -1;
+            std::vector<int> lastCut, thisCut;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t k = 0; k < pixels.size(); k++) {
+                int i = pixels[k] / imageSize;
+                int j = pixels[k] % imageSize;
+                HitInfo hit;
+                vec3 colors = tracePrimary(world, camera.getPosition(), rays[k], &hit);
+                setPixelColor(*image, j, i, colors);
+                if (aov.isOpen()) {
+                    aov.setPixel(j, i, colors, hit.t, hit.normal, hit.objectId);
+                }
+                if (ordered) {
+                    objectSwitches += k > 0 && hit.objectId != lastObject;
+                    lastObject = hit.objectId;
+                    if (world.lightTree && hit.objectId >= 0) {
+                        thisCut.clear();
+                        for (const LightTree::Entry& e : world.cut) thisCut.push_back(e.light);
+                        std::sort(thisCut.begin(), thisCut.end());
+                        std::vector<int> shared;
+                        std::set_intersection(thisCut.begin(), thisCut.end(), lastCut.begin(), lastCut.end(), std::back_inserter(shared));
+                        cutShared += shared.size();
+                        cutTotal += thisCut.size();
+                        lastCut.swap(thisCut);
                     }
                 }
-                
-                float r = std::min(colors.r , 1.0f);
-                float g = std::min(colors.g , 1.0f);
-                float b = std::min(colors.b , 1.0f);
-                
-                image->setPixel(j, i, r * 255, g * 255, b * 255);
+            }
+            if (ordered) {
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                cout << "Traced in " << elapsed.count() << " s, object switches per pixel " << (double)objectSwitches / pixels.size();
+                if (cutTotal > 0) cout << ", light cut shared with previous pixel " << 100.0 * cutShared / cutTotal << "%";
+                cout << endl;
+            }
+            if (aov.isOpen()) {
+                aov.close();
+                cout << "Wrote AOVs to " << aovFile << endl;
             }
         }
-        
     }
+    
     // TASK 5 unfinished
     if (scene == 6 or scene == 7)
     {
+        std::vector<glm::vec3> rays = generateRays(imageSize);
         Light lightOne = {{-1.0, 1.0, 1.0}, 1.0f};
         Material objMaterial = {glm::vec3(0.0, 0.0, 1.0), glm::vec3(1.0, 1.0, 0.5), glm::vec3(0.1, 0.1, 0.1), 100.0f}; // Blue with green highlights
         
@@ -925,7 +1423,7 @@ int main(int argc, char **argv)
         
         vec3 center;
         float radius;
-        createBoundingSphere(posBuf, center, radius);
+        createBoundingSphere(*shape, center, radius);
         Sphere boundingSphere(center, radius, vec3(0.0, 0.0, 0.0), vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 0.0f),0.0f);
             
         for (int i = 0; i < imageSize; i++) {
@@ -983,68 +1481,6 @@ int main(int argc, char **argv)
         }
         
         
-    }
-    // TASK 6
-    if (scene == 8)
-    {
-       
-        //camera.changeFOV(60.0f);
-        camera.changePosition(vec3(-3,0,0));
-       
-        glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);  // Look at the positve x axis
-        glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);  // Y-axis is up
-
-        glm::mat4 view = glm::lookAt(camera.getPosition(), cameraTarget, up);
-        glm::mat4 transformMatrix = view;
-
-        vec3 rSpherePos = vec3(transformMatrix *  vec4(vec3(-0.5f, -1.0f, 1.0f), 1.0f));
-        vec3 gSpherePos = vec3(transformMatrix *  vec4(vec3(0.5f, -1.0f, -1.0f), 1.0f));
-        vec3 bSpherePos = vec3(transformMatrix *  vec4(vec3(0.0f, 1.0f, 0.0f), 1.0f));
-        
-        
-        // Define the light
-        Light light = {{-2.0, 1.0, 1.0}, 1.0};
-        vector<Light> lights;
-        lights.push_back(light);
-        lights[0].position =vec3(transformMatrix *  vec4(lights[0].position, 1.0f));
-        
-        camera.changePosition(vec3(0,0,0));
-        // Define the spheres
-        Sphere redSphere(rSpherePos, 1.0f, vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f);
-        Sphere greenSphere(gSpherePos, 1.0f, vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f);
-        Sphere blueSphere(bSpherePos, 1.0f, vec3(0.0f, 0.0f, 1.0f), vec3(1.0f, 1.0f, 0.5f), vec3(0.1f, 0.1f, 0.1f), 100.0f);
-        
-        vector<Object*> objects;
-        objects.push_back(&redSphere);
-        objects.push_back(&greenSphere);
-        objects.push_back(&blueSphere);
-        
-        vector<vector<float>> distBuf(imageSize, vector<float>(imageSize, static_cast<float>(numeric_limits<int>::max())));
-        for (int i = 0; i < imageSize; i++) {
-            for (int j = 0; j < imageSize; j++) {
-                vec3 colors = {0.0f, 0.0f, 0.0f};
-                for (Object* obj : objects)
-                {
-                    bool hasHit = obj->doHit(camera.getPosition(), rays[i * imageSize + j]);
-                    float t = obj->intersectTest(camera.getPosition(), rays[i * imageSize + j]);
-                    if (hasHit && t < distBuf[i][j]) {
-                        distBuf[i][j] = t;
-                        
-                        
-                        vec3 hitPoint = obj->findHit(t, camera.getPosition(), rays[i * imageSize + j]);
-                        
-                        colors = obj->computeRayColor(camera.getPosition(), rays[i * imageSize + j], lights, objects, *obj, hitPoint, 30);
-                        
-                    }
-                }
-                
-                float r = std::min(colors.r , 1.0f);
-                float g = std::min(colors.g , 1.0f);
-                float b = std::min(colors.b , 1.0f);
-                
-                image->setPixel(j, i, r * 255, g * 255, b * 255);
-            }
-        }
     }
     //write image to file
     image->writeToFile(output_filename);
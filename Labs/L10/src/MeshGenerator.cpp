@@ -0,0 +1,197 @@
+#include "MeshGenerator.h"
+
+#include <cmath>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "Parallel.h"
+
+using namespace std;
+
+namespace {
+
+const float PI = 3.14159265358979f;
+
+// Rows are filled in parallel only for grids larger than this.
+const size_t MIN_VERTICES_PER_THREAD = 1 << 16;
+
+struct Vertex
+{
+	glm::vec3 p;
+	glm::vec3 n;
+	glm::vec2 t;
+};
+
+// Makes room for count more vertices and returns the index of the first.
+size_t addVertices(MeshGenerator::Mesh &mesh, size_t count, bool normals)
+{
+	size_t first = mesh.getVertexCount();
+	if(mesh.interleaved) {
+		mesh.vertBuf.resize(8*(first + count), 0.0f);
+	} else {
+		mesh.posBuf.resize(3*(first + count));
+		if(normals) {
+			mesh.norBuf.resize(3*(first + count));
+		}
+		mesh.texBuf.resize(2*(first + count));
+	}
+	return first;
+}
+
+void setVertex(MeshGenerator::Mesh &mesh, size_t i, const Vertex &v)
+{
+	if(mesh.interleaved) {
+		float *f = &mesh.vertBuf[8*i];
+		f[0] = v.p.x; f[1] = v.p.y; f[2] = v.p.z;
+		f[3] = v.n.x; f[4] = v.n.y; f[5] = v.n.z;
+		f[6] = v.t.x; f[7] = v.t.y;
+		return;
+	}
+	float *p = &mesh.posBuf[3*i];
+	p[0] = v.p.x; p[1] = v.p.y; p[2] = v.p.z;
+	if(!mesh.norBuf.empty()) {
+		float *n = &mesh.norBuf[3*i];
+		n[0] = v.n.x; n[1] = v.n.y; n[2] = v.n.z;
+	}
+	float *t = &mesh.texBuf[2*i];
+	t[0] = v.t.x; t[1] = v.t.y;
+}
+
+// Adds a grid of (columns + 1) x (rows + 1) vertices, vertex(u, v) giving
+// the one at u = column/columns and v = row/rows, and two triangles per
+// cell. They are counterclockwise if cross(dp/du, dp/dv) points out.
+template <typename F>
+void addGrid(MeshGenerator::Mesh &mesh, int columns, int rows, bool normals, F vertex)
+{
+	size_t perRow = columns + 1;
+	size_t first = addVertices(mesh, perRow*(rows + 1), normals);
+	size_t firstIndex = mesh.eleBuf.size();
+	mesh.eleBuf.resize(firstIndex + 6*(size_t)columns*rows);
+	size_t minRows = MIN_VERTICES_PER_THREAD/perRow + 1;
+	parallelRanges(rows + 1, minRows, [&](size_t begin, size_t end) {
+		for(size_t i = begin; i < end; ++i) {
+			for(size_t j = 0; j < perRow; ++j) {
+				setVertex(mesh, first + i*perRow + j, vertex(j/(float)columns, i/(float)rows));
+			}
+			if(i == (size_t)rows) {
+				continue;
+			}
+			unsigned int *e = &mesh.eleBuf[firstIndex + 6*i*columns];
+			for(size_t j = 0; j < (size_t)columns; ++j, e += 6) {
+				unsigned int index = (unsigned int)(first + i*perRow + j);
+				e[0] = index;
+				e[1] = index + 1;
+				e[2] = index + 1 + (unsigned int)perRow;
+				e[3] = index;
+				e[4] = index + (unsigned int)perRow + 1;
+				e[5] = index + (unsigned int)perRow;
+			}
+		}
+	});
+}
+
+// A disk of radius r at height y facing +y (up) or -y
+void addCap(MeshGenerator::Mesh &mesh, int slices, float r, float y, bool up)
+{
+	size_t center = addVertices(mesh, slices + 2, true);
+	glm::vec3 n(0.0f, up ? 1.0f : -1.0f, 0.0f);
+	setVertex(mesh, center, {glm::vec3(0.0f, y, 0.0f), n, glm::vec2(0.5f)});
+	for(int j = 0; j <= slices; ++j) {
+		float phi = 2.0f*PI*j/slices;
+		glm::vec2 d(sin(phi), cos(phi));
+		setVertex(mesh, center + 1 + j, {glm::vec3(r*d.x, y, r*d.y), n, glm::vec2(0.5f) + 0.5f*d});
+	}
+	for(int j = 0; j < slices; ++j) {
+		unsigned int a = (unsigned int)(center + 1 + j);
+		if(up) {
+			mesh.eleBuf.insert(mesh.eleBuf.end(), {(unsigned int)center, a, a + 1});
+		} else {
+			mesh.eleBuf.insert(mesh.eleBuf.end(), {(unsigned int)center, a + 1, a});
+		}
+	}
+}
+
+// Leaves room for the grid and any caps so that nothing grows twice.
+void reserve(MeshGenerator::Mesh &mesh, size_t vertices, size_t indices, bool normals)
+{
+	size_t n = mesh.getVertexCount() + vertices;
+	if(mesh.interleaved) {
+		mesh.vertBuf.reserve(8*n);
+	} else {
+		mesh.posBuf.reserve(3*n);
+		if(normals) {
+			mesh.norBuf.reserve(3*n);
+		}
+		mesh.texBuf.reserve(2*n);
+	}
+	mesh.eleBuf.reserve(mesh.eleBuf.size() + indices);
+}
+
+}
+
+void MeshGenerator::sphere(Mesh &mesh, int slices, int stacks, float radius)
+{
+	// From the south pole up, so that the triangles face out
+	addGrid(mesh, slices, stacks, true, [=](float u, float v) {
+		float theta = PI*(1.0f - v);
+		float phi = 2.0f*PI*u;
+		glm::vec3 n(sin(theta)*sin(phi), cos(theta), sin(theta)*cos(phi));
+		return Vertex{radius*n, n, glm::vec2(1.0f - u, v)};
+	});
+}
+
+void MeshGenerator::grid(Mesh &mesh, int columns, int rows, float width, float height)
+{
+	addGrid(mesh, columns, rows, true, [=](float u, float v) {
+		return Vertex{glm::vec3((u - 0.5f)*width, (v - 0.5f)*height, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(u, v)};
+	});
+}
+
+void MeshGenerator::revolution(Mesh &mesh, int xSegments, int thetaSegments, float length, Profile profile)
+{
+	// Rows along x, columns around it
+	if(!profile) {
+		addGrid(mesh, thetaSegments, xSegments, false, [=](float u, float v) {
+			return Vertex{glm::vec3(length*v, 2.0f*PI*u, 0.0f), glm::vec3(0.0f), glm::vec2(u, v)};
+		});
+		return;
+	}
+	float h = 1e-3f*max(length, 1e-3f);
+	addGrid(mesh, thetaSegments, xSegments, true, [=](float u, float v) {
+		float x = length*v;
+		float theta = 2.0f*PI*u;
+		float f = profile(x);
+		float dfdx = (profile(x + h) - profile(x - h))/(2.0f*h);
+		glm::vec3 d(0.0f, cos(theta), sin(theta));
+		glm::vec3 dpdx = glm::vec3(1.0f, 0.0f, 0.0f) + dfdx*d;
+		glm::vec3 dpdtheta(0.0f, -sin(theta), cos(theta));
+		glm::vec3 n = glm::cross(dpdtheta, dpdx);
+		float len = glm::length(n);
+		return Vertex{glm::vec3(x, 0.0f, 0.0f) + f*d, len > 0.0f ? n/len : d, glm::vec2(u, v)};
+	});
+}
+
+void MeshGenerator::cylinder(Mesh &mesh, int slices, int stacks, float radius, float height)
+{
+	reserve(mesh, (slices + 1)*(stacks + 1) + 2*(slices + 2), 6*slices*stacks + 6*slices, true);
+	addGrid(mesh, slices, stacks, true, [=](float u, float v) {
+		float phi = 2.0f*PI*u;
+		glm::vec3 n(sin(phi), 0.0f, cos(phi));
+		return Vertex{radius*n + glm::vec3(0.0f, (v - 0.5f)*height, 0.0f), n, glm::vec2(u, v)};
+	});
+	addCap(mesh, slices, radius, 0.5f*height, true);
+	addCap(mesh, slices, radius, -0.5f*height, false);
+}
+
+void MeshGenerator::torus(Mesh &mesh, int slices, int rings, float majorRadius, float minorRadius)
+{
+	// Columns around the y axis, rows around the tube
+	addGrid(mesh, slices, rings, true, [=](float u, float v) {
+		float phi = 2.0f*PI*u;
+		float psi = 2.0f*PI*v;
+		glm::vec3 out(sin(phi), 0.0f, cos(phi));
+		glm::vec3 n = cos(psi)*out + glm::vec3(0.0f, sin(psi), 0.0f);
+		return Vertex{majorRadius*out + minorRadius*n, n, glm::vec2(u, v)};
+	});
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef MESH_GENERATOR_H
+#define MESH_GENERATOR_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Indexed triangle meshes built from a few parameters: UV sphere, grid,
+ * surface of revolution, cylinder, and torus. Each one is a grid of
+ * (columns + 1) x (rows + 1) vertices (the seam is duplicated so that
+ * texture coords can wrap), two counterclockwise triangles per cell, and
+ * normals pointing out. The buffers are sized once up front, and large
+ * meshes are filled a band of rows per core.
+ *
+ * Set mesh.interleaved to get position, normal, and texcoords packed per
+ * vertex in vertBuf instead of the separate posBuf, norBuf, and texBuf.
+ */
+class MeshGenerator
+{
+public:
+	// Radius of a surface of revolution at x
+	typedef float (*Profile)(float x);
+
+	struct Mesh
+	{
+		Mesh() : interleaved(false) {}
+		size_t getVertexCount() const { return interleaved ? vertBuf.size()/8 : posBuf.size()/3; }
+
+		bool interleaved;
+		std::vector<float> posBuf;
+		std::vector<float> norBuf; // empty if there are no normals
+		std::vector<float> texBuf;
+		std::vector<float> vertBuf; // 8 floats per vertex
+		std::vector<unsigned int> eleBuf;
+	};
+
+	// Sphere around the origin, slices around the y axis and stacks from
+	// pole to pole
+	static void sphere(Mesh &mesh, int slices, int stacks, float radius = 1.0f);
+	// Grid in the xy plane, centered on the origin and facing +z
+	static void grid(Mesh &mesh, int columns, int rows, float width = 1.0f, float height = 1.0f);
+	// x from 0 to length, revolved around the x axis at radius profile(x).
+	// With no profile, the positions are (x, theta, 0) and there are no
+	// normals, for a vertex shader to do the revolving.
+	static void revolution(Mesh &mesh, int xSegments, int thetaSegments, float length, Profile profile = nullptr);
+	// Cylinder along the y axis from -height/2 to height/2, with caps
+	static void cylinder(Mesh &mesh, int slices, int stacks, float radius = 1.0f, float height = 1.0f);
+	// Torus around the y axis
+	static void torus(Mesh &mesh, int slices, int rings, float majorRadius = 1.0f, float minorRadius = 0.25f);
+};
+
+#endif
@@ -17,6 +17,7 @@
 #include "Camera.h"
 #include "GLSL.h"
 #include "MatrixStack.h"
+#include "MeshGenerator.h"
 #include "Program.h"
 #include "Texture.h"
 
@@ -224,41 +225,12 @@ static void init()
         }
     */
     
-    int numPoints = 50;
-    for (int i = 0; i < numPoints; i++) {
-        float theta = static_cast<float>(i) / (numPoints - 1) * M_PI; // From [0, pi]
-        for (int j = 0; j < numPoints; j++) {
-            
-            float phi = static_cast<float>(j) / (numPoints - 1) * 2 * M_PI; // Range [0, 2pi]
-            
-            float x = sin(theta) * sin(phi);
-            float y = cos(theta);
-            float z = sin(theta) * cos(phi);
-
-            posBuf.push_back(x);
-            posBuf.push_back(y);
-            posBuf.push_back(z);
-            
-            norBuf.push_back(x);
-            norBuf.push_back(y);
-            norBuf.push_back(z);
-            
-            texBuf.push_back(1 - static_cast<float>(j) / (numPoints - 1));
-            texBuf.push_back(1 - static_cast<float>(i) / (numPoints - 1));
-        }
-    }
-    for (int i = 0; i < numPoints - 1; ++i) {
-        for (int j = 0; j < numPoints - 1; ++j) {
-            int index = i * numPoints + j;
-            indBuf.push_back(index);
-            indBuf.push_back(index + 1);
-            indBuf.push_back(index + 1 + numPoints);
-
-            indBuf.push_back(index);
-            indBuf.push_back(index + numPoints + 1);
-            indBuf.push_back(index + numPoints);
-        }
-    }
+    MeshGenerator::Mesh sphere;
+    MeshGenerator::sphere(sphere, 49, 49);
+    posBuf.swap(sphere.posBuf);
+    norBuf.swap(sphere.norBuf);
+    texBuf.swap(sphere.texBuf);
+    indBuf.swap(sphere.eleBuf);
 	// Total number of indices
 	indCount = (int)indBuf.size();
 		